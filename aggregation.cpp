@@ -25,18 +25,47 @@
 #include <netinet/ip6.h>
 #include <arpa/inet.h>
 #include <iostream>
+#include <algorithm>
 #include <pthread.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <ctime>
+#include <map>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "rbtree.h"
 #include "common.h"
 #include "flow.h"
 #include "file_list.h"
 #include "bstree.h"
+#include "hugepage.h"
+#include "topology.h"
+#include "spill.h"
+#include "checkpoint.h"
+#include "partial.h"
+#include "shard.h"
+#include "store.h"
+#include "segment.h"
+#include "sidecar.h"
+#include "sorted.h"
+#include "bucket.h"
+#include "rollup.h"
+#include "window.h"
+#include "watch.h"
+#include "alert.h"
 
 #ifndef THREAD_COUNT
 # define THREAD_COUNT		1		// probably best value based on results on my PC
 #endif
 
+#ifndef FLOW_BATCH
+# define FLOW_BATCH		16		// flows looked up at once, up to RBTREE_BATCH_MAX
+#endif
+
+#define KEY_OFFSET(FIELD)	(offsetof(Flow, data) + offsetof(struct Flow::data, FIELD))
+
 const unsigned Aggregation::PORT_COUNT = 65536;
 
 /**
@@ -92,7 +121,10 @@ int cmp_srcip4_mask(const struct rbtree_node *a, const struct rbtree_node *b) {
 	Flow *p = rbtree_container_of(a, Flow, node_agg);
 	Flow *q = rbtree_container_of(b, Flow, node_agg);
 
-	return  (int)(GETIPV4VAL(p->data.src_addr)) - (int)(GETIPV4VAL(q->data.src_addr));
+	uint32_t x = ntohl(GETIPV4VAL(p->data.src_addr));
+	uint32_t y = ntohl(GETIPV4VAL(q->data.src_addr));
+
+	return (x > y) - (x < y);
 }
 
 /**
@@ -127,7 +159,10 @@ int cmp_dstip4_mask(const struct rbtree_node *a, const struct rbtree_node *b) {
 	Flow *p = rbtree_container_of(a, Flow, node_agg);
 	Flow *q = rbtree_container_of(b, Flow, node_agg);
 
-	return  (int)(GETIPV4VAL(p->data.dst_addr)) - (int)(GETIPV4VAL(q->data.dst_addr));
+	uint32_t x = ntohl(GETIPV4VAL(p->data.dst_addr));
+	uint32_t y = ntohl(GETIPV4VAL(q->data.dst_addr));
+
+	return (x > y) - (x < y);
 }
 
 /**
@@ -194,7 +229,7 @@ int cmp_srcport(const struct rbtree_node *a, const struct rbtree_node *b) {
 	Flow *p = rbtree_container_of(a, Flow, node_agg);
 	Flow *q = rbtree_container_of(b, Flow, node_agg);
 
-	return p->data.src_port - q->data.src_port;
+	return (int) ntohs(p->data.src_port) - (int) ntohs(q->data.src_port);
 }
 
 /**
@@ -210,7 +245,7 @@ int cmp_dstport(const struct rbtree_node *a, const struct rbtree_node *b) {
 	Flow *p = rbtree_container_of(a, Flow, node_agg);
 	Flow *q = rbtree_container_of(b, Flow, node_agg);
 
-	return q->data.dst_port - p->data.dst_port;
+	return (int) ntohs(p->data.dst_port) - (int) ntohs(q->data.dst_port);
 }
 
 /**
@@ -322,515 +357,3866 @@ void tree_inorder_free(struct bstree * tree, void (*fun)(const Flow *)) {
 		delete bstree_container_of(prev, Flow, node_sort);
 }
 
+/**
+ * @brief  Free all flows in aggregation (sub)tree
+ *
+ * @param node root of subtree
+ */
+static
+void rbtree_free_flows(struct rbtree_node * node) {
+	if (! node)
+		return;
+
+	rbtree_free_flows(node->left);
+	rbtree_free_flows(node->right);
+	delete rbtree_container_of(node, Flow, node_agg);
+}
+
+/**
+ * @brief  Traverse aggregation tree in key order, print visited node and
+ *         free all nodes afterwards
+ *
+ * @param tree tree to traverse
+ * @param fun function used for printing
+ */
+static inline
+void rbtree_inorder_free(struct rbtree * tree, void (*fun)(const Flow *)) {
+	for (struct rbtree_node * node = rbtree_first(tree); node; node = rbtree_next(node))
+		fun(rbtree_container_of(node, Flow, node_agg));
+
+	rbtree_free_flows(tree->root);
+	tree->root = tree->first = tree->last = NULL;
+}
 
 /**
  * @brief  Lookup a flow, if found update data, otherwise insert new node
  *
  * @param flow flow to lookup
  * @param tree tree to use
+ * @param record flow holding totals of the key is stored here
  *
  * @return   true if new node was inserted, if updated return false
  */
 static inline
-bool rbtree_lookup_or_insert(Flow * flow, struct rbtree * tree) {
+bool rbtree_lookup_or_insert(Flow * flow, struct rbtree * tree, Flow ** record) {
 	assert(flow);
 	assert(tree);
 
 		struct rbtree_node * node;
 		if ((node = rbtree_lookup(&flow->node_agg, tree)) != NULL) {
-			Flow * record = rbtree_container_of(node, Flow, node_agg);
-			record->data.packets += flow->data.packets;
-			record->data.bytes += flow->data.bytes;
+			*record = rbtree_container_of(node, Flow, node_agg);
+			(*record)->data.packets += flow->data.packets;
+			(*record)->data.bytes += flow->data.bytes;
 			return false;
 		} else {
 			rbtree_insert(&flow->node_agg, tree);
+			*record = flow;
 			return true;
 		}
 }
 
 /**
- * @brief  Aggregate flow in single thread
+ * @brief  Lookup a flow in ART, if found update data, otherwise insert it
  *
- * @param param aggregation parameters
+ * @param flow flow to lookup
+ * @param tree tree to use
+ * @param record flow holding totals of the key is stored here
  *
- * @return   NULL
+ * @return   true if new node was inserted, if updated return false
  */
-void * Aggregation::aggregate(struct thread_param * param) {
-	Flow * flow = new Flow;
+static inline
+bool art_lookup_or_insert(Flow * flow, struct art_tree * tree, Flow ** record) {
+	*record = (Flow *) art_insert(tree, flow);
 
-	while (Flow::getFlow(flow, param->node)) {
-		if (rbtree_lookup_or_insert(flow, param->tree))
-			flow = new Flow;
+	if (*record) {
+		(*record)->data.packets += flow->data.packets;
+		(*record)->data.bytes += flow->data.bytes;
+		return false;
 	}
 
-	delete flow;
+	*record = flow;
+	return true;
+}
 
-	return NULL;
+/**
+ * @brief  Report alert limits reached by an update of a thread index
+ *
+ * @param record flow holding totals of the key in the index
+ * @param flow flow added to the record
+ * @param param thread parameters holding index
+ */
+static inline
+void index_alert(const Flow * record, const Flow * flow, struct Aggregation::thread_param * param) {
+	// with more threads every index holds only a part of the totals
+	if (param->alert)
+		alert_batch_add(param->alert, record, flow->data.packets, flow->data.bytes);
+	else
+		alert_check(record, flow->data.packets, flow->data.bytes);
 }
 
 /**
- * @brief  Aggregate flow in single thread based on dst IPv4
+ * @brief  Lookup a flow in rbtree or ART index of a thread
  *
- * @param param aggregation parameters
+ * @param flow flow to lookup
+ * @param param thread parameters holding index
  *
- * @return   NULL
+ * @return   true if new node was inserted, if updated return false
  */
-void * Aggregation::aggregate_dstip4(struct thread_param * param) {
-	Flow * flow = new Flow;
-	union mask_t mask;
-
-	get_ipv4_mask(mask, Param::getInstance().mask());
+static inline
+bool index_insert(Flow * flow, struct Aggregation::thread_param * param) {
+	Flow * record;
+	bool inserted;
 
-	while (Flow::getFlow(flow, param->node)) {
-		if (! Flow::is_ipv4_dst(flow))
-			continue;
+	if (param->art)
+		inserted = art_lookup_or_insert(flow, param->art, &record);
+	else
+		inserted = rbtree_lookup_or_insert(flow, param->tree, &record);
 
-		Flow::mask_dstip4(flow, mask);
+	if (Param::alert())
+		index_alert(record, flow, param);
 
-		if (rbtree_lookup_or_insert(flow, param->tree))
-			flow = new Flow;
-	}
+	param->flows += inserted;
+	return inserted;
+}
 
-	delete flow;
+/**
+ * @brief  Lookup a flow in aggregation index of a thread, keys refused by
+ *         shared map are kept by the index of the thread
+ *
+ * @param flow flow to lookup
+ * @param param thread parameters holding index
+ *
+ * @return   true if new node was inserted, if updated return false
+ */
+static inline
+bool index_lookup_or_insert(Flow * flow, struct Aggregation::thread_param * param) {
+	if (param->shared
+			&& shared_map_add(param->shared, flow, flow->data.packets, flow->data.bytes, param->stripe))
+		return false;
 
-	return NULL;
+	return index_insert(flow, param);
 }
 
 /**
- * @brief  Aggregate flow in single thread based on dst IPv6
+ * @brief  Sorted list of flows chained through node_agg.right
+ */
+struct flow_list {
+	struct rbtree_node * head;
+	struct rbtree_node ** tail;
+	size_t count;
+};
+
+/**
+ * @brief  Merge parameters of two sorted lists
+ */
+struct merge_param {
+	struct flow_list a;					///< result is stored here
+	struct flow_list b;
+	rbtree_cmp_fn_t cmp;
+};
+
+/**
+ * @brief  Lists reduced by one merge tree
+ */
+struct merge_group {
+	struct merge_param * param[THREAD_COUNT];
+	unsigned count;
+	int node;								///< node running merges, -1 for any
+};
+
+/**
+ * @brief  Append flow stored in ART to a sorted list
  *
- * @param param aggregation parameters
+ * @param value Flow to append
+ * @param data flow_list to append to
+ */
+static
+void art_list_flow(void * value, void * data) {
+	struct flow_list * list = (struct flow_list *) data;
+	Flow * record = (Flow *) value;
+
+	record->node_agg.right = NULL;
+	*list->tail = &record->node_agg;
+	list->tail = &record->node_agg.right;
+	list->count++;
+}
+
+/**
+ * @brief  Write combined keys of a full block to the index
  *
- * @return   NULL
+ * @param param thread parameters holding block and index
  */
-void * Aggregation::aggregate_dstip6(struct thread_param * param) {
+static
+void block_flush(struct Aggregation::thread_param * param) {
+	struct block * b = param->block;
+	unsigned count = block_combine(b);
 	Flow * flow = new Flow;
-	union mask_t mask;
 
-	get_ipv6_mask(mask, Param::getInstance().mask());
-
-	while (Flow::getFlow(flow, param->node)) {
-		if (! Flow::is_ipv6_dst(flow))
-			continue;
+	for (unsigned i = 0; i < count; ++i) {
+		struct block_entry * e = &b->entries[i];
 
-		Flow::mask_dstip6(flow, mask);
+		memcpy(((uint8_t *) flow) + b->key_offset, e->key, b->key_len);
+		flow->data.packets = e->packets;
+		flow->data.bytes = e->bytes;
 
-		if (rbtree_lookup_or_insert(flow, param->tree))
+		if (index_lookup_or_insert(flow, param))
 			flow = new Flow;
 	}
 
 	delete flow;
-
-	return NULL;
 }
 
 /**
- * @brief  Aggregate flow in single thread based on src IPv4
+ * @brief  Account a flow through the block or front cache of a thread
  *
- * @param param aggregation parameters
+ * With a block the flow is only copied to the block, the index is updated
+ * when the block is full or when all files are processed.
  *
- * @return   NULL
+ * Repeated keys are summed in the cache. A key evicted from the cache is
+ * written to the index using flow as a carrier, the new key takes its
+ * place in the cache.
+ *
+ * @param flow flow to account
+ * @param param thread parameters holding cache and index
+ *
+ * @return   true if flow was inserted to the index and can not be reused
  */
-void * Aggregation::aggregate_srcip4(struct thread_param * param) {
-	Flow * flow = new Flow;
-	union mask_t mask;
+static inline
+bool lookup_or_insert(Flow * flow, struct Aggregation::thread_param * param) {
+	struct hot_cache * cache = param->cache;
 
-	get_ipv4_mask(mask, Param::getInstance().mask());
+	if (param->router) {
+		shard_route(param->router, flow, flow->data.packets, flow->data.bytes);
+		return false;
+	}
 
-	while (Flow::getFlow(flow, param->node)) {
-		if (! Flow::is_ipv4_src(flow))
-			continue;
+	if (param->block) {
+		if (block_add(param->block, flow, flow->data.packets, flow->data.bytes))
+			block_flush(param);
+		return false;
+	}
 
-		Flow::mask_srcip4(flow, mask);
+	if (! cache)
+		return index_lookup_or_insert(flow, param);
 
-		if (rbtree_lookup_or_insert(flow, param->tree))
-			flow = new Flow;
+	struct hot_entry * e = hot_cache_entry(cache, flow);
+
+	if (hot_cache_hit(cache, e, flow)) {
+		e->packets += flow->data.packets;
+		e->bytes += flow->data.bytes;
+		return false;
 	}
 
-	delete flow;
+	uint8_t * flow_key = ((uint8_t *) flow) + cache->key_offset;
+	uint8_t key[HOT_KEY_MAX];
+	uint64_t packets = flow->data.packets;
+	uint64_t bytes = flow->data.bytes;
+	bool ret = false;
 
-	return NULL;
+	memcpy(key, flow_key, cache->key_len);
+
+	if (e->valid) {
+		memcpy(flow_key, e->key, cache->key_len);
+		flow->data.packets = e->packets;
+		flow->data.bytes = e->bytes;
+		ret = index_lookup_or_insert(flow, param);
+	}
+
+	memcpy(e->key, key, cache->key_len);
+	e->packets = packets;
+	e->bytes = bytes;
+	e->valid = 1;
+
+	return ret;
 }
 
 /**
- * @brief  Aggregate flow in single thread based on src IPv6
+ * @brief  Write all cached keys to the index, called at the end of a file
  *
- * @param param aggregation parameters
+ * @param flow carrier flow
+ * @param param thread parameters holding cache and index
  *
- * @return   NULL
+ * @return   carrier flow to be used (and freed) by the caller
  */
-void * Aggregation::aggregate_srcip6(struct thread_param * param) {
-	Flow * flow = new Flow;
-	union mask_t mask;
+static
+Flow * cache_flush(Flow * flow, struct Aggregation::thread_param * param) {
+	struct hot_cache * cache = param->cache;
 
-	get_ipv6_mask(mask, Param::getInstance().mask());
+	if (! cache)
+		return flow;
 
-	while (Flow::getFlow(flow, param->node)) {
-		if (! Flow::is_ipv6_src(flow))
+	for (unsigned i = 0; i <= cache->mask; ++i) {
+		struct hot_entry * e = &cache->entries[i];
+
+		if (! e->valid)
 			continue;
 
-		Flow::mask_srcip6(flow, mask);
+		memcpy(((uint8_t *) flow) + cache->key_offset, e->key, cache->key_len);
+		flow->data.packets = e->packets;
+		flow->data.bytes = e->bytes;
+		e->valid = 0;
 
-		if (rbtree_lookup_or_insert(flow, param->tree))
+		if (index_lookup_or_insert(flow, param))
 			flow = new Flow;
 	}
 
-	delete flow;
-
-	return NULL;
+	return flow;
 }
 
 /**
- * @brief  Aggregation entry point
+ * @brief  Decoded flows waiting for a batched index lookup
+ */
+struct flow_batch {
+	Flow * flows[FLOW_BATCH];
+	unsigned count;
+	Flow * spare[FLOW_BATCH];			///< flows not consumed by the index
+	unsigned spare_count;
+};
+
+/**
+ * @brief  Look up all flows of a batch in the index of a thread
  *
- * @return   false if aggregation failed (e.g. thread create failed)
+ * Lookups of the whole batch are interleaved and prefetched, flows with
+ * a key already present are added to the record found and kept as spare.
+ *
+ * @param batch batch to process
+ * @param param thread parameters holding index
  */
-bool Aggregation::run() {
-	struct bstree sort_tree;							// tree used for sorting
-	struct rbtree agg_all;								// tree used for temporary/continous result
-	pthread_t thread[THREAD_COUNT];					// threads
-	struct rbtree agg_tree[2*THREAD_COUNT];		// aggregation threes for every thread
-	struct thread_param param[2*THREAD_COUNT];	// thread parameters
-	struct rbtree tree_init;							// tree used for initialization
+static
+void batch_lookup(struct flow_batch * batch, struct Aggregation::thread_param * param) {
+	if (param->shared) {
+		size_t slot[FLOW_BATCH];
 
-	void (* print_fun)(const Flow *) = NULL;				// function used for printing flow
-	void (* print_fun_header)() = NULL;						// output header
-	void * (* agg_fun)(struct thread_param *) = NULL;	// thread aggregation routine
-	union rbfun_t cmp_fn;							// compare function used for comparing nodes in rbtree
+		for (unsigned i = 0; i < batch->count; ++i)
+			slot[i] = shared_map_prefetch(param->shared, batch->flows[i], param->stripe);
 
-	/*
-	 * Initialize all variables. The decision based on AGG/SORT is traversed only
-	 * once, using function pointers to boost the speed.
-	 */
-	switch (Param::aggregation()) {
-#ifndef USE_PORTMAP
-		case Param::AGG_SRCPORT:
-				cmp_fn = RBFUN(cmp_srcport);
-				print_fun = Flow::print_srcport;
-				print_fun_header = Flow::print_srcport_header;
-				agg_fun = aggregate;
-				break;
-		case Param::AGG_DSTPORT:
-				cmp_fn = RBFUN(cmp_dstport);
-				print_fun = Flow::print_dstport;
-				print_fun_header = Flow::print_dstport_header;
-				agg_fun = aggregate;
-				break;
-#endif
-		case Param::AGG_SRCIP:
-				cmp_fn = RBFUN(cmp_srcip);
-				print_fun = Flow::print_srcip;
-				print_fun_header = Flow::print_srcip_header;
-				agg_fun = aggregate;
-				break;
-		case Param::AGG_SRCIP4:
-				cmp_fn = RBFUN(cmp_srcip4_mask);
-				print_fun = Flow::print_srcip;
-				print_fun_header = Flow::print_srcip_header;
-				agg_fun = aggregate_srcip4;
-				break;
-		case Param::AGG_SRCIP6:
-				cmp_fn = RBFUN(cmp_srcip6_mask);
-				print_fun = Flow::print_srcip;
-				print_fun_header = Flow::print_srcip_header;
-				agg_fun = aggregate_srcip6;
-				break;
-		case Param::AGG_DSTIP:
-				cmp_fn = RBFUN(cmp_dstip);
-				print_fun = Flow::print_dstip;
-				print_fun_header = Flow::print_dstip_header;
-				agg_fun = aggregate;
-				break;
-		case Param::AGG_DSTIP4:
-				cmp_fn = RBFUN(cmp_dstip4_mask);
-				print_fun = Flow::print_dstip;
-				print_fun_header = Flow::print_dstip_header;
-				agg_fun = aggregate_dstip4;
-				break;
-		case Param::AGG_DSTIP6:
-				cmp_fn = RBFUN(cmp_dstip6_mask);
-				print_fun = Flow::print_dstip;
-				print_fun_header = Flow::print_dstip_header;
-				agg_fun = aggregate_dstip6;
-				break;
-		default:
-#ifdef USE_PORTMAP
-				UNUSED(cmp_dstport);
-				UNUSED(cmp_srcport);
-#endif
-				assert(! "Unknown aggregation type!\n");
-				break;
-	}
+		for (unsigned i = 0; i < batch->count; ++i) {
+			Flow * flow = batch->flows[i];
 
-	switch (Param::sort()) {
-		case Param::SORT_BYTES:
-			bstree_init(&sort_tree, cmp_bytes);
-			break;
-		case Param::SORT_PACKETS:
-			bstree_init(&sort_tree, cmp_packets);
-			break;
-		default:
-			assert(! "Unknown sort type!\n");
-			break;
+			if (shared_map_add_at(param->shared, flow, slot[i],
+									flow->data.packets, flow->data.bytes, param->stripe)
+					|| ! index_insert(flow, param))
+				batch->spare[batch->spare_count++] = flow;
+		}
+	} else {
+		const struct rbtree_node * keys[FLOW_BATCH];
+		struct rbtree_node * found[FLOW_BATCH];
+
+		for (unsigned i = 0; i < batch->count; ++i)
+			keys[i] = &batch->flows[i]->node_agg;
+
+		rbtree_lookup_batch(keys, found, batch->count, param->tree, param->key_delta);
+
+		for (unsigned i = 0; i < batch->count; ++i) {
+			Flow * flow = batch->flows[i];
+
+			if (found[i]) {
+				Flow * record = rbtree_container_of(found[i], Flow, node_agg);
+				record->data.packets += flow->data.packets;
+				record->data.bytes += flow->data.bytes;
+				if (Param::alert())
+					index_alert(record, flow, param);
+				batch->spare[batch->spare_count++] = flow;
+			} else if (! index_lookup_or_insert(flow, param)) {
+				// the same key was inserted earlier in this batch
+				batch->spare[batch->spare_count++] = flow;
+			}
+		}
 	}
 
-	rbtree_init(&tree_init, cmp_fn,
-					Param::getInstance().aggregation());
-
-	memcpy(&agg_all, &tree_init, sizeof(struct rbtree));
+	assert(batch->spare_count <= FLOW_BATCH);
+	batch->count = 0;
+}
 
-	for (int i = 0; i < 2*THREAD_COUNT; ++i) {
-		// Hey, Mr. Compiler! Are you reading this? Unroll the loop please! Do it
-		// for me, I swear I will be a good boy. I am not lying this time!
-		param[i].tree   = &agg_tree[i];
-		memcpy(&agg_tree[i], &tree_init, sizeof(struct rbtree));
-	}
+/**
+ * @brief  Account a decoded flow, lookups are batched if the thread uses
+ *         neither cache, block, ART nor shards
+ *
+ * @param flow flow to account
+ * @param batch batch of the thread
+ * @param param thread parameters holding index
+ *
+ * @return   flow to decode the next record to
+ */
+static inline
+Flow * batch_add(Flow * flow, struct flow_batch * batch, struct Aggregation::thread_param * param) {
+	if (param->router || param->cache || param->block || param->art)
+		return lookup_or_insert(flow, param) ? new Flow : flow;
 
-#ifdef LINEAR
-	// linear...
-	for (auto l = Filepool::getInstance().list.end; l; l = l->prev) {
-		struct thread_param param { l, &agg_all};
-		agg_fun(&param);
-	}
-#else
+	batch->flows[batch->count++] = flow;
+	if (batch->count == FLOW_BATCH)
+		batch_lookup(batch, param);
 
-	int count1 = 0;
-	int count2 = 0;
+	if (batch->spare_count)
+		return batch->spare[--batch->spare_count];
 
-	for (auto l = Filepool::getInstance().list.end; l; /*l = 2*THREAD_COUNT times l->prev*/) {
-		for (count1 = 0; count1 < THREAD_COUNT && l; l = l->prev, count1++) {
-			param[count1].node = l;
+	return new Flow;
+}
 
-			if(pthread_create(&thread[count1], NULL, (void * (*)(void *))agg_fun, &param[count1])) {
-				err() << "Unable to create thread!\n"; perror("pthread");
-				return false;
+/**
+ * @brief  Look up flows left in a batch and free spare flows, called at
+ *         the end of a file
+ *
+ * @param flow carrier flow
+ * @param batch batch to flush
+ * @param param thread parameters holding index
+ *
+ * @return   carrier flow to be used (and freed) by the caller
+ */
+static
+Flow * batch_flush(Flow * flow, struct flow_batch * batch, struct Aggregation::thread_param * param) {
+	if (batch->count)
+		batch_lookup(batch, param);
+
+	while (batch->spare_count)
+		delete batch->spare[--batch->spare_count];
+
+	return flow;
+}
+
+/**
+ * @brief  Flows collected from shared map
+ */
+struct shared_list {
+	Flow ** flows;
+	size_t count;
+	const struct shared_map * map;
+};
+
+/**
+ * @brief  Create flow for a key stored in shared map
+ *
+ * @param key key of the flow
+ * @param packets summed packets
+ * @param bytes summed bytes
+ * @param data shared_list collecting flows
+ */
+static
+void shared_collect_flow(const uint8_t * key, uint64_t packets, uint64_t bytes, void * data) {
+	struct shared_list * list = (struct shared_list *) data;
+	Flow * record = new Flow;
+
+	memset(&record->data, 0, sizeof(struct Flow::data));
+	memcpy(((char *) record) + list->map->key_offset, key, list->map->key_len);
+	record->data.packets = packets;
+	record->data.bytes = bytes;
+	list->flows[list->count++] = record;
+}
+
+/**
+ * @brief  Turn shared map into a sorted list of flows
+ *
+ * @param map map to convert
+ * @param cmp compare function defining order
+ * @param list list to store
+ */
+static
+void shared_to_list(const struct shared_map * map, rbtree_cmp_fn_t cmp, struct flow_list * list) {
+	struct shared_list collected;
+
+	collected.flows = new Flow *[std::min(map->size, map->limit)];
+	collected.count = 0;
+	collected.map = map;
+	shared_map_iter(map, shared_collect_flow, &collected);
+
+	std::sort(collected.flows, collected.flows + collected.count,
+		[cmp](const Flow * a, const Flow * b) { return cmp(&a->node_agg, &b->node_agg) < 0; });
+
+	list->head = NULL;
+	list->tail = &list->head;
+	list->count = collected.count;
+
+	for (size_t i = 0; i < collected.count; ++i) {
+		collected.flows[i]->node_agg.right = NULL;
+		*list->tail = &collected.flows[i]->node_agg;
+		list->tail = &collected.flows[i]->node_agg.right;
+	}
+
+	delete [] collected.flows;
+}
+
+/**
+ * @brief  Unlink aggregation index of a thread into a sorted list, the
+ *         index is left empty
+ *
+ * @param param thread parameters holding index
+ * @param list list to store
+ */
+static inline
+void index_to_list(struct Aggregation::thread_param * param, struct flow_list * list) {
+	if (param->art) {
+		list->head = NULL;
+		list->tail = &list->head;
+		list->count = 0;
+		art_iter(param->art, art_list_flow, list);
+		art_destroy(param->art);
+	} else
+		list->head = rbtree_to_list(param->tree, &list->count);
+}
+
+/**
+ * @brief  Write aggregation index of a thread to a sorted run on disk, the
+ *         index is left empty
+ *
+ * @param param thread parameters holding index and runs
+ *
+ * @return   false if the run could not be written
+ */
+static
+bool spill_index(struct Aggregation::thread_param * param) {
+	struct flow_list list;
+	FILE * f;
+	bool ok;
+
+	if (! param->flows)
+		return true;
+
+	ok = (f = spill_open()) != NULL;
+
+	index_to_list(param, &list);
+	if (param->art)
+		art_init(param->art, param->art->key_len, param->art->key_offset);
+
+	for (struct rbtree_node * node = list.head; node; /**/) {
+		Flow * flow = rbtree_container_of(node, Flow, node_agg);
+
+		node = node->right;
+		ok = ok && spill_write(f, flow);
+		delete flow;
+	}
+
+	param->flows = 0;
+
+	if (! ok) {
+		err() << "Unable to write spill file!\n";
+		if (f)
+			fclose(f);
+		param->failed = true;
+		return false;
+	}
+
+	param->runs.push_back(f);
+	return true;
+}
+
+/**
+ * @brief  Compare spilled flows by aggregation key
+ *
+ * @param data pointer to rbtree_cmp_fn_t
+ */
+static
+int spill_cmp_key(const Flow * a, const Flow * b, const void * data) {
+	return (*(const rbtree_cmp_fn_t *) data)(&a->node_agg, &b->node_agg);
+}
+
+/**
+ * @brief  Compare spilled flows by sort metric
+ *
+ * @param data pointer to bstree_cmp_fn_t
+ */
+static
+int spill_cmp_sort(const Flow * a, const Flow * b, const void * data) {
+	return (*(const bstree_cmp_fn_t *) data)(&a->node_sort, &b->node_sort);
+}
+
+/**
+ * @brief  Sort flows by metric and write them to a run, flows are freed
+ *
+ * @param chunk flows to write
+ * @param cmp sort compare function
+ * @param runs run is appended here
+ *
+ * @return   false on write error
+ */
+static
+bool spill_chunk(std::vector<Flow *> & chunk, bstree_cmp_fn_t cmp, std::vector<FILE *> & runs) {
+	FILE * f = spill_open();
+	bool ok = f != NULL;
+
+	std::sort(chunk.begin(), chunk.end(), [cmp](const Flow * a, const Flow * b) {
+		return cmp(&a->node_sort, &b->node_sort) < 0;
+	});
+
+	for (auto flow : chunk) {
+		ok = ok && spill_write(f, flow);
+		delete flow;
+	}
+	chunk.clear();
+
+	if (! ok) {
+		err() << "Unable to write spill file!\n";
+		if (f)
+			fclose(f);
+		return false;
+	}
+
+	runs.push_back(f);
+	return true;
+}
+
+/**
+ * @brief  Merge runs spilled by workers and print the result
+ *
+ * Runs are merged by key and flows with the same key summed. Sorted by key
+ * they are printed right away, otherwise unique flows are collected in
+ * chunks bounded by the memory limit, every chunk is sorted by metric and
+ * spilled again if needed, and the chunks are merged by metric.
+ *
+ * @param runs runs sorted by key
+ * @param key_cmp key compare function
+ * @param sort_cmp metric compare function, NULL for key sort
+ * @param print_fun function used for printing flow
+ *
+ * @return   false on I/O error
+ */
+static
+bool spill_output(std::vector<FILE *> & runs, rbtree_cmp_fn_t key_cmp,
+						bstree_cmp_fn_t sort_cmp, void (* print_fun)(const Flow *)) {
+	size_t capacity = std::max<uint64_t>(1024, Param::mem_limit() / sizeof(Flow));
+	struct spill_merge merge;
+	std::vector<Flow *> chunk;
+	std::vector<FILE *> sorted;
+	Flow * record = NULL;
+	Flow flow;
+	bool ok = true;
+
+	if (! spill_merge_init(&merge, runs, spill_cmp_key, &key_cmp))
+		return false;
+
+	while (ok) {
+		bool more = spill_merge_next(&merge, &flow);
+
+		if (more && record && ! spill_cmp_key(record, &flow, &key_cmp)) {
+			record->data.packets += flow.data.packets;
+			record->data.bytes += flow.data.bytes;
+			continue;
+		}
+
+		if (record) {
+			if (! sort_cmp) {
+				print_fun(record);
+				delete record;
+			} else {
+				chunk.push_back(record);
+				if (chunk.size() == capacity)
+					ok = spill_chunk(chunk, sort_cmp, sorted);
+			}
+			record = NULL;
+		}
+
+		if (! more)
+			break;
+
+		record = new Flow;
+		memcpy(&record->data, &flow.data, sizeof(flow.data));
+	}
+
+	spill_merge_free(&merge);
+
+	if (! ok || ! sort_cmp)
+		return ok;
+
+	// everything fits into one chunk, no need to go through disk again
+	if (sorted.empty()) {
+		std::sort(chunk.begin(), chunk.end(), [sort_cmp](const Flow * a, const Flow * b) {
+			return sort_cmp(&a->node_sort, &b->node_sort) < 0;
+		});
+
+		for (auto f : chunk) {
+			print_fun(f);
+			delete f;
+		}
+
+		return true;
+	}
+
+	if (! chunk.empty() && ! spill_chunk(chunk, sort_cmp, sorted))
+		return false;
+
+	if (! spill_merge_init(&merge, sorted, spill_cmp_sort, &sort_cmp))
+		return false;
+
+	while (spill_merge_next(&merge, &flow))
+		print_fun(&flow);
+
+	spill_merge_free(&merge);
+	return true;
+}
+
+/**
+ * @brief  Context of snapshot write or load
+ */
+struct snapshot_ctx {
+	struct snapshot_writer w;
+	size_t key_offset;
+	struct Aggregation::thread_param * param;	///< index records are loaded to
+};
+
+/**
+ * @brief  Checkpointing state of run()
+ */
+struct checkpoint_state {
+	pid_t child;							///< process writing snapshot, 0 if none
+	time_t last;							///< time of the last snapshot
+	std::vector<std::string> done;	///< completed files
+};
+
+/**
+ * @brief  Write flow to snapshot
+ *
+ * @param value Flow to write
+ * @param data snapshot_ctx
+ */
+static
+void snapshot_flow(void * value, void * data) {
+	struct snapshot_ctx * ctx = (struct snapshot_ctx *) data;
+	Flow * flow = (Flow *) value;
+
+	snapshot_record(&ctx->w, (const uint8_t *) flow + ctx->key_offset,
+							flow->data.packets, flow->data.bytes);
+}
+
+/**
+ * @brief  Write key of shared map to snapshot
+ */
+static
+void snapshot_shared(const uint8_t * key, uint64_t packets, uint64_t bytes, void * data) {
+	snapshot_record((struct snapshot_writer *) data, key, packets, bytes);
+}
+
+/**
+ * @brief  Insert snapshot record to the index
+ */
+static
+void snapshot_insert(const uint8_t * key, uint64_t packets, uint64_t bytes, void * data) {
+	struct snapshot_ctx * ctx = (struct snapshot_ctx *) data;
+	Flow * flow = new Flow;
+
+	memset(&flow->data, 0, sizeof(flow->data));
+	memcpy((uint8_t *) flow + ctx->key_offset, key, ctx->w.key_len);
+	flow->data.packets = packets;
+	flow->data.bytes = bytes;
+
+	if (! index_lookup_or_insert(flow, ctx->param))
+		delete flow;
+}
+
+/**
+ * @brief  Write snapshot of all indexes and pending blocks
+ *
+ * @param param thread parameters
+ * @param done completed files
+ * @param key_len key length in bytes
+ * @param key_offset key offset inside Flow
+ *
+ * @return   false on error
+ */
+static
+bool snapshot_write(struct Aggregation::thread_param * param, const std::vector<std::string> & done,
+							unsigned key_len, size_t key_offset) {
+	struct snapshot_ctx ctx;
+
+	ctx.key_offset = key_offset;
+	if (! snapshot_begin(&ctx.w, Param::checkpoint(), Param::aggregation(),
+								Param::getInstance().mask(), key_len, done))
+		return false;
+
+	if (param[0].shared)
+		shared_map_iter(param[0].shared, snapshot_shared, &ctx.w);
+
+	for (int i = 0; i < THREAD_COUNT; ++i) {
+		if (param[i].art)
+			art_iter(param[i].art, snapshot_flow, &ctx);
+		else
+			for (struct rbtree_node * node = rbtree_first(param[i].tree); node; node = rbtree_next(node))
+				snapshot_flow(rbtree_container_of(node, Flow, node_agg), &ctx);
+
+		if (param[i].block)
+			for (unsigned j = 0; j < param[i].block->size; ++j) {
+				struct block_entry * e = &param[i].block->entries[j];
+				snapshot_record(&ctx.w, e->key, e->packets, e->bytes);
+			}
+	}
+
+	return snapshot_end(&ctx.w, Param::checkpoint());
+}
+
+/**
+ * @brief  Reap process writing snapshot
+ *
+ * @param cp checkpoint state
+ * @param block wait for the process to finish
+ *
+ * @return   false if the process is still running
+ */
+static
+bool checkpoint_reap(struct checkpoint_state * cp, bool block) {
+	int status;
+
+	if (! cp->child)
+		return true;
+
+	if (waitpid(cp->child, &status, block ? 0 : WNOHANG) == 0)
+		return false;
+
+	if (! WIFEXITED(status) || WEXITSTATUS(status))
+		warn() << "Writing checkpoint '" << Param::checkpoint() << "' failed\n";
+
+	cp->child = 0;
+	return true;
+}
+
+/**
+ * @brief  Take snapshot if checkpoint interval elapsed
+ *
+ * Called between rounds when no worker runs. The snapshot is written by
+ * a forked process from its copy-on-write view of the indexes, so workers
+ * of the next round are not stalled.
+ *
+ * @param cp checkpoint state
+ * @param param thread parameters
+ * @param key_len key length in bytes
+ * @param key_offset key offset inside Flow
+ */
+static
+void checkpoint(struct checkpoint_state * cp, struct Aggregation::thread_param * param,
+					unsigned key_len, size_t key_offset) {
+	pid_t pid;
+
+	if (time(NULL) - cp->last < (time_t) Param::checkpoint_interval())
+		return;
+
+	// previous snapshot is still being written
+	if (! checkpoint_reap(cp, false))
+		return;
+
+	fflush(stdout);
+	fflush(stderr);
+
+	if ((pid = fork()) < 0) {
+		warn() << "Unable to fork checkpoint writer!\n";
+		return;
+	}
+
+	if (pid == 0)
+		_exit(snapshot_write(param, cp->done, key_len, key_offset) ? 0 : 1);
+
+	cp->child = pid;
+	cp->last = time(NULL);
+}
+
+/**
+ * @brief  Merge two sorted lists in linear time, flows with the same key
+ *         are summed up and duplicates freed
+ *
+ * @param param lists to merge, result is stored to param->a
+ *
+ * @return   NULL
+ */
+static
+void * merge_lists(struct merge_param * param) {
+	struct rbtree_node * a = param->a.head;
+	struct rbtree_node * b = param->b.head;
+	struct rbtree_node * head = NULL;
+	struct rbtree_node ** tail = &head;
+	size_t count = 0;
+
+	while (a && b) {
+		int res = param->cmp(a, b);
+
+		if (res == 0) {
+			Flow * p = rbtree_container_of(a, Flow, node_agg);
+			Flow * q = rbtree_container_of(b, Flow, node_agg);
+			p->data.packets += q->data.packets;
+			p->data.bytes += q->data.bytes;
+			b = b->right;
+			delete q;
+			res = -1;
+		}
+
+		if (res < 0) {
+			*tail = a;
+			a = a->right;
+		} else {
+			*tail = b;
+			b = b->right;
+		}
+
+		tail = &(*tail)->right;
+		count++;
+	}
+
+	for (*tail = a ? a : b; *tail; tail = &(*tail)->right)
+		count++;
+
+	param->a.head = head;
+	param->a.count = count;
+
+	return NULL;
+}
+
+/**
+ * @brief  Merge sorted lists pairwise in parallel reduction trees, one tree
+ *         per group, merges of a group run on its node
+ *
+ * @param group groups of lists to merge, result is stored to param[0]->a
+ *        of every group
+ * @param groups number of groups
+ *
+ * @return   false if thread creation failed
+ */
+static
+bool merge_reduce(struct merge_group * group, unsigned groups) {
+	pthread_t thread[THREAD_COUNT];
+
+	for (unsigned step = 1; ; step *= 2) {
+		unsigned n = 0;
+
+		for (unsigned g = 0; g < groups; ++g) {
+			for (unsigned i = 0; i + step < group[g].count; i += 2 * step, ++n) {
+				struct merge_param * param = group[g].param[i];
+				pthread_attr_t attr;
+
+				param->b = group[g].param[i + step]->a;
+				topo_thread_attr(&attr, group[g].node);
+
+				if (pthread_create(&thread[n], &attr, (void * (*)(void *))merge_lists, param)) {
+					err() << "Unable to create thread!\n"; perror("pthread");
+					return false;
+				}
+				pthread_attr_destroy(&attr);
+			}
+		}
+
+		if (! n)
+			break;
+
+		for (unsigned i = 0; i < n; ++i)
+			pthread_join(thread[i], NULL);
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Aggregate flow in single thread
+ *
+ * @param param aggregation parameters
+ *
+ * @return   NULL
+ */
+void * Aggregation::aggregate(struct thread_param * param) {
+	struct flow_batch batch;
+	Flow * flow = new Flow;
+
+	batch.count = batch.spare_count = 0;
+	flow_pool_attach(&param->pool);
+
+	while (Flow::getFlow(flow, param->node)) {
+		flow = batch_add(flow, &batch, param);
+
+		if (param->flows > param->flow_limit && ! spill_index(param))
+			break;
+	}
+
+	flow = batch_flush(flow, &batch, param);
+	flow = cache_flush(flow, param);
+	delete flow;
+
+	if (param->alert)
+		alert_flush(param->alert);
+
+	return NULL;
+}
+
+/**
+ * @brief  Aggregate flow in single thread based on dst IPv4
+ *
+ * @param param aggregation parameters
+ *
+ * @return   NULL
+ */
+void * Aggregation::aggregate_dstip4(struct thread_param * param) {
+	struct flow_batch batch;
+	Flow * flow = new Flow;
+	union mask_t mask;
+
+	get_ipv4_mask(mask, Param::getInstance().mask());
+
+	batch.count = batch.spare_count = 0;
+	flow_pool_attach(&param->pool);
+
+	while (Flow::getFlow(flow, param->node)) {
+		if (! Flow::is_ipv4_dst(flow))
+			continue;
+
+		Flow::mask_dstip4(flow, mask);
+
+		flow = batch_add(flow, &batch, param);
+
+		if (param->flows > param->flow_limit && ! spill_index(param))
+			break;
+	}
+
+	flow = batch_flush(flow, &batch, param);
+	flow = cache_flush(flow, param);
+	delete flow;
+
+	if (param->alert)
+		alert_flush(param->alert);
+
+	return NULL;
+}
+
+/**
+ * @brief  Aggregate flow in single thread based on dst IPv6
+ *
+ * @param param aggregation parameters
+ *
+ * @return   NULL
+ */
+void * Aggregation::aggregate_dstip6(struct thread_param * param) {
+	struct flow_batch batch;
+	Flow * flow = new Flow;
+	union mask_t mask;
+
+	get_ipv6_mask(mask, Param::getInstance().mask());
+
+	batch.count = batch.spare_count = 0;
+	flow_pool_attach(&param->pool);
+
+	while (Flow::getFlow(flow, param->node)) {
+		if (! Flow::is_ipv6_dst(flow))
+			continue;
+
+		Flow::mask_dstip6(flow, mask);
+
+		flow = batch_add(flow, &batch, param);
+
+		if (param->flows > param->flow_limit && ! spill_index(param))
+			break;
+	}
+
+	flow = batch_flush(flow, &batch, param);
+	flow = cache_flush(flow, param);
+	delete flow;
+
+	if (param->alert)
+		alert_flush(param->alert);
+
+	return NULL;
+}
+
+/**
+ * @brief  Aggregate flow in single thread based on src IPv4
+ *
+ * @param param aggregation parameters
+ *
+ * @return   NULL
+ */
+void * Aggregation::aggregate_srcip4(struct thread_param * param) {
+	struct flow_batch batch;
+	Flow * flow = new Flow;
+	union mask_t mask;
+
+	get_ipv4_mask(mask, Param::getInstance().mask());
+
+	batch.count = batch.spare_count = 0;
+	flow_pool_attach(&param->pool);
+
+	while (Flow::getFlow(flow, param->node)) {
+		if (! Flow::is_ipv4_src(flow))
+			continue;
+
+		Flow::mask_srcip4(flow, mask);
+
+		flow = batch_add(flow, &batch, param);
+
+		if (param->flows > param->flow_limit && ! spill_index(param))
+			break;
+	}
+
+	flow = batch_flush(flow, &batch, param);
+	flow = cache_flush(flow, param);
+	delete flow;
+
+	if (param->alert)
+		alert_flush(param->alert);
+
+	return NULL;
+}
+
+/**
+ * @brief  Aggregate flow in single thread based on src IPv6
+ *
+ * @param param aggregation parameters
+ *
+ * @return   NULL
+ */
+void * Aggregation::aggregate_srcip6(struct thread_param * param) {
+	struct flow_batch batch;
+	Flow * flow = new Flow;
+	union mask_t mask;
+
+	get_ipv6_mask(mask, Param::getInstance().mask());
+
+	batch.count = batch.spare_count = 0;
+	flow_pool_attach(&param->pool);
+
+	while (Flow::getFlow(flow, param->node)) {
+		if (! Flow::is_ipv6_src(flow))
+			continue;
+
+		Flow::mask_srcip6(flow, mask);
+
+		flow = batch_add(flow, &batch, param);
+
+		if (param->flows > param->flow_limit && ! spill_index(param))
+			break;
+	}
+
+	flow = batch_flush(flow, &batch, param);
+	flow = cache_flush(flow, param);
+	delete flow;
+
+	if (param->alert)
+		alert_flush(param->alert);
+
+	return NULL;
+}
+
+#define SHARED_KEYS		(1 << 16)		// keys of shared map of unknown domain
+
+/**
+ * @brief  Estimate number of keys taken by shared map
+ *
+ * Keys can not outnumber records nor the key domain of masked and port
+ * aggregations. At most SHARED_KEYS (or --shared-keys) keys are taken,
+ * the map is meant for few hot keys and the rest is kept by per-thread
+ * indexes.
+ *
+ * @param records number of records aggregated
+ * @param key_len key length in bytes
+ *
+ * @return   number of keys
+ */
+static
+size_t shared_keys(uint64_t records, unsigned key_len) {
+	uint64_t domain = UINT64_MAX;
+
+	if (key_len == sizeof(uint16_t))
+		domain = Aggregation::PORT_COUNT;
+	else if ((Param::aggregation() == Param::AGG_SRCIP4
+				|| Param::aggregation() == Param::AGG_DSTIP4) && Param::getInstance().mask() < 32)
+		domain = 1ULL << Param::getInstance().mask();
+
+	uint64_t keys = Param::shared_keys() ? Param::shared_keys() : SHARED_KEYS;
+
+	return std::max<uint64_t>(std::min(std::min(keys, domain), records), 256);
+}
+
+static struct partial_writer partial_out;		///< partial output
+static size_t partial_key_offset;				///< key position of printed flows
+
+/**
+ * @brief  Append flow to partial output, used instead of printing
+ *
+ * @param flow flow to store
+ */
+static
+void print_partial(const Flow * flow) {
+	partial_write(&partial_out, (const uint8_t *) flow + partial_key_offset,
+						flow->data.packets, flow->data.bytes);
+}
+
+/**
+ * @brief  Partial has no header to print
+ */
+static
+void print_partial_header() {
+}
+
+/**
+ * @brief  Open partial output given by Param
+ *
+ * @param aggregation aggregation stored in partial
+ * @param mask mask stored in partial
+ * @param key_len key length in bytes
+ * @param key_offset key offset inside Flow
+ *
+ * @return   false on error
+ */
+static
+bool partial_begin(unsigned aggregation, unsigned mask, unsigned key_len, size_t key_offset) {
+	FILE * f;
+
+	if (! (f = fopen(Param::partial(), "wb"))) {
+		perror(Param::partial());
+		return false;
+	}
+
+	partial_key_offset = key_offset;
+
+	if (! partial_open(&partial_out, f, aggregation, mask, key_len)) {
+		err() << "Unable to write partial '" << Param::partial() << "'!\n";
+		fclose(f);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Finish partial output if any
+ *
+ * @return   false on error
+ */
+static
+bool partial_end() {
+	if (! Param::partial())
+		return true;
+
+	if (! partial_close(&partial_out)) {
+		err() << "Unable to write partial '" << Param::partial() << "'!\n";
+		return false;
+	}
+
+	return true;
+}
+
+#ifndef SHARD_BLOCK
+#define SHARD_BLOCK		(1 << 16)
+#endif
+
+/**
+ * @brief  Worker process owning a shard
+ *
+ * Keys received are combined in a block and aggregated in the index of
+ * param. When the coordinator stops sending, the result is sent back
+ * sorted by sort_cmp, or by key if sort_cmp is NULL.
+ *
+ * @param param thread parameters holding empty index
+ * @param shard shard index
+ * @param fd socket connected to coordinator
+ * @param sort_cmp metric compare function, NULL for key sort
+ * @param key_len key length in bytes
+ * @param key_offset key offset inside Flow
+ *
+ * @return   false on I/O error
+ */
+static
+bool shard_worker(struct Aggregation::thread_param * param, unsigned shard, int fd,
+						bstree_cmp_fn_t sort_cmp, unsigned key_len, size_t key_offset) {
+	struct block block;
+	struct flow_list list;
+	std::vector<Flow *> sorted;
+	FILE * in = fdopen(fd, "rb");
+	FILE * out = fdopen(dup(fd), "wb");
+	size_t got;
+	bool ok;
+
+	if (! in || ! out)
+		return false;
+
+	block_init(&block, Param::block() ? Param::block() : SHARD_BLOCK, key_len, key_offset);
+	param->block = &block;
+	flow_pool_attach(&param->pool);
+
+	// batches carry whole entries, the block is flushed when full
+	while ((got = fread(&block.entries[block.size], sizeof(struct block_entry),
+						block.capacity - block.size, in)) > 0) {
+		block.size += got;
+		if (block.size == block.capacity)
+			block_flush(param);
+	}
+
+	ok = ! ferror(in);
+	block_flush(param);
+	block_free(&block);
+	param->block = NULL;
+
+	index_to_list(param, &list);
+
+	if (Param::stats())
+		std::cerr << "shard " << shard << ": " << list.count << " keys\n";
+
+	for (struct rbtree_node * node = list.head; node; /**/) {
+		Flow * flow = rbtree_container_of(node, Flow, node_agg);
+
+		node = node->right;
+		if (sort_cmp) {
+			sorted.push_back(flow);
+		} else {
+			ok = ok && spill_write(out, flow);
+			delete flow;
+		}
+	}
+
+	std::sort(sorted.begin(), sorted.end(), [sort_cmp](const Flow * a, const Flow * b) {
+		return sort_cmp(&a->node_sort, &b->node_sort) < 0;
+	});
+
+	for (auto flow : sorted) {
+		ok = ok && spill_write(out, flow);
+		delete flow;
+	}
+
+	ok = (fclose(out) == 0) && ok;
+	fclose(in);
+
+	return ok;
+}
+
+/**
+ * @brief  Aggregate in worker processes owning hash ranges of keys
+ *
+ * Reader threads decode and mask records and route keys to owners. Shards
+ * are disjoint, so their sorted results are only merged, not combined.
+ *
+ * @param param thread parameters of readers
+ * @param agg_fun thread aggregation routine
+ * @param key_len key length in bytes
+ * @param key_offset key offset inside Flow
+ * @param key_cmp key compare function
+ * @param sort_cmp metric compare function, NULL for key sort
+ * @param print_fun function used for printing flow
+ * @param print_fun_header output header
+ *
+ * @return   false if a worker failed
+ */
+static
+bool shard_run(struct Aggregation::thread_param * param,
+					void * (* agg_fun)(struct Aggregation::thread_param *),
+					unsigned key_len, size_t key_offset,
+					rbtree_cmp_fn_t key_cmp, bstree_cmp_fn_t sort_cmp,
+					void (* print_fun)(const Flow *), void (* print_fun_header)()) {
+	unsigned shards = Param::shards();
+	struct shard_link links[SHARD_MAX];				// sockets of workers
+	struct shard_router router[THREAD_COUNT];		// batches of every reader
+	pid_t pid[SHARD_MAX];
+	pthread_t thread[THREAD_COUNT];
+	std::vector<FILE *> results;
+	struct spill_merge merge;
+	Flow flow;
+	bool ok = true;
+
+	assert(shards <= SHARD_MAX);
+
+	// children must not inherit pending output
+	std::cout.flush();
+
+	for (unsigned s = 0; s < shards; ++s) {
+		int sv[2];
+
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+			perror("socketpair");
+			shards = s;
+			ok = false;
+			break;
+		}
+
+		if ((pid[s] = fork()) == 0) {
+			close(sv[0]);
+			for (unsigned j = 0; j < s; ++j)
+				close(links[j].fd);
+			_exit(shard_worker(&param[0], s, sv[1], sort_cmp, key_len, key_offset) ? 0 : 1);
+		}
+
+		close(sv[1]);
+
+		if (pid[s] < 0) {
+			perror("fork");
+			close(sv[0]);
+			shards = s;
+			ok = false;
+			break;
+		}
+
+		links[s].fd = sv[0];
+		pthread_mutex_init(&links[s].mutex, NULL);
+	}
+
+	for (int i = 0; i < THREAD_COUNT; ++i) {
+		shard_router_init(&router[i], links, shards, key_len, key_offset);
+		param[i].router = &router[i];
+	}
+
+	int count = 0;
+
+	for (auto l = Filepool::getInstance().list.end; ok && l; /*l = THREAD_COUNT times l->prev*/) {
+		for (count = 0; count < THREAD_COUNT && l; l = l->prev, count++) {
+			pthread_attr_t attr;
+
+			param[count].node = l;
+			topo_thread_attr(&attr, param[count].numa_node);
+
+			if(pthread_create(&thread[count], &attr, (void * (*)(void *))agg_fun, &param[count])) {
+				err() << "Unable to create thread!\n"; perror("pthread");
+				ok = false;
+				break;
+			}
+			pthread_attr_destroy(&attr);
+		}
+
+		for (int i = 0; i < count; ++i)
+			pthread_join(thread[i], NULL);
+	}
+
+	for (int i = 0; i < THREAD_COUNT; ++i) {
+		ok = shard_router_free(&router[i]) && ok;
+		param[i].router = NULL;
+	}
+
+	// workers see end of input and answer
+	for (unsigned s = 0; s < shards; ++s) {
+		FILE * f;
+
+		shutdown(links[s].fd, SHUT_WR);
+		pthread_mutex_destroy(&links[s].mutex);
+
+		if ((f = fdopen(links[s].fd, "rb"))) {
+			results.push_back(f);
+		} else {
+			close(links[s].fd);
+			ok = false;
+		}
+	}
+
+	if (ok && spill_merge_init(&merge, results, sort_cmp ? spill_cmp_sort : spill_cmp_key,
+									sort_cmp ? (const void *) &sort_cmp : (const void *) &key_cmp)) {
+		print_fun_header();
+
+		while (spill_merge_next(&merge, &flow))
+			print_fun(&flow);
+
+		spill_merge_free(&merge);
+	} else {
+		for (auto f : results)
+			fclose(f);
+		ok = false;
+	}
+
+	for (unsigned s = 0; s < shards; ++s) {
+		int status;
+
+		if (waitpid(pid[s], &status, 0) != pid[s] || ! WIFEXITED(status) || WEXITSTATUS(status)) {
+			err() << "Shard " << s << " failed!\n";
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+/**
+ * @brief  Aggregation entry point
+ *
+ * @return   false if aggregation failed (e.g. thread create failed)
+ */
+bool Aggregation::run() {
+	struct bstree sort_tree;							// tree used for sorting
+	struct rbtree agg_all;								// tree used for temporary/continous result
+	pthread_t thread[THREAD_COUNT];					// threads
+	struct rbtree agg_tree[THREAD_COUNT];			// aggregation threes for every thread
+	struct thread_param param[THREAD_COUNT];		// thread parameters
+	struct rbtree tree_init;							// tree used for initialization
+	struct art_tree art_tree[THREAD_COUNT];		// ART for every thread
+	struct merge_param merge[THREAD_COUNT];		// per-thread results to merge
+	struct alert_batch alert[THREAD_COUNT];		// candidate alert updates of every thread
+	struct shared_map shared;							// map shared by all threads
+	struct hot_cache cache[THREAD_COUNT];			// front cache of every thread
+	struct block block[THREAD_COUNT];				// pre-aggregation block of every thread
+	struct merge_group group[TOPO_MAX_NODES];		// merge trees, one per NUMA node
+	struct checkpoint_state cp;						// periodic snapshots
+	unsigned groups = 1;
+	bool numa = false;
+
+	void (* print_fun)(const Flow *) = NULL;				// function used for printing flow
+	void (* print_fun_header)() = NULL;						// output header
+	void * (* agg_fun)(struct thread_param *) = NULL;	// thread aggregation routine
+	union rbfun_t cmp_fn;							// compare function used for comparing nodes in rbtree
+	size_t key_offset = 0;							// ART key position in Flow
+	unsigned key_len = sizeof(struct in6_addr);	// ART key length
+
+	// compacted segments are merged as streams, no index is built
+	if (Param::engine() == Param::ENGINE_SORTED)
+		return run_sorted();
+
+	/*
+	 * Initialize all variables. The decision based on AGG/SORT is traversed only
+	 * once, using function pointers to boost the speed.
+	 */
+	switch (Param::aggregation()) {
+		// with USE_PORTMAP only reached when checkpointing
+		case Param::AGG_SRCPORT:
+				key_offset = KEY_OFFSET(src_port);
+				key_len = sizeof(uint16_t);
+				cmp_fn = RBFUN(cmp_srcport);
+				print_fun = Flow::print_srcport;
+				print_fun_header = Flow::print_srcport_header;
+				agg_fun = aggregate;
+				break;
+		case Param::AGG_DSTPORT:
+				key_offset = KEY_OFFSET(dst_port);
+				key_len = sizeof(uint16_t);
+				cmp_fn = RBFUN(cmp_dstport);
+				print_fun = Flow::print_dstport;
+				print_fun_header = Flow::print_dstport_header;
+				agg_fun = aggregate;
+				break;
+		case Param::AGG_SRCIP:
+				key_offset = KEY_OFFSET(src_addr);
+				cmp_fn = RBFUN(cmp_srcip);
+				print_fun = Flow::print_srcip;
+				print_fun_header = Flow::print_srcip_header;
+				agg_fun = aggregate;
+				break;
+		case Param::AGG_SRCIP4:
+				key_offset = KEY_OFFSET(src_addr);
+				cmp_fn = RBFUN(cmp_srcip4_mask);
+				print_fun = Flow::print_srcip;
+				print_fun_header = Flow::print_srcip_header;
+				agg_fun = aggregate_srcip4;
+				break;
+		case Param::AGG_SRCIP6:
+				key_offset = KEY_OFFSET(src_addr);
+				cmp_fn = RBFUN(cmp_srcip6_mask);
+				print_fun = Flow::print_srcip;
+				print_fun_header = Flow::print_srcip_header;
+				agg_fun = aggregate_srcip6;
+				break;
+		case Param::AGG_DSTIP:
+				key_offset = KEY_OFFSET(dst_addr);
+				cmp_fn = RBFUN(cmp_dstip);
+				print_fun = Flow::print_dstip;
+				print_fun_header = Flow::print_dstip_header;
+				agg_fun = aggregate;
+				break;
+		case Param::AGG_DSTIP4:
+				key_offset = KEY_OFFSET(dst_addr);
+				cmp_fn = RBFUN(cmp_dstip4_mask);
+				print_fun = Flow::print_dstip;
+				print_fun_header = Flow::print_dstip_header;
+				agg_fun = aggregate_dstip4;
+				break;
+		case Param::AGG_DSTIP6:
+				key_offset = KEY_OFFSET(dst_addr);
+				cmp_fn = RBFUN(cmp_dstip6_mask);
+				print_fun = Flow::print_dstip;
+				print_fun_header = Flow::print_dstip_header;
+				agg_fun = aggregate_dstip6;
+				break;
+		default:
+				assert(! "Unknown aggregation type!\n");
+				break;
+	}
+
+	switch (Param::sort()) {
+		case Param::SORT_BYTES:
+			bstree_init(&sort_tree, cmp_bytes);
+			break;
+		case Param::SORT_PACKETS:
+			bstree_init(&sort_tree, cmp_packets);
+			break;
+		case Param::SORT_KEY:
+			break;
+		default:
+			assert(! "Unknown sort type!\n");
+			break;
+	}
+
+	// partial takes the key ordered result instead of printing
+	if (Param::partial()) {
+		if (! partial_begin(Param::aggregation(), Param::getInstance().mask(), key_len, key_offset))
+			return false;
+		print_fun = print_partial;
+		print_fun_header = print_partial_header;
+	}
+
+	rbtree_init(&tree_init, cmp_fn,
+					Param::getInstance().aggregation());
+
+	memcpy(&agg_all, &tree_init, sizeof(struct rbtree));
+
+	if (Param::engine() == Param::ENGINE_SHARED) {
+		if (! shared_map_init(&shared,
+					shared_keys(Filepool::getInstance().size() / sizeof(struct Flow::data), key_len),
+					THREAD_COUNT, key_len, key_offset)) {
+			err() << "Unable to allocate shared aggregation map!\n";
+			return false;
+		}
+	}
+
+	if (Param::numa()) {
+		if (topo_init(THREAD_COUNT))
+			numa = true;
+		else
+			warn() << "NUMA topology not available, workers are not pinned\n";
+	}
+
+	for (int i = 0; i < THREAD_COUNT; ++i) {
+		// Hey, Mr. Compiler! Are you reading this? Unroll the loop please! Do it
+		// for me, I swear I will be a good boy. I am not lying this time!
+		param[i].tree   = &agg_tree[i];
+		param[i].art    = NULL;
+		param[i].shared = NULL;
+		param[i].stripe = i;
+		param[i].cache  = NULL;
+		param[i].block  = NULL;
+		param[i].key_delta = (ptrdiff_t) key_offset - (ptrdiff_t) offsetof(Flow, node_agg);
+		param[i].numa_node = numa ? topo_slot_node(i) : -1;
+		param[i].flows  = 0;
+		param[i].failed = false;
+		param[i].flow_limit = SIZE_MAX;
+		param[i].router = NULL;
+		param[i].alert  = NULL;
+
+#if THREAD_COUNT > 1 && ! defined(LINEAR)
+		if (Param::alert()) {
+			alert_batch_init(&alert[i], THREAD_COUNT);
+			param[i].alert = &alert[i];
+		}
+#endif
+
+		if (Param::mem_limit())
+			param[i].flow_limit = std::max<uint64_t>(1,
+						Param::mem_limit() / THREAD_COUNT / sizeof(Flow));
+		memset(&param[i].pool, 0, sizeof(param[i].pool));
+
+		// with shards blocks are used by workers
+		if (Param::block() && ! Param::shards()) {
+			block_init(&block[i], Param::block(), key_len, key_offset);
+			topo_bind(block[i].entries, Param::block() * sizeof(struct block_entry), param[i].numa_node);
+			topo_bind(block[i].tmp, Param::block() * sizeof(struct block_entry), param[i].numa_node);
+			param[i].block = &block[i];
+		}
+
+		if (Param::cache()) {
+			hot_cache_init(&cache[i], Param::cache(), key_len, key_offset);
+			topo_bind(cache[i].entries, Param::cache() * sizeof(struct hot_entry), param[i].numa_node);
+			param[i].cache = &cache[i];
+		}
+		memcpy(&agg_tree[i], &tree_init, sizeof(struct rbtree));
+
+		if (Param::engine() == Param::ENGINE_SHARED)
+			param[i].shared = &shared;
+
+		if (Param::engine() == Param::ENGINE_ART) {
+			art_init(&art_tree[i], key_len, key_offset);
+			param[i].art = &art_tree[i];
+		}
+	}
+
+	if (Param::shards())
+		return shard_run(param, agg_fun, key_len, key_offset, cmp_fn.cmp_fn,
+						Param::sort() == Param::SORT_KEY ? NULL : sort_tree.cmp_fn,
+						print_fun, print_fun_header)
+			&& partial_end();
+
+	cp.child = 0;
+	cp.last = time(NULL);
+
+	if (Param::resume()) {
+		if (access(Param::checkpoint(), F_OK)) {
+			warn() << "No checkpoint '" << Param::checkpoint() << "', starting from scratch\n";
+		} else {
+			struct snapshot_ctx ctx;
+
+			ctx.w.key_len = key_len;
+			ctx.key_offset = key_offset;
+			ctx.param = &param[0];
+
+			if (! snapshot_load(Param::checkpoint(), Param::aggregation(), Param::getInstance().mask(),
+										key_len, cp.done, snapshot_insert, &ctx))
+				return false;
+
+			Filepool::getInstance().drop(std::set<std::string>(cp.done.begin(), cp.done.end()));
+		}
+	}
+
+#ifdef LINEAR
+	// linear...
+	for (auto l = Filepool::getInstance().list.end; l; l = l->prev) {
+		param[0].node = l;
+		agg_fun(&param[0]);
+
+		if (Param::checkpoint()) {
+			cp.done.push_back(l->name);
+			checkpoint(&cp, param, key_len, key_offset);
+		}
+	}
+#else
+	/*
+	 * Every thread keeps its own index across files, indexes are merged
+	 * only once when all files are processed.
+	 */
+	int count = 0;
+
+	for (auto l = Filepool::getInstance().list.end; l; /*l = THREAD_COUNT times l->prev*/) {
+		for (count = 0; count < THREAD_COUNT && l; l = l->prev, count++) {
+			pthread_attr_t attr;
+
+			param[count].node = l;
+			topo_thread_attr(&attr, param[count].numa_node);
+
+			if(pthread_create(&thread[count], &attr, (void * (*)(void *))agg_fun, &param[count])) {
+				err() << "Unable to create thread!\n"; perror("pthread");
+				return false;
+			}
+			pthread_attr_destroy(&attr);
+		}
+
+		for (int i = 0; i < count; ++i)
+			pthread_join(thread[i], NULL);
+
+		if (Param::checkpoint()) {
+			for (int i = 0; i < count; ++i)
+				cp.done.push_back(param[i].node->name);
+			checkpoint(&cp, param, key_len, key_offset);
+		}
+	}
+#endif
+
+	checkpoint_reap(&cp, true);
+
+	/*
+	 * All indexes are ordered by the same key, so they are merged as sorted
+	 * lists in a parallel reduction and the result tree is built in linear
+	 * time.
+	 */
+	bool spilled = false;
+
+	for (int i = 0; i < THREAD_COUNT; ++i) {
+		if (param[i].block) {
+			block_flush(&param[i]);
+			block_free(param[i].block);
+		}
+
+		if (param[i].cache)
+			hot_cache_free(param[i].cache);
+
+		if (param[i].alert)
+			alert_flush(param[i].alert);
+
+		if (param[i].failed)
+			return false;
+
+		spilled = spilled || ! param[i].runs.empty();
+	}
+
+	/*
+	 * Something did not fit into memory limit, the rest of indexes goes to
+	 * disk too and runs are merged there.
+	 */
+	if (spilled) {
+		std::vector<FILE *> runs;
+
+		for (int i = 0; i < THREAD_COUNT; ++i) {
+			if (! spill_index(&param[i]))
+				return false;
+			runs.insert(runs.end(), param[i].runs.begin(), param[i].runs.end());
+		}
+
+		if (Param::stats())
+			std::cerr << "spill: " << runs.size() << " runs\n";
+
+		print_fun_header();
+		return spill_output(runs, cmp_fn.cmp_fn,
+						Param::sort() == Param::SORT_KEY ? NULL : sort_tree.cmp_fn, print_fun)
+			&& partial_end();
+	}
+
+	for (int i = 0; i < THREAD_COUNT; ++i) {
+		index_to_list(&param[i], &merge[i].a);
+		merge[i].cmp = cmp_fn.cmp_fn;
+	}
+
+	if (Param::engine() == Param::ENGINE_SHARED) {
+		struct merge_param m;
+
+		if (Param::stats() && shared.overflow)
+			std::cerr << "shared: map full at " << shared.limit
+				<< " keys, other keys kept by thread indexes\n";
+
+		// keys refused by the map are merged from thread indexes
+		m.a = merge[0].a;
+		m.cmp = cmp_fn.cmp_fn;
+		shared_to_list(&shared, cmp_fn.cmp_fn, &m.b);
+		shared_map_free(&shared);
+		merge_lists(&m);
+		merge[0].a = m.a;
+	}
+
+	/*
+	 * Slots of a node are merged on that node first, only per-node results
+	 * cross sockets.
+	 */
+	if (numa) {
+		groups = topo_nodes();
+		for (unsigned g = 0; g < groups; ++g) {
+			group[g].count = 0;
+			group[g].node = g;
+		}
+
+		for (int i = 0; i < THREAD_COUNT; ++i) {
+			struct merge_group * g = &group[param[i].numa_node];
+			g->param[g->count++] = &merge[i];
+
+			if (Param::stats() && merge[i].a.head)
+				std::cerr << "numa: slot " << i << " on node " << topo_node_id(param[i].numa_node)
+					<< ", index memory on node " << topo_memory_node(merge[i].a.head) << "\n";
+		}
+	} else {
+		group[0].count = THREAD_COUNT;
+		group[0].node = -1;
+		for (int i = 0; i < THREAD_COUNT; ++i)
+			group[0].param[i] = &merge[i];
+	}
+
+	if (! merge_reduce(group, groups))
+		return false;
+
+	if (groups > 1) {
+		struct merge_group top;
+
+		top.count = 0;
+		top.node = -1;
+		for (unsigned g = 0; g < groups; ++g)
+			if (group[g].count)
+				top.param[top.count++] = group[g].param[0];
+
+		if (! merge_reduce(&top, 1))
+			return false;
+	}
+
+	assert(group[0].param[0] == &merge[0]);
+
+	// keys reaching a limit only by parts of more indexes
+	if (param[0].alert)
+		for (struct rbtree_node * node = merge[0].a.head; node; node = node->right)
+			alert_final(rbtree_container_of(node, Flow, node_agg));
+
+	rbtree_from_list(&agg_all, merge[0].a.head, merge[0].a.count);
+
+	print_fun_header();
+
+	// aggregation index is already ordered by key, no need to sort
+	if (Param::sort() == Param::SORT_KEY) {
+		rbtree_inorder_free(&agg_all, print_fun);
+		return partial_end();
+	}
+
+	// Construct binary tree
+	for (struct rbtree_node * node = rbtree_first(&agg_all); node; node = rbtree_next(node)) {
+		Flow * record = rbtree_container_of(node, Flow, node_agg);
+		bstree_insert(&record->node_sort, &sort_tree);
+	}
+	agg_all.root = agg_all.first = agg_all.last = NULL;
+
+	// traversing inorder sorted binary tree gives sorted sequence.
+	// nodes are freed within function, only one traversal needed
+	tree_inorder_free(&sort_tree, print_fun);
+
+	return true;
+}
+
+/*****************************************************************************/
+/*****************************************************************************/
+
+static inline
+void port_map_update_dst(const Flow * flow, struct Aggregation::port_map_t * map) {
+	const unsigned idx = flow->data.dst_port;
+
+	pthread_mutex_lock(&map[idx].mutex);
+	if (map[idx].valid) {
+		map[idx].flow.data.packets += flow->data.packets;
+		map[idx].flow.data.bytes += flow->data.bytes;
+	} else {
+		map[idx].valid = true;
+		memcpy(&map[idx].flow.data, &flow->data, sizeof(Flow::data));
+	}
+
+	if (Param::alert())
+		alert_check(&map[idx].flow, flow->data.packets, flow->data.bytes);
+	pthread_mutex_unlock(&map[idx].mutex);
+}
+
+
+static inline
+void port_map_update_src(const Flow * flow, struct Aggregation::port_map_t * map) {
+	const unsigned idx = flow->data.src_port;
+
+	pthread_mutex_lock(&map[idx].mutex);
+	if (map[idx].valid) {
+		map[idx].flow.data.packets += flow->data.packets;
+		map[idx].flow.data.bytes += flow->data.bytes;
+	} else {
+		map[idx].valid = true;
+		memcpy(&map[idx].flow.data, &flow->data, sizeof(struct Flow::data));
+	}
+
+	if (Param::alert())
+		alert_check(&map[idx].flow, flow->data.packets, flow->data.bytes);
+	pthread_mutex_unlock(&map[idx].mutex);
+}
+
+static
+void * aggregate_srcport(struct Aggregation::thread_param_port * param) {
+	Flow flow;
+
+	while (Flow::getFlow(&flow, param->node)) {
+		port_map_update_src(&flow, param->map);
+	}
+
+	return NULL;
+};
+
+static
+void * aggregate_dstport(struct Aggregation::thread_param_port * param) {
+	Flow flow;
+
+	while (Flow::getFlow(&flow, param->node)) {
+		port_map_update_dst(&flow, param->map);
+	}
+
+	return NULL;
+};
+
+/**
+ * @brief  Aggregation entry point
+ *
+ * @return   false if aggregation failed (e.g. thread create failed)
+ */
+bool Aggregation::run_port() {
+	struct bstree sort_tree;									// tree used for sorting
+	pthread_t thread[THREAD_COUNT];							// threads
+
+	void (* print_fun)(const Flow *) = NULL;				// function used for printing flow
+	void (* print_fun_header)() = NULL;						// output header
+	void * (* agg_fun)(struct thread_param_port *) = NULL;		// thread aggregation routine
+	struct port_map_t * port_map = NULL;
+	struct thread_param_port param[THREAD_COUNT];
+
+	port_map = (struct port_map_t *) huge_alloc(PORT_COUNT * sizeof(struct port_map_t));
+	if (! port_map) {
+		err() << "Unable to allocate port map!\n";
+		return false;
+	}
+
+	/*
+	 * Initialize all variables. The decision based on AGG/SORT is traversed only
+	 * once, using function pointers to boost the speed.
+	 */
+	switch (Param::aggregation()) {
+		case Param::AGG_SRCPORT:
+				print_fun = Flow::print_srcport;
+				print_fun_header = Flow::print_srcport_header;
+				agg_fun = aggregate_srcport;
+				break;
+		case Param::AGG_DSTPORT:
+				print_fun = Flow::print_dstport;
+				print_fun_header = Flow::print_dstport_header;
+				agg_fun = aggregate_dstport;
+				break;
+		default:
+				assert(! "Unknown aggregation type!\n");
+				break;
+	}
+
+	switch (Param::sort()) {
+		case Param::SORT_BYTES:
+			bstree_init(&sort_tree, cmp_bytes);
+			break;
+		case Param::SORT_PACKETS:
+			bstree_init(&sort_tree, cmp_packets);
+			break;
+		case Param::SORT_KEY:
+			break;
+		default:
+			assert(! "Unknown sort type!\n");
+			break;
+	}
+
+	for (auto i = 0u; i < PORT_COUNT; /**/) {
+		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
+		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
+		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
+		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
+		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
+		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
+		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
+		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
+	}
+
+	for(auto i = 0u; i < THREAD_COUNT; ++i)
+		param[i].map = port_map;
+
+	unsigned count1 = 0;
+	unsigned count2 = 0;
+	for (auto l = Filepool::getInstance().list.end; l; /*l = 2*THREAD_COUNT times l->prev*/) {
+		for (count1 = 0; count1 < THREAD_COUNT && l; l = l->prev, count1++) {
+			param[count1].node = l;
+			if(pthread_create(&thread[count1], NULL, (void * (*)(void *))agg_fun, &param[count1])) {
+				err() << "Unable to create thread!\n";
+				perror("pthread");
+				return false;
+			}
+		}
+
+		for (unsigned i = 0; i < count1; ++i)
+			pthread_join(thread[i], NULL);
+
+		for (count2 = 0; count2 < THREAD_COUNT && l; l = l->prev, count2++) {
+			param[count2].node = l;
+			if(pthread_create(&thread[count2], NULL, (void * (*)(void *))agg_fun, &param[count2])) {
+				err() << "Unable to create thread!\n";
+				perror("pthread");
+				return false;
+			}
+		}
+
+		for (unsigned i = 0; i < count2; ++i)
+			pthread_join(thread[i], NULL);
+	}
+
+	print_fun_header();
+
+	// port map is indexed by port in network byte order
+	if (Param::sort() == Param::SORT_KEY) {
+		for (auto i = 0u; i < PORT_COUNT; ++i) {
+			const unsigned idx = htons(i);
+			if (port_map[idx].valid)
+				print_fun(&port_map[idx].flow);
+		}
+
+		huge_free(port_map, PORT_COUNT * sizeof(struct port_map_t));
+		return true;
+	}
+
+	// Construct binary tree
+	for (auto i = 0u; i < PORT_COUNT; ++i) {
+		if (port_map[i].valid)
+			bstree_insert(&port_map[i].flow.node_sort, &sort_tree);
+	}
+
+	// traversing inorder sorted binary tree gives sorted sequence.
+	// nodes are freed within function, only one traversal needed
+	tree_inorder(&sort_tree, print_fun);
+
+	huge_free(port_map, PORT_COUNT * sizeof(struct port_map_t));
+
+	return true;
+}
+
+
+/*****************************************************************************/
+/*****************************************************************************/
+
+/**
+ * @brief  Reported heavy hitter, flow has to be the first member
+ */
+struct hhh_result {
+	Flow flow;
+	unsigned len;
+};
+
+const unsigned Aggregation::HHH_COUNTERS = 8;
+
+/*
+ * Space-Saving counters of all levels and threads are bounded, small
+ * fractions get fewer counters per level than HHH_COUNTERS / fraction.
+ */
+#define HHH_MAX_COUNTERS	(1u << 22)
+
+/**
+ * @brief  Convert address to HHH key
+ *
+ * @param key key to store
+ * @param addr address to convert
+ */
+static inline
+void hhh_key_from_addr(struct hhh_key * key, const struct in6_addr * addr) {
+	key->hi = __builtin_bswap64(*(const uint64_t *) &addr->s6_addr[0]);
+	key->lo = __builtin_bswap64(*(const uint64_t *) &addr->s6_addr[8]);
+}
+
+/**
+ * @brief  Convert HHH key to address
+ *
+ * @param addr address to store
+ * @param key key to convert
+ */
+static inline
+void hhh_key_to_addr(struct in6_addr * addr, const struct hhh_key * key) {
+	*(uint64_t *) &addr->s6_addr[0] = __builtin_bswap64(key->hi);
+	*(uint64_t *) &addr->s6_addr[8] = __builtin_bswap64(key->lo);
+}
+
+/**
+ * @brief  Print heavy hitter prefix
+ *
+ * @param flow hhh_result to print
+ */
+static void print_hhh(const Flow * flow) {
+	const struct hhh_result * res = (const struct hhh_result *) flow;
+	const struct in6_addr * addr;
+	char ip[INET6_ADDRSTRLEN];
+
+	addr = (Param::aggregation() == Param::AGG_SRCIP4
+				|| Param::aggregation() == Param::AGG_SRCIP6)
+			? &flow->data.src_addr : &flow->data.dst_addr;
+
+	if (Param::aggregation() == Param::AGG_SRCIP4
+			|| Param::aggregation() == Param::AGG_DSTIP4)
+		inet_ntop(AF_INET, ((const char *) addr) + 12, ip, INET6_ADDRSTRLEN);
+	else
+		inet_ntop(AF_INET6, addr, ip, INET6_ADDRSTRLEN);
+
+	std::cout << ip << "/" << res->len
+		<< "," << flow->data.packets
+		<< "," << flow->data.bytes << std::endl;
+}
+
+/**
+ * @brief  Account flows of a file on all prefix levels
+ *
+ * @param param aggregation parameters
+ *
+ * @return   NULL
+ */
+static
+void * aggregate_hhh(struct Aggregation::thread_param_hhh * param) {
+	Flow flow;
+	struct hhh_key key;
+	const bool src = Param::aggregation() == Param::AGG_SRCIP4
+							|| Param::aggregation() == Param::AGG_SRCIP6;
+	const bool ipv4 = param->hhh->width == 32;
+	const bool by_bytes = Param::sort() == Param::SORT_BYTES;
+
+	while (Flow::getFlow(&flow, param->node)) {
+		const struct in6_addr * addr;
+
+		if (src) {
+			if (Flow::is_ipv4_src(&flow) != ipv4)
+				continue;
+			addr = &flow.data.src_addr;
+		} else {
+			if (Flow::is_ipv4_dst(&flow) != ipv4)
+				continue;
+			addr = &flow.data.dst_addr;
+		}
+
+		hhh_key_from_addr(&key, addr);
+		hhh_update(param->hhh,
+						&key,
+						by_bytes ? flow.data.bytes : flow.data.packets,
+						flow.data.packets,
+						flow.data.bytes);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief  Hierarchical heavy hitters entry point
+ *
+ * Every thread slot keeps its own bounded summaries for all prefix lengths
+ * up to the requested mask, so all the levels are computed in one pass.
+ * Summaries are merged once all files are processed.
+ *
+ * @return   false if aggregation failed (e.g. thread create failed)
+ */
+bool Aggregation::run_hhh() {
+	struct bstree sort_tree;									// tree used for sorting
+	pthread_t thread[THREAD_COUNT];							// threads
+	struct hhh hhh[THREAD_COUNT];								// summaries for every thread
+	struct thread_param_hhh param[THREAD_COUNT];
+	struct hhh_item * items = NULL;
+	struct hhh_result * results = NULL;
+	void (* print_fun_header)() = NULL;						// output header
+	unsigned width = 0;
+	unsigned capacity;
+	size_t count;
+
+	switch (Param::aggregation()) {
+		case Param::AGG_SRCIP4:
+				width = 32;
+				print_fun_header = Flow::print_srcprefix_header;
+				break;
+		case Param::AGG_SRCIP6:
+				width = 128;
+				print_fun_header = Flow::print_srcprefix_header;
+				break;
+		case Param::AGG_DSTIP4:
+				width = 32;
+				print_fun_header = Flow::print_dstprefix_header;
+				break;
+		case Param::AGG_DSTIP6:
+				width = 128;
+				print_fun_header = Flow::print_dstprefix_header;
+				break;
+		default:
+				assert(! "Unknown aggregation type!\n");
+				break;
+	}
+
+	switch (Param::sort()) {
+		case Param::SORT_BYTES:
+			bstree_init(&sort_tree, cmp_bytes);
+			break;
+		case Param::SORT_PACKETS:
+			bstree_init(&sort_tree, cmp_packets);
+			break;
+		default:
+			assert(! "Unknown sort type!\n");
+			break;
+	}
+
+	// estimation error on every level is bounded by total/capacity
+	const unsigned levels = Param::getInstance().mask();
+	const unsigned max_capacity = HHH_MAX_COUNTERS / (levels * THREAD_COUNT);
+	const double wanted = HHH_COUNTERS / Param::hhh() + 1;
+
+	if (wanted > max_capacity) {
+		capacity = max_capacity;
+		warn() << "HHH counters limited to " << capacity << " per level, counts may be"
+			<< " overestimated by up to " << 1.0 / capacity << " of traffic\n";
+	} else
+		capacity = (unsigned) wanted;
+
+	for (auto i = 0u; i < THREAD_COUNT; ++i) {
+		hhh_init(&hhh[i], width, levels, capacity);
+		param[i].hhh = &hhh[i];
+	}
+
+	unsigned count1 = 0;
+	for (auto l = Filepool::getInstance().list.end; l; /*l = THREAD_COUNT times l->prev*/) {
+		for (count1 = 0; count1 < THREAD_COUNT && l; l = l->prev, count1++) {
+			param[count1].node = l;
+			if(pthread_create(&thread[count1], NULL, (void * (*)(void *))aggregate_hhh, &param[count1])) {
+				err() << "Unable to create thread!\n";
+				perror("pthread");
+				return false;
+			}
+		}
+
+		for (unsigned i = 0; i < count1; ++i)
+			pthread_join(thread[i], NULL);
+	}
+
+	for (auto i = 1u; i < THREAD_COUNT; ++i) {
+		hhh_merge(&hhh[0], &hhh[i]);
+		hhh_free(&hhh[i]);
+	}
+
+	count = hhh_output(&hhh[0], Param::hhh(), &items);
+	hhh_free(&hhh[0]);
+
+	results = new struct hhh_result[count ? count : 1];
+	for (size_t i = 0; i < count; ++i) {
+		memset(&results[i].flow.data, 0, sizeof(struct Flow::data));
+		hhh_key_to_addr(&results[i].flow.data.src_addr, &items[i].key);
+		hhh_key_to_addr(&results[i].flow.data.dst_addr, &items[i].key);
+		results[i].flow.data.packets = items[i].packets;
+		results[i].flow.data.bytes = items[i].bytes;
+		results[i].len = items[i].len;
+		bstree_insert(&results[i].flow.node_sort, &sort_tree);
+	}
+
+	print_fun_header();
+	tree_inorder(&sort_tree, print_hhh);
+
+	delete [] items;
+	delete [] results;
+
+	return true;
+}
+
+/**
+ * @brief  Partial being merged
+ */
+struct merge_input {
+	struct partial_reader r;
+	const char * name;					///< file name for error messages
+	uint8_t key[PARTIAL_KEY_MAX];		///< current record
+	uint64_t packets;
+	uint64_t bytes;
+};
+
+/**
+ * @brief  Free partials left in merge
+ *
+ * @param heap partials to free, files are owned by Filepool
+ */
+static
+void merge_inputs_free(std::vector<struct merge_input *> & heap) {
+	for (auto in : heap)
+		delete in;
+	heap.clear();
+}
+
+/**
+ * @brief  Read next record of a merged partial
+ *
+ * @param in partial to read
+ *
+ * @return   1 on success, 0 at the end, -1 on error
+ */
+static
+int merge_input_next(struct merge_input * in) {
+	int ret = partial_read(&in->r, in->key, &in->packets, &in->bytes);
+
+	if (ret < 0)
+		err() << "Partial '" << in->name << "' is broken!\n";
+
+	return ret;
+}
+
+/**
+ * @brief  Merge partials with a k-way merge and print the result sorted as
+ *         requested
+ *
+ * @param heap partials with a record read, freed
+ * @param aggregation aggregation of partials
+ * @param mask mask of partials
+ * @param partial_key_len key length of partials
+ *
+ * @return   false if partials are broken
+ */
+static
+bool merge_run(std::vector<struct merge_input *> & heap, unsigned aggregation,
+						unsigned mask, unsigned partial_key_len) {
+	struct bstree sort_tree;							// tree used for sorting
+	void (* print_fun)(const Flow *) = NULL;		// function used for printing flow
+	void (* print_fun_header)() = NULL;				// output header
+	size_t key_offset = 0;								// key position in Flow
+	unsigned key_len = sizeof(struct in6_addr);	// expected key length
+	Flow flow;
+
+	switch (aggregation) {
+		case Param::AGG_SRCPORT:
+				key_offset = KEY_OFFSET(src_port);
+				key_len = sizeof(uint16_t);
+				print_fun = Flow::print_srcport;
+				print_fun_header = Flow::print_srcport_header;
+				break;
+		case Param::AGG_DSTPORT:
+				key_offset = KEY_OFFSET(dst_port);
+				key_len = sizeof(uint16_t);
+				print_fun = Flow::print_dstport;
+				print_fun_header = Flow::print_dstport_header;
+				break;
+		case Param::AGG_SRCIP:
+		case Param::AGG_SRCIP4:
+		case Param::AGG_SRCIP6:
+				key_offset = KEY_OFFSET(src_addr);
+				print_fun = Flow::print_srcip;
+				print_fun_header = Flow::print_srcip_header;
+				break;
+		case Param::AGG_DSTIP:
+		case Param::AGG_DSTIP4:
+		case Param::AGG_DSTIP6:
+				key_offset = KEY_OFFSET(dst_addr);
+				print_fun = Flow::print_dstip;
+				print_fun_header = Flow::print_dstip_header;
+				break;
+		default:
+				key_len = 0;
+				break;
+	}
+
+	if (key_len != partial_key_len) {
+		err() << "Partials hold unknown aggregation!\n";
+		merge_inputs_free(heap);
+		return false;
+	}
+
+	switch (Param::sort()) {
+		case Param::SORT_BYTES:
+			bstree_init(&sort_tree, cmp_bytes);
+			break;
+		case Param::SORT_PACKETS:
+			bstree_init(&sort_tree, cmp_packets);
+			break;
+		case Param::SORT_KEY:
+			break;
+		default:
+			assert(! "Unknown sort type!\n");
+			break;
+	}
+
+	if (Param::partial()) {
+		if (! partial_begin(aggregation, mask, key_len, key_offset)) {
+			merge_inputs_free(heap);
+			return false;
+		}
+		print_fun = print_partial;
+		print_fun_header = print_partial_header;
+	}
+
+	// keys are compared as big-endian numbers, the same order partials use
+	auto greater = [key_len](const struct merge_input * a, const struct merge_input * b) {
+		return memcmp(a->key, b->key, key_len) > 0;
+	};
+
+	std::make_heap(heap.begin(), heap.end(), greater);
+	memset(&flow.data, 0, sizeof(flow.data));
+
+	if (Param::sort() == Param::SORT_KEY)
+		print_fun_header();
+
+	uint8_t * flow_key = (uint8_t *) &flow + key_offset;
+
+	while (! heap.empty()) {
+		memcpy(flow_key, heap.front()->key, key_len);
+		flow.data.packets = 0;
+		flow.data.bytes = 0;
+
+		// combine the key from all partials holding it
+		while (! heap.empty() && ! memcmp(heap.front()->key, flow_key, key_len)) {
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			struct merge_input * in = heap.back();
+			int ret;
+
+			flow.data.packets += in->packets;
+			flow.data.bytes += in->bytes;
+
+			if ((ret = merge_input_next(in)) > 0) {
+				std::push_heap(heap.begin(), heap.end(), greater);
+			} else {
+				heap.pop_back();
+				delete in;
+				if (ret < 0) {
+					merge_inputs_free(heap);
+					return false;
+				}
+			}
+		}
+
+		if (Param::sort() == Param::SORT_KEY) {
+			print_fun(&flow);
+		} else {
+			Flow * record = new Flow;
+			memcpy(&record->data, &flow.data, sizeof(flow.data));
+			bstree_insert(&record->node_sort, &sort_tree);
+		}
+	}
+
+	if (Param::sort() != Param::SORT_KEY) {
+		print_fun_header();
+		tree_inorder_free(&sort_tree, print_fun);
+	}
+
+	return partial_end();
+}
+
+/**
+ * @brief  Merge partials from Filepool with a k-way merge and print the
+ *         result sorted as requested
+ *
+ * @return   false if partials are broken or do not match
+ */
+bool Aggregation::run_merge() {
+	std::vector<struct merge_input *> heap;		// partials ordered by current key
+	struct partial_reader hdr;							// all partials have to match this
+	unsigned inputs = 0;
+
+	for (auto l = Filepool::getInstance().list.end; l; l = l->prev) {
+		struct merge_input * in = new struct merge_input;
+		int ret;
+
+		if (! partial_read_header(&in->r, l->f)) {
+			err() << "File '" << l->name << "' is not a partial!\n";
+			delete in;
+			merge_inputs_free(heap);
+			return false;
+		}
+
+		in->name = l->name;
+
+		if (inputs++ == 0)
+			hdr = in->r;
+		else if (in->r.aggregation != hdr.aggregation || in->r.mask != hdr.mask
+				|| in->r.key_len != hdr.key_len) {
+			err() << "Partial '" << l->name << "' was written with a different aggregation!\n";
+			delete in;
+			merge_inputs_free(heap);
+			return false;
+		}
+
+		if ((ret = merge_input_next(in)) > 0) {
+			heap.push_back(in);
+		} else {
+			delete in;
+			if (ret < 0) {
+				merge_inputs_free(heap);
+				return false;
+			}
+		}
+	}
+
+	if (! inputs) {
+		err() << "No partial to merge!\n";
+		return false;
+	}
+
+	return merge_run(heap, hdr.aggregation, hdr.mask, hdr.key_len);
+}
+
+/**
+ * @brief  Scan of a row range of the store
+ */
+struct store_scan {
+	const struct flow_store * store;
+	size_t begin;
+	size_t end;
+	struct shared_map * map;
+	unsigned stripe;
+	struct rbtree tree;							///< keys refused by shared map
+	const uint8_t * column;						///< key column
+	bool (* accept)(const Flow *);			///< row filter, NULL for all rows
+	void (* mask_fun)(Flow *, union mask_t &);	///< key mask, NULL if not masked
+	union mask_t mask;
+};
+
+/**
+ * @brief  Aggregate rows of a range in shared map, keys refused by the map
+ *         are kept by the tree of the scan
+ *
+ * @param scan scan to run
+ *
+ * @return   NULL
+ */
+static
+void * store_scan(struct store_scan * scan) {
+	const struct shared_map * map = scan->map;
+	Flow flow;
+	uint8_t * key = (uint8_t *) &flow + map->key_offset;
+
+	memset(&flow.data, 0, sizeof(flow.data));
+
+	for (size_t i = scan->begin; i < scan->end; ++i) {
+		memcpy(key, scan->column + i * map->key_len, map->key_len);
+
+		if (scan->accept && ! scan->accept(&flow))
+			continue;
+
+		if (scan->mask_fun)
+			scan->mask_fun(&flow, scan->mask);
+
+		if (shared_map_add(scan->map, &flow, scan->store->packets[i], scan->store->bytes[i], scan->stripe))
+			continue;
+
+		struct rbtree_node * node = rbtree_lookup(&flow.node_agg, &scan->tree);
+		Flow * record;
+
+		if (node) {
+			record = rbtree_container_of(node, Flow, node_agg);
+			record->data.packets += scan->store->packets[i];
+			record->data.bytes += scan->store->bytes[i];
+		} else {
+			record = new Flow;
+			memcpy(&record->data, &flow.data, sizeof(flow.data));
+			record->data.packets = scan->store->packets[i];
+			record->data.bytes = scan->store->bytes[i];
+			rbtree_insert(&record->node_agg, &scan->tree);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief  Aggregation of the store given by Param
+ */
+struct store_query {
+	unsigned column;									///< key column in the order of flow_store
+	size_t key_offset;								///< key position in Flow
+	unsigned key_len;									///< key length
+	union rbfun_t cmp_fn;							///< key order
+	void (* print_fun)(const Flow *);			///< function used for printing flow
+	void (* print_fun_header)();					///< output header
+	bool (* accept)(const Flow *);				///< row filter, NULL for all rows
+	void (* mask_fun)(Flow *, union mask_t &);	///< key mask, NULL if not masked
+	union mask_t mask;
+};
+
+/**
+ * @brief  Describe aggregation given by Param
+ *
+ * @param q query to init
+ */
+static
+void store_query_init(struct store_query * q) {
+	q->key_offset = 0;
+	q->key_len = sizeof(struct in6_addr);
+	q->accept = NULL;
+	q->mask_fun = NULL;
+
+	switch (Param::aggregation()) {
+		case Param::AGG_SRCPORT:
+				q->column = 2;
+				q->key_offset = KEY_OFFSET(src_port);
+				q->key_len = sizeof(uint16_t);
+				q->cmp_fn = RBFUN(cmp_srcport);
+				q->print_fun = Flow::print_srcport;
+				q->print_fun_header = Flow::print_srcport_header;
+				break;
+		case Param::AGG_DSTPORT:
+				q->column = 3;
+				q->key_offset = KEY_OFFSET(dst_port);
+				q->key_len = sizeof(uint16_t);
+				q->cmp_fn = RBFUN(cmp_dstport);
+				q->print_fun = Flow::print_dstport;
+				q->print_fun_header = Flow::print_dstport_header;
+				break;
+		case Param::AGG_SRCIP:
+				q->column = 0;
+				q->key_offset = KEY_OFFSET(src_addr);
+				q->cmp_fn = RBFUN(cmp_srcip);
+				q->print_fun = Flow::print_srcip;
+				q->print_fun_header = Flow::print_srcip_header;
+				break;
+		case Param::AGG_SRCIP4:
+				q->column = 0;
+				q->key_offset = KEY_OFFSET(src_addr);
+				q->cmp_fn = RBFUN(cmp_srcip4_mask);
+				q->print_fun = Flow::print_srcip;
+				q->print_fun_header = Flow::print_srcip_header;
+				q->accept = Flow::is_ipv4_src;
+				q->mask_fun = Flow::mask_srcip4;
+				get_ipv4_mask(q->mask, Param::getInstance().mask());
+				break;
+		case Param::AGG_SRCIP6:
+				q->column = 0;
+				q->key_offset = KEY_OFFSET(src_addr);
+				q->cmp_fn = RBFUN(cmp_srcip6_mask);
+				q->print_fun = Flow::print_srcip;
+				q->print_fun_header = Flow::print_srcip_header;
+				q->accept = Flow::is_ipv6_src;
+				q->mask_fun = Flow::mask_srcip6;
+				get_ipv6_mask(q->mask, Param::getInstance().mask());
+				break;
+		case Param::AGG_DSTIP:
+				q->column = 1;
+				q->key_offset = KEY_OFFSET(dst_addr);
+				q->cmp_fn = RBFUN(cmp_dstip);
+				q->print_fun = Flow::print_dstip;
+				q->print_fun_header = Flow::print_dstip_header;
+				break;
+		case Param::AGG_DSTIP4:
+				q->column = 1;
+				q->key_offset = KEY_OFFSET(dst_addr);
+				q->cmp_fn = RBFUN(cmp_dstip4_mask);
+				q->print_fun = Flow::print_dstip;
+				q->print_fun_header = Flow::print_dstip_header;
+				q->accept = Flow::is_ipv4_dst;
+				q->mask_fun = Flow::mask_dstip4;
+				get_ipv4_mask(q->mask, Param::getInstance().mask());
+				break;
+		case Param::AGG_DSTIP6:
+				q->column = 1;
+				q->key_offset = KEY_OFFSET(dst_addr);
+				q->cmp_fn = RBFUN(cmp_dstip6_mask);
+				q->print_fun = Flow::print_dstip;
+				q->print_fun_header = Flow::print_dstip_header;
+				q->accept = Flow::is_ipv6_dst;
+				q->mask_fun = Flow::mask_dstip6;
+				get_ipv6_mask(q->mask, Param::getInstance().mask());
+				break;
+		default:
+				assert(! "Unknown aggregation type!\n");
+				break;
+	}
+}
+
+/**
+ * @brief  Aggregate store into a list ordered by key
+ *
+ * Threads scan disjoint row ranges of the key column and update one shared
+ * map, only keys refused by the map are merged from threads.
+ *
+ * @param store records to aggregate
+ * @param q aggregation
+ * @param list list to store
+ *
+ * @return   false if aggregation failed
+ */
+static
+bool store_aggregate(const struct flow_store * store, const struct store_query * q,
+							struct flow_list * list) {
+	pthread_t thread[THREAD_COUNT];					// threads
+	struct store_scan scan[THREAD_COUNT];			// row range of every thread
+	struct shared_map shared;							// map shared by all threads
+	int count;
+
+	if (! shared_map_init(&shared, shared_keys(store->rows, q->key_len), THREAD_COUNT,
+				q->key_len, q->key_offset)) {
+		err() << "Unable to allocate shared aggregation map!\n";
+		return false;
+	}
+
+	for (count = 0; count < THREAD_COUNT; ++count) {
+		scan[count].store = store;
+		scan[count].begin = store->rows * count / THREAD_COUNT;
+		scan[count].end = store->rows * (count + 1) / THREAD_COUNT;
+		scan[count].map = &shared;
+		scan[count].stripe = count;
+		rbtree_init(&scan[count].tree, q->cmp_fn);
+		scan[count].column = store_column(store, q->column);
+		scan[count].accept = q->accept;
+		scan[count].mask_fun = q->mask_fun;
+		scan[count].mask = q->mask;
+
+		if (pthread_create(&thread[count], NULL, (void * (*)(void *)) store_scan, &scan[count])) {
+			err() << "Unable to create thread!\n"; perror("pthread");
+			break;
+		}
+	}
+
+	for (int i = 0; i < count; ++i)
+		pthread_join(thread[i], NULL);
+
+	struct merge_param m;
+
+	m.cmp = q->cmp_fn.cmp_fn;
+	shared_to_list(&shared, q->cmp_fn.cmp_fn, &m.a);
+	shared_map_free(&shared);
+
+	for (int i = 0; i < count; ++i) {
+		m.b.head = rbtree_to_list(&scan[i].tree, &m.b.count);
+		merge_lists(&m);
+	}
+
+	if (count != THREAD_COUNT) {
+		for (struct rbtree_node * node = m.a.head; node; /**/) {
+			Flow * flow = rbtree_container_of(node, Flow, node_agg);
+
+			node = node->right;
+			delete flow;
+		}
+		return false;
+	}
+
+	*list = m.a;
+	return true;
+}
+
+/**
+ * @brief  Answer query given by Param from records in memory
+ *
+ * @param store records to aggregate
+ *
+ * @return   false if aggregation failed
+ */
+bool Aggregation::run_store(const struct flow_store * store) {
+	struct bstree sort_tree;							// tree used for sorting
+	struct store_query q;
+	struct flow_list list;
+
+	store_query_init(&q);
+
+	switch (Param::sort()) {
+		case Param::SORT_BYTES:
+			bstree_init(&sort_tree, cmp_bytes);
+			break;
+		case Param::SORT_PACKETS:
+			bstree_init(&sort_tree, cmp_packets);
+			break;
+		case Param::SORT_KEY:
+			break;
+		default:
+			assert(! "Unknown sort type!\n");
+			break;
+	}
+
+	if (! store_aggregate(store, &q, &list))
+		return false;
+
+	q.print_fun_header();
+
+	for (struct rbtree_node * node = list.head; node; /**/) {
+		Flow * flow = rbtree_container_of(node, Flow, node_agg);
+
+		node = node->right;
+		if (Param::sort() == Param::SORT_KEY) {
+			q.print_fun(flow);
+			delete flow;
+		} else {
+			bstree_insert(&flow->node_sort, &sort_tree);
+		}
+	}
+
+	if (Param::sort() != Param::SORT_KEY)
+		tree_inorder_free(&sort_tree, q.print_fun);
+
+	return true;
+}
+
+/**
+ * @brief  Aggregate a file alone and keep the result as its sidecar
+ *
+ * @param node file to aggregate
+ * @param q aggregation
+ * @param path sidecar path
+ *
+ * @return   sidecar positioned at the partial, NULL on error
+ */
+static
+FILE * sidecar_aggregate(struct linked_list_node * node, const struct store_query * q,
+									const std::string & path) {
+	struct sidecar_writer w;
+	struct partial_writer pw;
+	struct flow_store store;
+	struct flow_list list;
+	bool ok;
+
+	if (! store_init(&store, store_rows_file(node), (1 << q->column) | STORE_PACKETS | STORE_BYTES)) {
+		err() << "Unable to allocate records of '" << node->name << "'!\n";
+		return NULL;
+	}
+
+	ok = store_load_file(&store, node) && store_aggregate(&store, q, &list);
+	store_free(&store);
+
+	if (! ok)
+		return NULL;
+
+	if (! sidecar_begin(&w, node, path)) {
+		err() << "Unable to write sidecar of '" << node->name << "'!\n";
+		ok = false;
+	} else if (! partial_open(&pw, w.f, Param::aggregation(), Param::getInstance().mask(), q->key_len)) {
+		fclose(w.f);
+		ok = false;
+	}
+
+	for (struct rbtree_node * n = list.head; n; /**/) {
+		Flow * flow = rbtree_container_of(n, Flow, node_agg);
+
+		n = n->right;
+		if (ok)
+			partial_write(&pw, (const uint8_t *) flow + q->key_offset, flow->data.packets, flow->data.bytes);
+		delete flow;
+	}
+
+	if (! ok)
+		return NULL;
+
+	return sidecar_end(&w, path, partial_close(&pw));
+}
+
+/**
+ * @brief  Aggregate Filepool using sidecars, only files without a valid
+ *         sidecar are read, then sidecars are merged
+ *
+ * @return   false if aggregation failed
+ */
+bool Aggregation::run_sidecar() {
+	std::vector<struct merge_input *> heap;		// sidecars ordered by current key
+	std::vector<FILE *> files;							// opened sidecars
+	struct store_query q;
+	unsigned cached = 0;
+	unsigned fresh = 0;
+	bool ok = true;
+
+	store_query_init(&q);
+
+	for (auto l = Filepool::getInstance().list.end; l && ok; l = l->prev) {
+		std::string path = sidecar_path(l->name, Param::aggregation(), Param::getInstance().mask());
+		struct merge_input * in;
+		FILE * f;
+		int ret;
+
+		if ((f = sidecar_open(l, path)))
+			cached++;
+		else if ((f = sidecar_aggregate(l, &q, path)))
+			fresh++;
+		else {
+			ok = false;
+			break;
+		}
+
+		files.push_back(f);
+		in = new struct merge_input;
+		in->name = l->name;
+
+		if (! partial_read_header(&in->r, f) || in->r.aggregation != Param::aggregation()
+				|| in->r.mask != Param::getInstance().mask() || in->r.key_len != q.key_len) {
+			err() << "Sidecar '" << path << "' is broken!\n";
+			delete in;
+			ok = false;
+		} else if ((ret = merge_input_next(in)) > 0) {
+			heap.push_back(in);
+		} else {
+			delete in;
+			ok = ret == 0;
+		}
+	}
+
+	if (Param::stats())
+		std::cerr << "sidecar: " << cached << " files cached, " << fresh << " aggregated\n";
+
+	if (ok)
+		ok = merge_run(heap, Param::aggregation(), Param::getInstance().mask(), q.key_len);
+	else
+		merge_inputs_free(heap);
+
+	for (auto f : files)
+		fclose(f);
+
+	return ok;
+}
+
+/**
+ * @brief  Compacted segment being merged
+ */
+struct sorted_input {
+	struct linked_list_node * node;
+	Flow flow;											///< current record, key masked
+};
+
+/**
+ * @brief  Read next record of a compacted segment accepted by aggregation
+ *
+ * @param in segment to read
+ * @param q aggregation
+ *
+ * @return   false at the end
+ */
+static inline
+bool sorted_next(struct sorted_input * in, struct store_query * q) {
+	while (Flow::getFlow(&in->flow, in->node)) {
+		if (q->accept && ! q->accept(&in->flow))
+			continue;
+
+		if (q->mask_fun)
+			q->mask_fun(&in->flow, q->mask);
+
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief  Aggregate compacted segments ordered by the aggregation key
+ *
+ * Segments are merged by key with a heap and runs of equal keys are
+ * combined, memory is used only for the current record of every segment
+ * and for the output. Masking keeps the order of keys.
+ *
+ * @return   false if a file is not a segment ordered by the key
+ */
+bool Aggregation::run_sorted() {
+	std::vector<struct sorted_input *> heap;		// segments ordered by current key
+	std::vector<struct sorted_input *> inputs;
+	struct bstree sort_tree;							// tree used for sorting
+	struct store_query q;
+	Flow flow;
+	bool ok = true;
+
+	store_query_init(&q);
+
+	switch (Param::sort()) {
+		case Param::SORT_BYTES:
+			bstree_init(&sort_tree, cmp_bytes);
+			break;
+		case Param::SORT_PACKETS:
+			bstree_init(&sort_tree, cmp_packets);
+			break;
+		case Param::SORT_KEY:
+			break;
+		default:
+			assert(! "Unknown sort type!\n");
+			break;
+	}
+
+	for (auto l = Filepool::getInstance().list.end; l; l = l->prev) {
+		unsigned column;
+
+		if (! sorted_check(l->f, &column) || column != q.column) {
+			err() << "File '" << l->name << "' is not compacted by the aggregation key!\n";
+			ok = false;
+			break;
+		}
+
+		struct sorted_input * in = new struct sorted_input;
+		in->node = l;
+		inputs.push_back(in);
+
+		if (sorted_next(in, &q))
+			heap.push_back(in);
+	}
+
+	if (ok && Param::partial()) {
+		if ((ok = partial_begin(Param::aggregation(), Param::getInstance().mask(), q.key_len, q.key_offset))) {
+			q.print_fun = print_partial;
+			q.print_fun_header = print_partial_header;
+		}
+	}
+
+	if (! ok) {
+		for (auto in : inputs)
+			delete in;
+		return false;
+	}
+
+	const size_t key_offset = q.key_offset;
+	const unsigned key_len = q.key_len;
+	auto greater = [key_offset, key_len](const struct sorted_input * a, const struct sorted_input * b) {
+		return memcmp((const uint8_t *) &a->flow + key_offset, (const uint8_t *) &b->flow + key_offset, key_len) > 0;
+	};
+	uint8_t * flow_key = (uint8_t *) &flow + key_offset;
+
+	std::make_heap(heap.begin(), heap.end(), greater);
+	memset(&flow.data, 0, sizeof(flow.data));
+
+	if (Param::sort() == Param::SORT_KEY)
+		q.print_fun_header();
+
+	while (! heap.empty()) {
+		memcpy(flow_key, (const uint8_t *) &heap.front()->flow + key_offset, key_len);
+		flow.data.packets = 0;
+		flow.data.bytes = 0;
+
+		// run of the key over all segments
+		while (! heap.empty() && ! memcmp((const uint8_t *) &heap.front()->flow + key_offset, flow_key, key_len)) {
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			struct sorted_input * in = heap.back();
+
+			flow.data.packets += in->flow.data.packets;
+			flow.data.bytes += in->flow.data.bytes;
+
+			if (sorted_next(in, &q))
+				std::push_heap(heap.begin(), heap.end(), greater);
+			else
+				heap.pop_back();
+		}
+
+		if (Param::sort() == Param::SORT_KEY) {
+			q.print_fun(&flow);
+		} else {
+			Flow * record = new Flow;
+			memcpy(&record->data, &flow.data, sizeof(flow.data));
+			bstree_insert(&record->node_sort, &sort_tree);
+		}
+	}
+
+	for (auto in : inputs)
+		delete in;
+
+	if (Param::sort() != Param::SORT_KEY) {
+		q.print_fun_header();
+		tree_inorder_free(&sort_tree, q.print_fun);
+	}
+
+	return partial_end();
+}
+
+/**
+ * @brief  Aggregate record files of a bucket and write the result as a
+ *         partial
+ *
+ * @param nodes record files of the bucket
+ * @param q aggregation
+ * @param path bucket path
+ *
+ * @return   false on error
+ */
+static
+bool rollup_aggregate(const std::vector<struct linked_list_node *> & nodes,
+								const struct store_query * q, const std::string & path) {
+	struct partial_writer pw;
+	struct flow_store store;
+	struct flow_list list;
+	std::string tmp;
+	size_t rows = 0;
+	bool ok = true;
+	FILE * f;
+
+	for (auto node : nodes)
+		rows += store_rows_file(node);
+
+	if (! store_init(&store, rows, (1 << q->column) | STORE_PACKETS | STORE_BYTES)) {
+		err() << "Unable to allocate records of bucket '" << path << "'!\n";
+		return false;
+	}
+
+	for (auto node : nodes)
+		ok = ok && store_load_file(&store, node);
+
+	ok = ok && store_aggregate(&store, q, &list);
+	store_free(&store);
+
+	if (! ok)
+		return false;
+
+	if (! (f = rollup_create(path, tmp)))
+		ok = false;
+	else if (! partial_open(&pw, f, Param::aggregation(), Param::getInstance().mask(), q->key_len)) {
+		fclose(f);
+		rollup_commit(tmp, path, false);
+		ok = false;
+	}
+
+	for (struct rbtree_node * n = list.head; n; /**/) {
+		Flow * flow = rbtree_container_of(n, Flow, node_agg);
+
+		n = n->right;
+		if (ok)
+			partial_write(&pw, (const uint8_t *) flow + q->key_offset, flow->data.packets, flow->data.bytes);
+		delete flow;
+	}
+
+	if (! ok)
+		return false;
+
+	return rollup_commit(tmp, path, partial_close(&pw));
+}
+
+/**
+ * @brief  Merge buckets of a finer level into a bucket
+ *
+ * @param inputs paths of buckets to merge
+ * @param q aggregation
+ * @param path bucket path
+ *
+ * @return   false on error
+ */
+static
+bool rollup_merge(const std::vector<std::string> & inputs, const struct store_query * q,
+								const std::string & path) {
+	std::vector<struct merge_input *> heap;		// buckets ordered by current key
+	std::vector<FILE *> files;
+	struct partial_writer pw;
+	uint8_t key[PARTIAL_KEY_MAX];
+	std::string tmp;
+	bool opened = false;
+	bool ok = true;
+	FILE * f;
+
+	for (auto & name : inputs) {
+		struct merge_input * in;
+		int ret;
+
+		if (! (f = fopen(name.c_str(), "rb"))) {
+			perror(name.c_str());
+			ok = false;
+			break;
+		}
+
+		files.push_back(f);
+		in = new struct merge_input;
+		in->name = name.c_str();
+
+		if (! partial_read_header(&in->r, f) || in->r.aggregation != Param::aggregation()
+				|| in->r.mask != Param::getInstance().mask() || in->r.key_len != q->key_len) {
+			err() << "Bucket '" << name << "' is broken!\n";
+			delete in;
+			ok = false;
+			break;
+		} else if ((ret = merge_input_next(in)) > 0) {
+			heap.push_back(in);
+		} else {
+			delete in;
+			if (! (ok = ret == 0))
+				break;
+		}
+	}
+
+	if (ok && (f = rollup_create(path, tmp))) {
+		if (! (opened = partial_open(&pw, f, Param::aggregation(), Param::getInstance().mask(), q->key_len))) {
+			fclose(f);
+			ok = false;
+		}
+	} else
+		ok = false;
+
+	const unsigned key_len = q->key_len;
+	auto greater = [key_len](const struct merge_input * a, const struct merge_input * b) {
+		return memcmp(a->key, b->key, key_len) > 0;
+	};
+
+	std::make_heap(heap.begin(), heap.end(), greater);
+
+	while (ok && ! heap.empty()) {
+		uint64_t packets = 0;
+		uint64_t bytes = 0;
+
+		memcpy(key, heap.front()->key, key_len);
+
+		// combine the key from all buckets holding it
+		while (! heap.empty() && ! memcmp(heap.front()->key, key, key_len)) {
+			std::pop_heap(heap.begin(), heap.end(), greater);
+			struct merge_input * in = heap.back();
+			int ret;
+
+			packets += in->packets;
+			bytes += in->bytes;
+
+			if ((ret = merge_input_next(in)) > 0) {
+				std::push_heap(heap.begin(), heap.end(), greater);
+			} else {
+				heap.pop_back();
+				delete in;
+				if (ret < 0) {
+					ok = false;
+					break;
+				}
 			}
 		}
 
-		for (int i = 0; i < count2; ++i) {
-			while (agg_tree[THREAD_COUNT + i].root) {
-				Flow * record = rbtree_container_of(agg_tree[THREAD_COUNT + i].root, Flow, node_agg);
-				rbtree_remove(agg_tree[THREAD_COUNT + i].root, &agg_tree[THREAD_COUNT + i]);
-				if (! rbtree_lookup_or_insert(record, &agg_all))
-					delete record;
-			}
-			memcpy(&agg_tree[THREAD_COUNT + i], &tree_init, sizeof(struct rbtree));
+		if (ok)
+			partial_write(&pw, key, packets, bytes);
+	}
+
+	merge_inputs_free(heap);
+
+	for (auto i : files)
+		fclose(i);
+
+	if (opened)
+		ok = partial_close(&pw) && ok;
+
+	return ! tmp.empty() && rollup_commit(tmp, path, ok);
+}
+
+/**
+ * @brief  Update time rollups of Filepool in the store given by Param
+ *
+ * Record files are grouped into 5m buckets by their names, a bucket is
+ * aggregated again only if it is missing or older than one of its files.
+ * Hours and days holding an updated bucket are merged again from the
+ * finer level, buckets written by earlier runs are kept.
+ *
+ * @return   false on error
+ */
+bool Aggregation::run_rollup() {
+	std::map<time_t, std::vector<struct linked_list_node *>> buckets;
+	std::set<time_t> touched[ROLLUP_LEVELS];
+	unsigned aggregation = Param::aggregation();
+	unsigned mask = Param::getInstance().mask();
+	struct store_query q;
+	unsigned skipped = 0;
+
+	store_query_init(&q);
+
+	for (auto l = Filepool::getInstance().list.end; l; l = l->prev) {
+		time_t t;
+
+		if (! bucket_file_time(l->name, &t)) {
+			warn() << "File '" << l->name << "' has no time in its name, skipped\n";
+			skipped++;
+			continue;
+		}
+
+		buckets[bucket_start(t, ROLLUP_WIDTH[0])].push_back(l);
+	}
+
+	if (! rollup_mkdir(Param::output(), aggregation, mask))
+		return false;
+
+	std::string dir = rollup_dir(Param::output(), aggregation, mask, 0);
+
+	for (auto & b : buckets) {
+		std::string path = rollup_path(dir, b.first);
+		time_t newest = 0;
+		struct stat st;
+
+		for (auto node : b.second) {
+			if (! fstat(fileno(node->f), &st))
+				newest = std::max(newest, st.st_mtime);
+		}
+
+		if (rollup_fresh(path, newest))
+			continue;
+
+		if (! rollup_aggregate(b.second, &q, path))
+			return false;
+
+		touched[0].insert(b.first);
+	}
+
+	for (unsigned level = 1; level < ROLLUP_LEVELS; ++level) {
+		std::string fine = rollup_dir(Param::output(), aggregation, mask, level - 1);
+		std::set<time_t> starts;
+
+		dir = rollup_dir(Param::output(), aggregation, mask, level);
+
+		for (auto t : touched[level - 1])
+			touched[level].insert(bucket_start(t, ROLLUP_WIDTH[level]));
+
+		if (! touched[level].empty() && ! rollup_list(fine, starts))
+			return false;
+
+		for (auto t : touched[level]) {
+			std::vector<std::string> inputs;
+
+			for (auto i = starts.lower_bound(t); i != starts.end() && *i < t + ROLLUP_WIDTH[level]; ++i)
+				inputs.push_back(rollup_path(fine, *i));
+
+			if (! rollup_merge(inputs, &q, rollup_path(dir, t)))
+				return false;
+		}
+	}
+
+	if (Param::stats()) {
+		std::cerr << "rollup: " << touched[0].size() << " of " << buckets.size() << " 5m buckets, "
+			<< touched[1].size() << " 1h, " << touched[2].size() << " 1d written, "
+			<< skipped << " files skipped\n";
+	}
+
+	return true;
+}
+
+#ifndef BUCKET_THREADS
+#define BUCKET_THREADS		4
+#endif
+
+/**
+ * @brief  Time bucket aggregated by a worker
+ */
+struct bucket_job {
+	time_t start;
+	std::vector<struct linked_list_node *> files;
+	struct flow_list list;							///< result ordered by key
+	bool ok;
+	bool done;
+};
+
+/**
+ * @brief  Buckets shared by workers
+ */
+struct bucket_pool {
+	std::vector<struct bucket_job> * jobs;
+	const struct store_query * q;
+	size_t next;										///< next bucket to take
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;								///< signalled when a bucket is done
+};
+
+/**
+ * @brief  Aggregate record files of a bucket
+ *
+ * @param job bucket to aggregate
+ * @param q aggregation
+ *
+ * @return   false on error
+ */
+static
+bool bucket_aggregate(struct bucket_job * job, const struct store_query * q) {
+	struct flow_store store;
+	size_t rows = 0;
+	bool ok = true;
+
+	for (auto node : job->files)
+		rows += store_rows_file(node);
+
+	if (! store_init(&store, rows, (1 << q->column) | STORE_PACKETS | STORE_BYTES)) {
+		err() << "Unable to allocate records of bucket " << bucket_format(job->start) << "!\n";
+		return false;
+	}
+
+	for (auto node : job->files)
+		ok = ok && store_load_file(&store, node);
+
+	ok = ok && store_aggregate(&store, q, &job->list);
+	store_free(&store);
+
+	return ok;
+}
+
+/**
+ * @brief  Worker taking buckets until none is left
+ *
+ * @param pool buckets to aggregate
+ *
+ * @return   NULL
+ */
+static
+void * bucket_worker(struct bucket_pool * pool) {
+	for (;;) {
+		struct bucket_job * job;
+
+		pthread_mutex_lock(&pool->mutex);
+		if (pool->next == pool->jobs->size()) {
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+		job = &(*pool->jobs)[pool->next++];
+		pthread_mutex_unlock(&pool->mutex);
+
+		bool ok = bucket_aggregate(job, pool->q);
+
+		pthread_mutex_lock(&pool->mutex);
+		job->ok = ok;
+		job->done = true;
+		pthread_cond_broadcast(&pool->cond);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief  Aggregate Filepool by time buckets of file names, one result is
+ *         printed for every bucket
+ *
+ * Workers aggregate buckets in parallel, results are printed in time order
+ * as soon as all earlier buckets are printed.
+ *
+ * @return   false on error
+ */
+bool Aggregation::run_buckets() {
+	std::map<time_t, std::vector<struct linked_list_node *>> files;
+	std::vector<struct bucket_job> jobs;
+	pthread_t thread[BUCKET_THREADS];
+	struct bucket_pool pool;
+	struct store_query q;
+	size_t printed;
+	unsigned count;
+	bool ok = true;
+
+	store_query_init(&q);
+
+	for (auto l = Filepool::getInstance().list.end; l; l = l->prev) {
+		time_t t;
+
+		if (! bucket_file_time(l->name, &t)) {
+			err() << "File '" << l->name << "' has no time in its name!\n";
+			return false;
 		}
 
-		for (int i = 0; i < count1; ++i)
-			pthread_join(thread[i], NULL);
+		files[bucket_start(t, Param::bucket())].push_back(l);
+	}
 
-		for (count2 = 0; count2 < THREAD_COUNT && l; l = l->prev, count2++) {
-			param[THREAD_COUNT + count2].node = l;
+	jobs.resize(files.size());
+	count = 0;
+	for (auto & f : files) {
+		jobs[count].start = f.first;
+		jobs[count].files.swap(f.second);
+		jobs[count].ok = false;
+		jobs[count].done = false;
+		count++;
+	}
 
-			if(pthread_create(&thread[count2], NULL, (void * (*)(void *))agg_fun, &param[THREAD_COUNT + count2])) {
-				err() << "Unable to create thread!\n"; perror("pthread");
-				return false;
-			}
+	pool.jobs = &jobs;
+	pool.q = &q;
+	pool.next = 0;
+	pthread_mutex_init(&pool.mutex, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+
+	for (count = 0; count < BUCKET_THREADS && count < jobs.size(); ++count) {
+		if (pthread_create(&thread[count], NULL, (void * (*)(void *)) bucket_worker, &pool)) {
+			err() << "Unable to create thread!\n"; perror("pthread");
+			break;
 		}
+	}
+
+	if (! count && ! jobs.empty())
+		ok = false;
+
+	for (printed = 0; ok && printed < jobs.size(); ++printed) {
+		struct bucket_job * job = &jobs[printed];
+		struct bstree sort_tree;						// tree used for sorting
+
+		pthread_mutex_lock(&pool.mutex);
+		while (! job->done)
+			pthread_cond_wait(&pool.cond, &pool.mutex);
+		pthread_mutex_unlock(&pool.mutex);
+
+		if (! (ok = job->ok))
+			break;
+
+		if (Param::sort() == Param::SORT_BYTES)
+			bstree_init(&sort_tree, cmp_bytes);
+		else if (Param::sort() == Param::SORT_PACKETS)
+			bstree_init(&sort_tree, cmp_packets);
 
-		for (int i = 0; i < count1; ++i) {
-			while (agg_tree[i].root) {
-				Flow * record = rbtree_container_of(agg_tree[i].root, Flow, node_agg);
-				rbtree_remove(agg_tree[i].root, &agg_tree[i]);
-				if (! rbtree_lookup_or_insert(record, &agg_all))
-					delete record;
+		std::cout << "#bucket," << bucket_format(job->start) << "\n";
+		q.print_fun_header();
+
+		for (struct rbtree_node * node = job->list.head; node; /**/) {
+			Flow * flow = rbtree_container_of(node, Flow, node_agg);
+
+			node = node->right;
+			if (Param::sort() == Param::SORT_KEY) {
+				q.print_fun(flow);
+				delete flow;
+			} else {
+				bstree_insert(&flow->node_sort, &sort_tree);
 			}
-			memcpy(&agg_tree[i], &tree_init, sizeof(struct rbtree));
 		}
 
-		for (int i = 0; i < count2; ++i)
-			pthread_join(thread[i], NULL);
+		if (Param::sort() != Param::SORT_KEY)
+			tree_inorder_free(&sort_tree, q.print_fun);
 	}
 
-	// aggregation from last iteration
-	for (int i = 0; i < count2; ++i) {
-		while (agg_tree[THREAD_COUNT + i].root) {
-			Flow * record = rbtree_container_of(agg_tree[THREAD_COUNT + i].root, Flow, node_agg);
-			rbtree_remove(agg_tree[THREAD_COUNT + i].root, &agg_tree[THREAD_COUNT + i]);
-			if (! rbtree_lookup_or_insert(record, &agg_all))
-				delete record;
+	// on error workers finish buckets taken already
+	pthread_mutex_lock(&pool.mutex);
+	pool.next = jobs.size();
+	pthread_mutex_unlock(&pool.mutex);
+
+	for (unsigned i = 0; i < count; ++i)
+		pthread_join(thread[i], NULL);
+
+	for (size_t i = printed; i < jobs.size(); ++i) {
+		if (! jobs[i].done || ! jobs[i].ok)
+			continue;
+
+		for (struct rbtree_node * node = jobs[i].list.head; node; /**/) {
+			Flow * flow = rbtree_container_of(node, Flow, node_agg);
+
+			node = node->right;
+			delete flow;
 		}
 	}
-#endif
 
-	print_fun_header();
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.mutex);
 
-	// Construct binary tree
-	while (agg_all.root) {
-		Flow * record = rbtree_container_of(agg_all.root, Flow, node_agg);
-		rbtree_remove(agg_all.root, &agg_all);
-		bstree_insert(&record->node_sort, &sort_tree);
+	if (Param::stats())
+		std::cerr << "bucket: " << jobs.size() << " buckets of " << Param::bucket() << " s\n";
+
+	return ok;
+}
+
+/**
+ * @brief  Aggregate a file entering the window and add it to window
+ *
+ * @param w window
+ * @param node file to aggregate
+ * @param q aggregation
+ *
+ * @return   false on error
+ */
+static
+bool window_file(struct flow_window * w, struct linked_list_node * node, const struct store_query * q) {
+	struct flow_store store;
+	struct flow_list list;
+	bool ok;
+
+	if (! store_init(&store, store_rows_file(node), (1 << q->column) | STORE_PACKETS | STORE_BYTES)) {
+		err() << "Unable to allocate records of '" << node->name << "'!\n";
+		return false;
 	}
 
-	// traversing inorder sorted binary tree gives sorted sequence.
-	// nodes are freed within function, only one traversal needed
-	tree_inorder_free(&sort_tree, print_fun);
+	ok = store_load_file(&store, node) && store_aggregate(&store, q, &list);
+	store_free(&store);
 
-	return true;
-}
+	if (! ok)
+		return false;
 
-/*****************************************************************************/
-/*****************************************************************************/
+	// a file with no key accepted is still in window
+	w->files[node->name];
 
-static inline
-void port_map_update_dst(const Flow * flow, struct Aggregation::port_map_t * map) {
-	const unsigned idx = flow->data.dst_port;
+	for (struct rbtree_node * n = list.head; n; /**/) {
+		Flow * flow = rbtree_container_of(n, Flow, node_agg);
 
-	pthread_mutex_lock(&map[idx].mutex);
-	if (map[idx].valid) {
-		map[idx].flow.data.packets += flow->data.packets;
-		map[idx].flow.data.bytes += flow->data.bytes;
-	} else {
-		map[idx].valid = true;
-		memcpy(&map[idx].flow.data, &flow->data, sizeof(Flow::data));
+		n = n->right;
+		window_add(w, node->name, (const uint8_t *) flow + q->key_offset, flow->data.packets, flow->data.bytes);
+		delete flow;
 	}
-	pthread_mutex_unlock(&map[idx].mutex);
+
+	return true;
 }
 
+/**
+ * @brief  Aggregate files of the last window of directory given by Param
+ *
+ * Window ends at the time of the newest file name. Every interval the
+ * directory is listed again, files entering the window are aggregated and
+ * added, files leaving it are subtracted, then the window is printed.
+ *
+ * @return   false on error
+ */
+bool Aggregation::run_window() {
+	struct flow_window w;
+	struct store_query q;
 
-static inline
-void port_map_update_src(const Flow * flow, struct Aggregation::port_map_t * map) {
-	const unsigned idx = flow->data.src_port;
+	store_query_init(&q);
+	window_init(&w, q.key_len, q.key_offset, Param::sort());
 
-	pthread_mutex_lock(&map[idx].mutex);
-	if (map[idx].valid) {
-		map[idx].flow.data.packets += flow->data.packets;
-		map[idx].flow.data.bytes += flow->data.bytes;
-	} else {
-		map[idx].valid = true;
-		memcpy(&map[idx].flow.data, &flow->data, sizeof(struct Flow::data));
-	}
-	pthread_mutex_unlock(&map[idx].mutex);
-}
+	for (;;) {
+		std::map<std::string, time_t> names;		// files of directory by time
+		std::set<std::string> gone;
+		unsigned added = 0;
+		time_t newest = 0;
 
-static
-void * aggregate_srcport(struct Aggregation::thread_param_port * param) {
-	Flow flow;
+		if (! window_scan(Param::getInstance().path(), names))
+			return false;
 
-	while (Flow::getFlow(&flow, param->node)) {
-		port_map_update_src(&flow, param->map);
+		for (auto & n : names)
+			newest = std::max(newest, n.second);
+
+		// window is (newest - width, newest]
+		time_t begin = newest - Param::window();
+
+		for (auto & f : w.files) {
+			auto n = names.find(f.first);
+
+			if (n == names.end() || n->second <= begin)
+				gone.insert(f.first);
+		}
+
+		for (auto & g : gone)
+			window_remove(&w, g);
+
+		for (auto & n : names) {
+			if (n.second <= begin || w.files.count(n.first))
+				continue;
+
+			if (! Filepool::getInstance().add(n.first))
+				return false;
+
+			bool ok = window_file(&w, linked_list_last(&Filepool::getInstance().list), &q);
+			Filepool::getInstance().drop(std::set<std::string>{ n.first });
+
+			if (! ok)
+				return false;
+
+			added++;
+		}
+
+		if (Param::stats())
+			std::cerr << "window: " << added << " files added, " << gone.size() << " removed, "
+				<< w.files.size() << " in window, " << w.keys.size() << " keys\n";
+
+		std::cout << "#window," << bucket_format(begin) << "," << bucket_format(newest) << "\n";
+		window_print(&w, Param::top(), q.print_fun, q.print_fun_header);
+		std::cout.flush();
+
+		if (! Param::interval())
+			break;
+
+		sleep(Param::interval());
 	}
 
-	return NULL;
+	return true;
+}
+
+/**
+ * @brief  File followed by watch mode
+ */
+struct watch_input {
+	struct linked_list_node * node;		///< opened file owned by Filepool, NULL if closed
+	std::string path;							///< current name, empty if none
+	uint64_t offset;							///< end of the last complete record read
 };
 
+/**
+ * @brief  Read complete records appended to a followed file and add them
+ *         to window
+ *
+ * @param w window
+ * @param id identity of the file in window
+ * @param in file to read
+ * @param q aggregation
+ * @param records number of records read is added here
+ *
+ * @return   false on error
+ */
 static
-void * aggregate_dstport(struct Aggregation::thread_param_port * param) {
-	Flow flow;
+bool watch_read(struct flow_window * w, const std::string & id, struct watch_input * in,
+						const struct store_query * q, uint64_t * records) {
+	struct flow_store store;
+	struct flow_list list;
+	struct stat st;
+	size_t rows;
+	bool ok;
+
+	if (fstat(fileno(in->node->f), &st))
+		return true;
+
+	// a record still being written is read next time
+	if ((uint64_t) st.st_size < in->offset
+			|| ! (rows = (st.st_size - in->offset) / sizeof(struct Flow::data)))
+		return true;
+
+	if (fseek(in->node->f, in->offset, SEEK_SET))
+		return true;
+
+	if (! store_init(&store, rows, (1 << q->column) | STORE_PACKETS | STORE_BYTES)) {
+		err() << "Unable to allocate records of '" << in->path << "'!\n";
+		return false;
+	}
 
-	while (Flow::getFlow(&flow, param->node)) {
-		port_map_update_dst(&flow, param->map);
+	ok = store_load_rows(&store, in->node, rows) && store_aggregate(&store, q, &list);
+	store_free(&store);
+
+	if (! ok)
+		return false;
+
+	in->offset += rows * sizeof(struct Flow::data);
+	*records += rows;
+
+	for (struct rbtree_node * n = list.head; n; /**/) {
+		Flow * flow = rbtree_container_of(n, Flow, node_agg);
+
+		n = n->right;
+		window_add(w, id, (const uint8_t *) flow + q->key_offset, flow->data.packets, flow->data.bytes);
+		delete flow;
 	}
 
-	return NULL;
-};
+	return true;
+}
 
 /**
- * @brief  Aggregation entry point
+ * @brief  Close a followed file, its records stay in window
  *
- * @return   false if aggregation failed (e.g. thread create failed)
+ * @param in file to close
  */
-bool Aggregation::run_port() {
-	struct bstree sort_tree;									// tree used for sorting
-	pthread_t thread[THREAD_COUNT];							// threads
+static
+void watch_close(struct watch_input * in) {
+	if (in->node)
+		Filepool::getInstance().drop(std::set<std::string>{ in->node->name });
+	in->node = NULL;
+}
 
-	void (* print_fun)(const Flow *) = NULL;				// function used for printing flow
-	void (* print_fun_header)() = NULL;						// output header
-	void * (* agg_fun)(struct thread_param_port *) = NULL;		// thread aggregation routine
-	struct port_map_t * port_map = NULL;
-	struct thread_param_port param[THREAD_COUNT];
+/**
+ * @brief  Follow a collector directory given by Param
+ *
+ * Files are followed by identity (device and inode), so a file renamed by
+ * the collector when complete is not read again. Complete records appended
+ * are aggregated as they arrive, the result is printed every interval.
+ * With a window, files whose name time leaves it are subtracted.
+ *
+ * @return   false on error
+ */
+bool Aggregation::run_watch() {
+	std::map<std::string, struct watch_input> inputs;	// followed files by identity
+	std::map<std::string, std::string> names;				// identity of every name
+	std::map<std::string, time_t> times;					// time of files in window
+	std::set<std::string> changed;
+	struct flow_watch watch;
+	struct flow_window w;
+	struct store_query q;
+	uint64_t records = 0;
+	time_t begin = 0;
+	bool ok = true;
+
+	store_query_init(&q);
+	window_init(&w, q.key_len, q.key_offset, Param::sort());
+
+	if (! watch_init(&watch, Param::getInstance().path(), changed))
+		return false;
+
+	time_t next = time(NULL) + Param::interval();
+
+	while (ok) {
+		for (auto & name : changed) {
+			std::string path = watch.dir + "/" + name;
+			struct stat st;
+			time_t t = 0;
+
+			// renamed file may be known by its new name already
+			auto old = names.find(path);
+			if (old != names.end()) {
+				if (inputs[old->second].path == path)
+					inputs[old->second].path.clear();
+				names.erase(old);
+			}
 
-	port_map = new struct port_map_t[PORT_COUNT];
+			if (stat(path.c_str(), &st) || ! S_ISREG(st.st_mode))
+				continue;
 
-	/*
-	 * Initialize all variables. The decision based on AGG/SORT is traversed only
-	 * once, using function pointers to boost the speed.
-	 */
-	switch (Param::aggregation()) {
-		case Param::AGG_SRCPORT:
-				print_fun = Flow::print_srcport;
-				print_fun_header = Flow::print_srcport_header;
-				agg_fun = aggregate_srcport;
-				break;
-		case Param::AGG_DSTPORT:
-				print_fun = Flow::print_dstport;
-				print_fun_header = Flow::print_dstport_header;
-				agg_fun = aggregate_dstport;
-				break;
-		default:
-				assert(! "Unknown aggregation type!\n");
-				break;
-	}
+			std::string id = std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino);
+			struct watch_input & in = inputs[id];
 
-	switch (Param::sort()) {
-		case Param::SORT_BYTES:
-			bstree_init(&sort_tree, cmp_bytes);
-			break;
-		case Param::SORT_PACKETS:
-			bstree_init(&sort_tree, cmp_packets);
-			break;
-		default:
-			assert(! "Unknown sort type!\n");
-			break;
-	}
+			bucket_file_time(name.c_str(), &t);
 
-	for (auto i = 0u; i < PORT_COUNT; /**/) {
-		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
-		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
-		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
-		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
-		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
-		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
-		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
-		port_map[i++].mutex = PTHREAD_MUTEX_INITIALIZER;
-	}
+			// files of the past window are not read again
+			if (t && Param::window() && t <= begin && ! in.node)
+				continue;
 
-	for(auto i = 0u; i < THREAD_COUNT; ++i)
-		param[i].map = port_map;
+			names[path] = id;
+			in.path = path;
+			if (t)
+				times[id] = t;
 
-	unsigned count1 = 0;
-	unsigned count2 = 0;
-	for (auto l = Filepool::getInstance().list.end; l; /*l = 2*THREAD_COUNT times l->prev*/) {
-		for (count1 = 0; count1 < THREAD_COUNT && l; l = l->prev, count1++) {
-			param[count1].node = l;
-			if(pthread_create(&thread[count1], NULL, (void * (*)(void *))agg_fun, &param[count1])) {
-				err() << "Unable to create thread!\n";
-				perror("pthread");
-				return false;
+			if (! in.node) {
+				if (! Filepool::getInstance().add(path)) {
+					ok = false;
+					break;
+				}
+
+				in.node = linked_list_last(&Filepool::getInstance().list);
+				in.offset = ftell(in.node->f);
+
+				if (segment_check(in.node->f)) {
+					warn() << "File '" << path << "' is a columnar segment, it is not followed\n";
+					watch_close(&in);
+					continue;
+				}
 			}
+
+			if (! (ok = watch_read(&w, id, &in, &q, &records)))
+				break;
 		}
 
-		for (unsigned i = 0; i < count1; ++i)
-			pthread_join(thread[i], NULL);
+		changed.clear();
+
+		// files without name are deleted or moved away, the rest of them is read
+		for (auto i = inputs.begin(); ok && i != inputs.end(); /**/) {
+			if (i->second.path.empty()) {
+				if (i->second.node)
+					ok = watch_read(&w, i->first, &i->second, &q, &records);
+				watch_close(&i->second);
+				i = inputs.erase(i);
+			} else
+				++i;
+		}
 
-		for (count2 = 0; count2 < THREAD_COUNT && l; l = l->prev, count2++) {
-			param[count2].node = l;
-			if(pthread_create(&thread[count2], NULL, (void * (*)(void *))agg_fun, &param[count2])) {
-				err() << "Unable to create thread!\n";
-				perror("pthread");
-				return false;
+		if (! ok)
+			break;
+
+		time_t now = time(NULL);
+
+		if (now >= next || ! Param::interval()) {
+			if (Param::window()) {
+				time_t newest = 0;
+
+				for (auto & t : times)
+					newest = std::max(newest, t.second);
+
+				begin = newest - Param::window();
+
+				for (auto i = times.begin(); i != times.end(); /**/) {
+					if (i->second <= begin) {
+						auto in = inputs.find(i->first);
+
+						if (in != inputs.end()) {
+							watch_close(&in->second);
+							names.erase(in->second.path);
+							inputs.erase(in);
+						}
+						window_remove(&w, i->first);
+						i = times.erase(i);
+					} else
+						++i;
+				}
 			}
-		}
 
-		for (unsigned i = 0; i < count2; ++i)
-			pthread_join(thread[i], NULL);
-	}
+			if (Param::stats())
+				std::cerr << "watch: " << inputs.size() << " files followed, " << records
+					<< " records read, " << w.keys.size() << " keys\n";
 
-	print_fun_header();
+			std::cout << "#watch," << records << "\n";
+			window_print(&w, Param::top(), q.print_fun, q.print_fun_header);
+			std::cout.flush();
 
-	// Construct binary tree
-	for (auto i = 0u; i < PORT_COUNT; ++i) {
-		if (port_map[i].valid)
-			bstree_insert(&port_map[i].flow.node_sort, &sort_tree);
-	}
+			if (! Param::interval())
+				break;
 
-	// traversing inorder sorted binary tree gives sorted sequence.
-	// nodes are freed within function, only one traversal needed
-	tree_inorder(&sort_tree, print_fun);
+			next = now + Param::interval();
+		}
 
-	delete [] port_map;
+		ok = watch_wait(&watch, (next - now) * 1000, changed);
+	}
 
-	return true;
-}
+	for (auto & i : inputs)
+		watch_close(&i.second);
 
+	watch_free(&watch);
+	return ok;
+}
@@ -17,6 +17,8 @@
 #define AGGREGATION_H_
 
 #include <semaphore.h>
+#include <cstdio>
+#include <vector>
 
 #include "rbtree.h"
 #include "file.h"
@@ -25,6 +27,15 @@
 
 #include "file_list.h"
 #include "bstree.h"
+#include "hhh.h"
+#include "art.h"
+#include "shared_map.h"
+#include "hot_cache.h"
+#include "block.h"
+#include "hugepage.h"
+#include "shard.h"
+#include "store.h"
+#include "alert.h"
 
 /**
  * @brief  Aggregation routines
@@ -37,6 +48,20 @@ class Aggregation {
 		struct thread_param {
 			struct linked_list_node * node;
 			struct rbtree * tree;
+			struct art_tree * art;		///< used instead of tree if not NULL
+			struct shared_map * shared;	///< used instead of tree if not NULL
+			unsigned stripe;				///< counter stripe in shared map
+			struct hot_cache * cache;	///< front cache, NULL if not used
+			struct block * block;		///< pre-aggregation block, NULL if not used
+			ptrdiff_t key_delta;			///< key offset relative to node_agg
+			int numa_node;					///< node the slot runs on, -1 if any
+			struct flow_pool pool;		///< flows of the slot with huge pages
+			size_t flows;					///< flows held by index
+			size_t flow_limit;			///< index is spilled above this
+			std::vector<FILE *> runs;	///< sorted runs spilled to disk
+			bool failed;					///< spilling failed
+			struct shard_router * router;	///< keys go to shards if not NULL
+			struct alert_batch * alert;	///< candidate alert updates, NULL if the index holds all totals
 		};
 
 		struct port_map_t {
@@ -50,10 +75,25 @@ class Aggregation {
 			struct port_map_t * map;
 		};
 
+		struct thread_param_hhh {
+			struct linked_list_node * node;
+			struct hhh * hhh;
+		};
+
 		static const unsigned PORT_COUNT;
+		static const unsigned HHH_COUNTERS;
 
 		static bool run();
 		static bool run_port();
+		static bool run_hhh();
+		static bool run_merge();
+		static bool run_store(const struct flow_store * store);
+		static bool run_sidecar();
+		static bool run_sorted();
+		static bool run_rollup();
+		static bool run_buckets();
+		static bool run_window();
+		static bool run_watch();
 		static void * aggregate(struct thread_param * param);
 		static void * aggregate_srcip4(struct thread_param * param);
 		static void * aggregate_srcip6(struct thread_param * param);
@@ -0,0 +1,255 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 08:03:51 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "alert.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <pthread.h>
+#include <arpa/inet.h>
+
+#define ALERT_PARTITIONS	64
+
+struct alert_hash {
+	size_t operator()(const alert_key_t & key) const {
+		uint64_t h = (key.first ^ (key.second * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+		return h ^ (h >> 32);
+	}
+};
+
+/**
+ * @brief  Shared totals of a candidate key
+ */
+struct alert_total {
+	uint64_t packets;
+	uint64_t bytes;
+	bool packets_reported;
+	bool bytes_reported;
+};
+
+/**
+ * @brief  Shared totals of candidate keys, partitioned so threads rarely wait
+ */
+struct alert_partition {
+	pthread_mutex_t mutex;
+	std::unordered_map<alert_key_t, struct alert_total, alert_hash> totals;
+};
+
+static FILE * alert_out = NULL;				///< alert stream
+static pthread_mutex_t alert_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct alert_partition alert_totals[ALERT_PARTITIONS];
+
+/**
+ * @brief  Open alert stream
+ *
+ * @param path file alerts are appended to, NULL for stderr
+ *
+ * @return   false on error
+ */
+bool alert_init(const char * path) {
+	for (unsigned i = 0; i < ALERT_PARTITIONS; ++i)
+		pthread_mutex_init(&alert_totals[i].mutex, NULL);
+
+	if (! path) {
+		alert_out = stderr;
+		return true;
+	}
+
+	if (! (alert_out = fopen(path, "a"))) {
+		perror(path);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Get key of a flow by aggregation given by Param
+ *
+ * @param flow flow holding the key
+ *
+ * @return   port (network order) or address
+ */
+alert_key_t alert_key(const Flow * flow) {
+	const struct in6_addr * addr;
+	alert_key_t key(0, 0);
+
+	switch (Param::aggregation()) {
+		case Param::AGG_SRCPORT:
+			key.first = flow->data.src_port;
+			return key;
+		case Param::AGG_DSTPORT:
+			key.first = flow->data.dst_port;
+			return key;
+		case Param::AGG_SRCIP:
+		case Param::AGG_SRCIP4:
+		case Param::AGG_SRCIP6:
+			addr = &flow->data.src_addr;
+			break;
+		default:
+			addr = &flow->data.dst_addr;
+			break;
+	}
+
+	memcpy(&key.first, addr, sizeof(key.first));
+	memcpy(&key.second, ((const char *) addr) + sizeof(key.first), sizeof(key.second));
+
+	return key;
+}
+
+/**
+ * @brief  Write an alert, threads may report at once
+ *
+ * @param key key to report
+ * @param limit name of the limit reached
+ * @param packets packets of the key
+ * @param bytes bytes of the key
+ */
+static
+void alert_write(const alert_key_t & key, const char * limit, uint64_t packets, uint64_t bytes) {
+	char name[INET6_ADDRSTRLEN];
+	struct in6_addr addr;
+
+	switch (Param::aggregation()) {
+		case Param::AGG_SRCPORT:
+		case Param::AGG_DSTPORT:
+			snprintf(name, sizeof(name), "%u", ntohs((uint16_t) key.first));
+			break;
+		default:
+			memcpy(&addr, &key.first, sizeof(key.first));
+			memcpy(((char *) &addr) + sizeof(key.first), &key.second, sizeof(key.second));
+
+			if (IN6_IS_ADDR_V4COMPAT(&addr))
+				inet_ntop(AF_INET, ((const char *) &addr) + 12, name, sizeof(name));
+			else
+				inet_ntop(AF_INET6, &addr, name, sizeof(name));
+			break;
+	}
+
+	if (! alert_out)
+		return;
+
+	pthread_mutex_lock(&alert_mutex);
+	fprintf(alert_out, "#alert,%s,%s,%" PRIu64 ",%" PRIu64 "\n", limit, name,
+				packets, bytes);
+	fflush(alert_out);
+	pthread_mutex_unlock(&alert_mutex);
+}
+
+/**
+ * @brief  Write an alert of a key holding its totals
+ *
+ * @param flow key with its totals
+ * @param limit name of the limit reached
+ */
+void alert_emit(const Flow * flow, const char * limit) {
+	alert_write(alert_key(flow), limit, flow->data.packets, flow->data.bytes);
+}
+
+/**
+ * @brief  Report limits reached by shared totals not reported yet, caller
+ *         holds lock of the partition
+ *
+ * @param key key of totals
+ * @param t shared totals
+ */
+static
+void alert_report(const alert_key_t & key, struct alert_total * t) {
+	const uint64_t packets_limit = Param::alert_packets();
+	const uint64_t bytes_limit = Param::alert_bytes();
+
+	if (packets_limit && ! t->packets_reported && t->packets >= packets_limit) {
+		t->packets_reported = true;
+		alert_write(key, "packets", t->packets, t->bytes);
+	}
+
+	if (bytes_limit && ! t->bytes_reported && t->bytes >= bytes_limit) {
+		t->bytes_reported = true;
+		alert_write(key, "bytes", t->packets, t->bytes);
+	}
+}
+
+/**
+ * @brief  Init batch of a thread
+ *
+ * @param b batch to init
+ * @param threads threads sharing the limits
+ */
+void alert_batch_init(struct alert_batch * b, unsigned threads) {
+	b->packets_share = Param::alert_packets() ? std::max<uint64_t>(1, Param::alert_packets() / threads) : 0;
+	b->bytes_share = Param::alert_bytes() ? std::max<uint64_t>(1, Param::alert_bytes() / threads) : 0;
+	b->count = 0;
+}
+
+static
+bool alert_update_less(const struct alert_update & a, const struct alert_update & b) {
+	return a.key < b.key;
+}
+
+/**
+ * @brief  Add batched updates to shared totals and report limits reached,
+ *         updates of the same key are summed first
+ *
+ * @param b batch to flush
+ */
+void alert_flush(struct alert_batch * b) {
+	std::sort(b->updates, b->updates + b->count, alert_update_less);
+
+	for (unsigned i = 0; i < b->count; /**/) {
+		const alert_key_t & key = b->updates[i].key;
+		uint64_t packets = 0;
+		uint64_t bytes = 0;
+
+		for (/**/; i < b->count && b->updates[i].key == key; ++i) {
+			packets += b->updates[i].packets;
+			bytes += b->updates[i].bytes;
+		}
+
+		struct alert_partition * p = &alert_totals[alert_hash()(key) % ALERT_PARTITIONS];
+
+		pthread_mutex_lock(&p->mutex);
+		struct alert_total & t = p->totals[key];
+		t.packets += packets;
+		t.bytes += bytes;
+		alert_report(key, &t);
+		pthread_mutex_unlock(&p->mutex);
+	}
+
+	b->count = 0;
+}
+
+/**
+ * @brief  Report limits reached by merged totals of a key not reported
+ *         while aggregating
+ *
+ * @param flow key with its merged totals
+ */
+void alert_final(const Flow * flow) {
+	if (! (Param::alert_packets() && flow->data.packets >= Param::alert_packets())
+			&& ! (Param::alert_bytes() && flow->data.bytes >= Param::alert_bytes()))
+		return;
+
+	alert_key_t key = alert_key(flow);
+	struct alert_partition * p = &alert_totals[alert_hash()(key) % ALERT_PARTITIONS];
+
+	pthread_mutex_lock(&p->mutex);
+	struct alert_total & t = p->totals[key];
+	t.packets = flow->data.packets;
+	t.bytes = flow->data.bytes;
+	alert_report(key, &t);
+	pthread_mutex_unlock(&p->mutex);
+}
@@ -0,0 +1,137 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 08:03:51 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef ALERT_H_
+#define ALERT_H_
+
+#include <inttypes.h>
+#include <utility>
+
+#include "flow.h"
+#include "param.h"
+
+/*
+ * Threshold alerts. A key is reported as soon as an update of its totals
+ * reaches a packets or bytes limit, while records are still aggregated.
+ * Every limit is reported once per key (again in a window after the key
+ * fell below it). Alerts are written to their own stream as lines
+ *   #alert,LIMIT,KEY,packets,bytes
+ * with totals of the key known when the limit was reached.
+ *
+ * Port map and window hold totals of all files, they are checked as
+ * updated. Reader threads keep their own rbtree or ART index, a key whose
+ * totals reach limit / threads in an index is a candidate and its updates
+ * are batched (alert_batch) into totals shared by threads. A key reaching
+ * a limit is a candidate in at least one thread, a key reaching it only
+ * by parts below the share of more threads is reported after the indexes
+ * are merged (alert_final()).
+ *
+ * With '--cache' or '--block' an index sees updates of a key only when it
+ * is evicted or the block is flushed, alerts are delayed as long.
+ */
+
+#define ALERT_BATCH		256
+
+/**
+ * @brief  Key of alert totals, port or address
+ */
+typedef std::pair<uint64_t, uint64_t> alert_key_t;
+
+/**
+ * @brief  Update of a candidate key
+ */
+struct alert_update {
+	alert_key_t key;
+	uint64_t packets;
+	uint64_t bytes;
+};
+
+/**
+ * @brief  Updates of candidate keys of a thread not added to shared totals
+ */
+struct alert_batch {
+	uint64_t packets_share;							///< candidate packets, 0 if off
+	uint64_t bytes_share;							///< candidate bytes, 0 if off
+	unsigned count;
+	struct alert_update updates[ALERT_BATCH];
+};
+
+bool alert_init(const char * path);
+alert_key_t alert_key(const Flow * flow);
+void alert_emit(const Flow * flow, const char * limit);
+void alert_batch_init(struct alert_batch * b, unsigned threads);
+void alert_flush(struct alert_batch * b);
+void alert_final(const Flow * flow);
+
+/**
+ * @brief  Report limits reached by an update of a key
+ *
+ * @param flow key with its totals after the update
+ * @param packets packets added by the update
+ * @param bytes bytes added by the update
+ */
+static inline
+void alert_check(const Flow * flow, uint64_t packets, uint64_t bytes) {
+	const uint64_t packets_limit = Param::alert_packets();
+	const uint64_t bytes_limit = Param::alert_bytes();
+
+	if (packets_limit && flow->data.packets >= packets_limit
+			&& flow->data.packets - packets < packets_limit)
+		alert_emit(flow, "packets");
+
+	if (bytes_limit && flow->data.bytes >= bytes_limit
+			&& flow->data.bytes - bytes < bytes_limit)
+		alert_emit(flow, "bytes");
+}
+
+/**
+ * @brief  Is a key with totals a candidate?
+ */
+static inline
+bool alert_candidate(const struct alert_batch * b, uint64_t packets, uint64_t bytes) {
+	return (b->packets_share && packets >= b->packets_share)
+		|| (b->bytes_share && bytes >= b->bytes_share);
+}
+
+/**
+ * @brief  Batch an update of a thread index if the key is a candidate, the
+ *         first update of a candidate carries totals of the index
+ *
+ * @param b batch of the thread
+ * @param flow key with its totals in the index after the update
+ * @param packets packets added by the update
+ * @param bytes bytes added by the update
+ */
+static inline
+void alert_batch_add(struct alert_batch * b, const Flow * flow, uint64_t packets, uint64_t bytes) {
+	if (! alert_candidate(b, flow->data.packets, flow->data.bytes))
+		return;
+
+	struct alert_update * u = &b->updates[b->count++];
+
+	u->key = alert_key(flow);
+	if (alert_candidate(b, flow->data.packets - packets, flow->data.bytes - bytes)) {
+		u->packets = packets;
+		u->bytes = bytes;
+	} else {
+		u->packets = flow->data.packets;
+		u->bytes = flow->data.bytes;
+	}
+
+	if (b->count == ALERT_BATCH)
+		alert_flush(b);
+}
+
+#endif // ALERT_H_
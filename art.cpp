@@ -0,0 +1,474 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 11:02:17 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "art.h"
+
+#include <cassert>
+#include <cstring>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+enum art_type {
+	ART_NODE4 = 1,
+	ART_NODE16,
+	ART_NODE48,
+	ART_NODE256
+};
+
+/**
+ * @brief  Inner node header, keys are at most ART_MAX_KEY long so the
+ *         whole compressed prefix always fits
+ */
+struct art_node {
+	uint8_t type;
+	uint8_t prefix_len;
+	uint16_t num_children;
+	uint8_t prefix[ART_MAX_KEY];
+};
+
+struct art_node4 {
+	struct art_node n;
+	uint8_t keys[4];
+	void * children[4];
+};
+
+struct art_node16 {
+	struct art_node n;
+	uint8_t keys[16];
+	void * children[16];
+};
+
+struct art_node48 {
+	struct art_node n;
+	uint8_t index[256];		///< 0 means empty, otherwise child index + 1
+	void * children[48];
+};
+
+struct art_node256 {
+	struct art_node n;
+	void * children[256];
+};
+
+/*
+ * Leaves are tagged with the lowest bit set.
+ */
+#define IS_LEAF(X)		(((uintptr_t) (X)) & 1)
+#define MAKE_LEAF(X)		((void *) (((uintptr_t) (X)) | 1))
+#define LEAF_VALUE(X)	((void *) (((uintptr_t) (X)) & ~(uintptr_t) 1))
+
+static inline
+const uint8_t * leaf_key(const struct art_tree * tree, const void * leaf) {
+	return (const uint8_t *) LEAF_VALUE(leaf) + tree->key_offset;
+}
+
+/**
+ * @brief  Find child pointer for given key byte
+ *
+ * @return   pointer to child slot or NULL if there is no such child
+ */
+static inline
+void ** find_child(struct art_node * n, uint8_t c) {
+	switch (n->type) {
+		case ART_NODE4: {
+			struct art_node4 * p = (struct art_node4 *) n;
+			for (unsigned i = 0; i < n->num_children; ++i)
+				if (p->keys[i] == c)
+					return &p->children[i];
+			return NULL;
+		}
+		case ART_NODE16: {
+			struct art_node16 * p = (struct art_node16 *) n;
+#ifdef __SSE2__
+			__m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(c),
+											_mm_loadu_si128((__m128i *) p->keys));
+			unsigned bits = _mm_movemask_epi8(cmp) & ((1u << n->num_children) - 1);
+			if (bits)
+				return &p->children[__builtin_ctz(bits)];
+#else
+			for (unsigned i = 0; i < n->num_children; ++i)
+				if (p->keys[i] == c)
+					return &p->children[i];
+#endif
+			return NULL;
+		}
+		case ART_NODE48: {
+			struct art_node48 * p = (struct art_node48 *) n;
+			if (p->index[c])
+				return &p->children[p->index[c] - 1];
+			return NULL;
+		}
+		case ART_NODE256: {
+			struct art_node256 * p = (struct art_node256 *) n;
+			if (p->children[c])
+				return &p->children[c];
+			return NULL;
+		}
+		default:
+			assert(! "Unknown ART node type!");
+			return NULL;
+	}
+}
+
+static inline
+void copy_header(struct art_node * dst, const struct art_node * src) {
+	dst->num_children = src->num_children;
+	dst->prefix_len = src->prefix_len;
+	memcpy(dst->prefix, src->prefix, src->prefix_len);
+}
+
+static struct art_node4 * alloc_node4() {
+	struct art_node4 * n = new struct art_node4;
+	memset(n, 0, sizeof(*n));
+	n->n.type = ART_NODE4;
+	return n;
+}
+
+static void add_child(struct art_node * n, void ** ref, uint8_t c, void * child);
+
+static void add_child256(struct art_node256 * n, uint8_t c, void * child) {
+	n->n.num_children++;
+	n->children[c] = child;
+}
+
+static void add_child48(struct art_node48 * n, void ** ref, uint8_t c, void * child) {
+	if (n->n.num_children < 48) {
+		unsigned pos = 0;
+		while (n->children[pos])
+			pos++;
+		n->children[pos] = child;
+		n->index[c] = pos + 1;
+		n->n.num_children++;
+	} else {
+		struct art_node256 * bigger = new struct art_node256;
+		memset(bigger, 0, sizeof(*bigger));
+		bigger->n.type = ART_NODE256;
+		for (unsigned i = 0; i < 256; ++i)
+			if (n->index[i])
+				bigger->children[i] = n->children[n->index[i] - 1];
+		copy_header(&bigger->n, &n->n);
+		*ref = bigger;
+		delete n;
+		add_child256(bigger, c, child);
+	}
+}
+
+static void add_child16(struct art_node16 * n, void ** ref, uint8_t c, void * child) {
+	if (n->n.num_children < 16) {
+		unsigned pos = 0;
+		while (pos < n->n.num_children && n->keys[pos] < c)
+			pos++;
+		memmove(n->keys + pos + 1, n->keys + pos, n->n.num_children - pos);
+		memmove(n->children + pos + 1, n->children + pos,
+					(n->n.num_children - pos) * sizeof(void *));
+		n->keys[pos] = c;
+		n->children[pos] = child;
+		n->n.num_children++;
+	} else {
+		struct art_node48 * bigger = new struct art_node48;
+		memset(bigger, 0, sizeof(*bigger));
+		bigger->n.type = ART_NODE48;
+		for (unsigned i = 0; i < 16; ++i) {
+			bigger->children[i] = n->children[i];
+			bigger->index[n->keys[i]] = i + 1;
+		}
+		copy_header(&bigger->n, &n->n);
+		*ref = bigger;
+		delete n;
+		add_child48(bigger, ref, c, child);
+	}
+}
+
+static void add_child4(struct art_node4 * n, void ** ref, uint8_t c, void * child) {
+	if (n->n.num_children < 4) {
+		unsigned pos = 0;
+		while (pos < n->n.num_children && n->keys[pos] < c)
+			pos++;
+		memmove(n->keys + pos + 1, n->keys + pos, n->n.num_children - pos);
+		memmove(n->children + pos + 1, n->children + pos,
+					(n->n.num_children - pos) * sizeof(void *));
+		n->keys[pos] = c;
+		n->children[pos] = child;
+		n->n.num_children++;
+	} else {
+		struct art_node16 * bigger = new struct art_node16;
+		memset(bigger, 0, sizeof(*bigger));
+		bigger->n.type = ART_NODE16;
+		memcpy(bigger->keys, n->keys, 4);
+		memcpy(bigger->children, n->children, 4 * sizeof(void *));
+		copy_header(&bigger->n, &n->n);
+		*ref = bigger;
+		delete n;
+		add_child16(bigger, ref, c, child);
+	}
+}
+
+/**
+ * @brief  Fill a new node4 with its first two children, distinct keys
+ *
+ * @param n node to fill, not published yet
+ * @param c1 key of the first child
+ * @param child1 first child
+ * @param c2 key of the second child
+ * @param child2 second child
+ */
+static void fill_node4(struct art_node4 * n, uint8_t c1, void * child1, uint8_t c2, void * child2) {
+	const unsigned first = c1 > c2;
+
+	n->keys[first] = c1;
+	n->children[first] = child1;
+	n->keys[! first] = c2;
+	n->children[! first] = child2;
+	n->n.num_children = 2;
+}
+
+static void add_child(struct art_node * n, void ** ref, uint8_t c, void * child) {
+	switch (n->type) {
+		case ART_NODE4:
+			add_child4((struct art_node4 *) n, ref, c, child);
+			break;
+		case ART_NODE16:
+			add_child16((struct art_node16 *) n, ref, c, child);
+			break;
+		case ART_NODE48:
+			add_child48((struct art_node48 *) n, ref, c, child);
+			break;
+		case ART_NODE256:
+			add_child256((struct art_node256 *) n, c, child);
+			break;
+		default:
+			assert(! "Unknown ART node type!");
+			break;
+	}
+}
+
+/**
+ * @brief  Initialize tree
+ *
+ * @param tree tree to init
+ * @param key_len length of keys in bytes
+ * @param key_offset offset of key inside stored values
+ */
+void art_init(struct art_tree * tree, unsigned key_len, size_t key_offset) {
+	assert(key_len > 0 && key_len <= ART_MAX_KEY);
+
+	tree->root = NULL;
+	tree->size = 0;
+	tree->key_len = key_len;
+	tree->key_offset = key_offset;
+}
+
+static void destroy_node(void * node) {
+	struct art_node * n = (struct art_node *) node;
+
+	if (! node || IS_LEAF(node))
+		return;
+
+	switch (n->type) {
+		case ART_NODE4:
+			for (unsigned i = 0; i < n->num_children; ++i)
+				destroy_node(((struct art_node4 *) n)->children[i]);
+			delete (struct art_node4 *) n;
+			break;
+		case ART_NODE16:
+			for (unsigned i = 0; i < n->num_children; ++i)
+				destroy_node(((struct art_node16 *) n)->children[i]);
+			delete (struct art_node16 *) n;
+			break;
+		case ART_NODE48:
+			for (unsigned i = 0; i < 48; ++i)
+				destroy_node(((struct art_node48 *) n)->children[i]);
+			delete (struct art_node48 *) n;
+			break;
+		case ART_NODE256:
+			for (unsigned i = 0; i < 256; ++i)
+				destroy_node(((struct art_node256 *) n)->children[i]);
+			delete (struct art_node256 *) n;
+			break;
+	}
+}
+
+/**
+ * @brief  Free inner nodes of tree, stored values are left untouched
+ *
+ * @param tree tree to destroy
+ */
+void art_destroy(struct art_tree * tree) {
+	destroy_node(tree->root);
+	tree->root = NULL;
+	tree->size = 0;
+}
+
+/**
+ * @brief  Lookup value by key
+ *
+ * @param tree tree to search in
+ * @param key key of key_len bytes
+ *
+ * @return   stored value or NULL if not found
+ */
+void * art_lookup(const struct art_tree * tree, const uint8_t * key) {
+	void * node = tree->root;
+	unsigned depth = 0;
+
+	while (node) {
+		if (IS_LEAF(node)) {
+			if (! memcmp(leaf_key(tree, node), key, tree->key_len))
+				return LEAF_VALUE(node);
+			return NULL;
+		}
+
+		struct art_node * n = (struct art_node *) node;
+		if (n->prefix_len) {
+			if (memcmp(n->prefix, key + depth, n->prefix_len))
+				return NULL;
+			depth += n->prefix_len;
+		}
+
+		void ** child = find_child(n, key[depth]);
+		node = child ? *child : NULL;
+		depth++;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief  Insert value, the key is taken from the value
+ *
+ * @param tree tree to insert to
+ * @param value value to insert
+ *
+ * @return   already stored value with the same key, NULL if inserted
+ */
+void * art_insert(struct art_tree * tree, void * value) {
+	const uint8_t * key = (const uint8_t *) value + tree->key_offset;
+	void ** ref = &tree->root;
+	unsigned depth = 0;
+
+	assert(! IS_LEAF(value));
+
+	for (;;) {
+		void * node = *ref;
+
+		if (! node) {
+			*ref = MAKE_LEAF(value);
+			tree->size++;
+			return NULL;
+		}
+
+		if (IS_LEAF(node)) {
+			const uint8_t * other = leaf_key(tree, node);
+			unsigned lcp = 0;
+
+			while (depth + lcp < tree->key_len && other[depth + lcp] == key[depth + lcp])
+				lcp++;
+
+			if (depth + lcp == tree->key_len)
+				return LEAF_VALUE(node);
+
+			// split leaf into a node with common prefix
+			struct art_node4 * n = alloc_node4();
+			n->n.prefix_len = lcp;
+			memcpy(n->n.prefix, key + depth, lcp);
+			fill_node4(n, other[depth + lcp], node, key[depth + lcp], MAKE_LEAF(value));
+			*ref = n;
+			tree->size++;
+			return NULL;
+		}
+
+		struct art_node * n = (struct art_node *) node;
+		if (n->prefix_len) {
+			unsigned p = 0;
+
+			while (p < n->prefix_len && n->prefix[p] == key[depth + p])
+				p++;
+
+			if (p < n->prefix_len) {
+				// prefix differs, split it
+				struct art_node4 * parent = alloc_node4();
+				parent->n.prefix_len = p;
+				memcpy(parent->n.prefix, n->prefix, p);
+
+				uint8_t c = n->prefix[p];
+				n->prefix_len -= p + 1;
+				memmove(n->prefix, n->prefix + p + 1, n->prefix_len);
+
+				fill_node4(parent, c, n, key[depth + p], MAKE_LEAF(value));
+				*ref = parent;
+				tree->size++;
+				return NULL;
+			}
+
+			depth += n->prefix_len;
+		}
+
+		void ** child = find_child(n, key[depth]);
+		if (! child) {
+			add_child(n, ref, key[depth], MAKE_LEAF(value));
+			tree->size++;
+			return NULL;
+		}
+
+		ref = child;
+		depth++;
+	}
+}
+
+static void iter_node(const void * node, art_cb_t cb, void * data) {
+	const struct art_node * n = (const struct art_node *) node;
+
+	if (! node)
+		return;
+
+	if (IS_LEAF(node)) {
+		cb(LEAF_VALUE(node), data);
+		return;
+	}
+
+	switch (n->type) {
+		case ART_NODE4:
+			for (unsigned i = 0; i < n->num_children; ++i)
+				iter_node(((const struct art_node4 *) n)->children[i], cb, data);
+			break;
+		case ART_NODE16:
+			for (unsigned i = 0; i < n->num_children; ++i)
+				iter_node(((const struct art_node16 *) n)->children[i], cb, data);
+			break;
+		case ART_NODE48: {
+			const struct art_node48 * p = (const struct art_node48 *) n;
+			for (unsigned i = 0; i < 256; ++i)
+				if (p->index[i])
+					iter_node(p->children[p->index[i] - 1], cb, data);
+			break;
+		}
+		case ART_NODE256:
+			for (unsigned i = 0; i < 256; ++i)
+				iter_node(((const struct art_node256 *) n)->children[i], cb, data);
+			break;
+	}
+}
+
+/**
+ * @brief  Visit all values in ascending byte-wise key order
+ *
+ * @param tree tree to traverse
+ * @param cb callback called for every value
+ * @param data user data passed to callback
+ */
+void art_iter(const struct art_tree * tree, art_cb_t cb, void * data) {
+	iter_node(tree->root, cb, data);
+}
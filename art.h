@@ -0,0 +1,54 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 11:02:17 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef ART_H_
+#define ART_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/*
+ * Adaptive radix tree (ART) over fixed-length byte keys.
+ *
+ * Inner nodes grow from 4 to 16, 48 and 256 children, prefixes shared
+ * by all keys of a subtree are compressed into the node and a leaf is
+ * stored as soon as a key is unique (lazy expansion). A lookup touches
+ * at most one node per differing key byte and does not call any compare
+ * function until the leaf is reached.
+ *
+ * Leaves are user values (pointers aligned to at least 2 bytes). The key
+ * of a value is stored inside the value itself at key_offset, so no
+ * additional leaf allocation is needed.
+ */
+
+#define ART_MAX_KEY		16
+
+struct art_tree {
+	void * root;
+	size_t size;				///< number of values stored
+	unsigned key_len;			///< key length in bytes, at most ART_MAX_KEY
+	size_t key_offset;		///< offset of key inside a value
+};
+
+typedef void (*art_cb_t)(void * value, void * data);
+
+void art_init(struct art_tree * tree, unsigned key_len, size_t key_offset);
+void art_destroy(struct art_tree * tree);
+void * art_lookup(const struct art_tree * tree, const uint8_t * key);
+void * art_insert(struct art_tree * tree, void * value);
+void art_iter(const struct art_tree * tree, art_cb_t cb, void * data);
+
+#endif // ART_H_
+
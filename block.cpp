@@ -0,0 +1,122 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 05:21:36 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "block.h"
+#include "hugepage.h"
+
+#include <cassert>
+
+/**
+ * @brief  Init block
+ *
+ * @param b block to init
+ * @param capacity number of records in block
+ * @param key_len key length in bytes
+ * @param key_offset offset of key inside records
+ */
+void block_init(struct block * b, unsigned capacity, unsigned key_len, size_t key_offset) {
+	assert(capacity > 0);
+	assert(key_len <= BLOCK_KEY_MAX);
+
+	b->entries = (struct block_entry *) huge_alloc(capacity * sizeof(struct block_entry));
+	b->tmp = (struct block_entry *) huge_alloc(capacity * sizeof(struct block_entry));
+	assert(b->entries && b->tmp);
+	b->size = 0;
+	b->capacity = capacity;
+	b->key_len = key_len;
+	b->key_offset = key_offset;
+}
+
+/**
+ * @brief  Free block
+ *
+ * @param b block to free
+ */
+void block_free(struct block * b) {
+	huge_free(b->entries, b->capacity * sizeof(struct block_entry));
+	huge_free(b->tmp, b->capacity * sizeof(struct block_entry));
+	b->entries = b->tmp = NULL;
+}
+
+/**
+ * @brief  LSD radix sort of entries by key bytes
+ *
+ * Histograms of all key bytes are computed in a single pass. Bytes with
+ * all entries in one bucket (leading zeros of IPv4, masked out bits) are
+ * skipped, so masked keys need only a few scatter passes.
+ *
+ * @param b block to sort
+ */
+static void block_sort(struct block * b) {
+	static const unsigned RADIX = 256;
+	unsigned (* count)[RADIX] = new unsigned[BLOCK_KEY_MAX][RADIX];
+
+	memset(count, 0, BLOCK_KEY_MAX * sizeof(*count));
+
+	for (unsigned i = 0; i < b->size; ++i)
+		for (unsigned k = 0; k < b->key_len; ++k)
+			count[k][b->entries[i].key[k]]++;
+
+	for (int k = b->key_len - 1; k >= 0; --k) {
+		unsigned offset = 0;
+
+		if (count[k][b->entries[0].key[k]] == b->size)
+			continue;
+
+		for (unsigned d = 0; d < RADIX; ++d) {
+			unsigned c = count[k][d];
+			count[k][d] = offset;
+			offset += c;
+		}
+
+		for (unsigned i = 0; i < b->size; ++i)
+			b->tmp[count[k][b->entries[i].key[k]]++] = b->entries[i];
+
+		struct block_entry * swap = b->entries;
+		b->entries = b->tmp;
+		b->tmp = swap;
+	}
+
+	delete [] count;
+}
+
+/**
+ * @brief  Sort block and combine entries with the same key
+ *
+ * @param b block to process
+ *
+ * @return   number of unique keys, stored at the beginning of entries
+ */
+unsigned block_combine(struct block * b) {
+	unsigned n = 0;
+
+	if (! b->size)
+		return 0;
+
+	block_sort(b);
+
+	for (unsigned i = 1; i < b->size; ++i) {
+		struct block_entry * e = &b->entries[i];
+
+		if (! memcmp(b->entries[n].key, e->key, b->key_len)) {
+			b->entries[n].packets += e->packets;
+			b->entries[n].bytes += e->bytes;
+		} else
+			b->entries[++n] = *e;
+	}
+
+	b->size = 0;
+	return n + 1;
+}
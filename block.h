@@ -0,0 +1,72 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 05:21:36 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef BLOCK_H_
+#define BLOCK_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <cstring>
+
+/*
+ * Block of masked keys collected by a worker. When the block is full it is
+ * radix sorted, records with the same key are combined and only unique
+ * keys are passed to the aggregation index.
+ */
+
+#define BLOCK_KEY_MAX		16
+
+struct block_entry {
+	uint8_t key[BLOCK_KEY_MAX];
+	uint64_t packets;
+	uint64_t bytes;
+};
+
+struct block {
+	struct block_entry * entries;
+	struct block_entry * tmp;		///< scatter buffer for radix sort
+	unsigned size;
+	unsigned capacity;
+	unsigned key_len;					///< key length in bytes
+	size_t key_offset;				///< offset of key inside records
+};
+
+void block_init(struct block * b, unsigned capacity, unsigned key_len, size_t key_offset);
+void block_free(struct block * b);
+unsigned block_combine(struct block * b);
+
+/**
+ * @brief  Add record to block
+ *
+ * @param b block to add to
+ * @param record record holding key at key_offset
+ * @param packets record packets
+ * @param bytes record bytes
+ *
+ * @return   true if block is full
+ */
+inline bool block_add(struct block * b, const void * record,
+								uint64_t packets, uint64_t bytes) {
+	struct block_entry * e = &b->entries[b->size++];
+
+	memcpy(e->key, (const uint8_t *) record + b->key_offset, b->key_len);
+	e->packets = packets;
+	e->bytes = bytes;
+
+	return b->size == b->capacity;
+}
+
+#endif // BLOCK_H_
+
@@ -0,0 +1,128 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 04:17:36 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "bucket.h"
+
+#include <cstring>
+#include <cstdlib>
+
+#define BUCKET_DIGITS		12
+
+/**
+ * @brief  Parse time written as YYYYMMDDhhmm
+ *
+ * @param str string to parse
+ * @param t parsed time
+ *
+ * @return   false if str is not a time
+ */
+bool bucket_parse(const char * str, time_t * t) {
+	struct tm tm;
+	int val[5];
+	static const int digits[5] = { 4, 2, 2, 2, 2 };
+
+	if (strlen(str) != BUCKET_DIGITS || strspn(str, "0123456789") != BUCKET_DIGITS)
+		return false;
+
+	for (unsigned i = 0; i < sizeof(digits) / sizeof(digits[0]); ++i) {
+		val[i] = 0;
+		for (int j = 0; j < digits[i]; ++j)
+			val[i] = val[i] * 10 + *str++ - '0';
+	}
+
+	if (val[1] < 1 || val[1] > 12 || val[2] < 1 || val[2] > 31 || val[3] > 23 || val[4] > 59)
+		return false;
+
+	memset(&tm, 0, sizeof(tm));
+	tm.tm_year = val[0] - 1900;
+	tm.tm_mon = val[1] - 1;
+	tm.tm_mday = val[2];
+	tm.tm_hour = val[3];
+	tm.tm_min = val[4];
+
+	*t = timegm(&tm);
+	return *t != (time_t) -1;
+}
+
+/**
+ * @brief  Get time of a record file from its name
+ *
+ * @param name file path, time follows the last dot of the file name
+ * @param t time of the file
+ *
+ * @return   false if the name holds no time
+ */
+bool bucket_file_time(const char * name, time_t * t) {
+	const char * base = strrchr(name, '/');
+	const char * dot;
+
+	base = base ? base + 1 : name;
+
+	if (! (dot = strrchr(base, '.')))
+		return false;
+
+	return bucket_parse(dot + 1, t);
+}
+
+/**
+ * @brief  Parse bucket width written as N followed by 'm', 'h' or 'd'
+ *
+ * @param str string to parse (e.g. 5m)
+ * @param width width in seconds
+ *
+ * @return   false if str is not a width
+ */
+bool bucket_width(const char * str, time_t * width) {
+	char * endptr = NULL;
+	unsigned long val = strtoul(str, &endptr, 10);
+
+	if (endptr == str || str[0] == '-' || val == 0 || val > 366 * 24 * 60
+			|| *endptr == '\0' || endptr[1] != '\0')
+		return false;
+
+	switch (*endptr) {
+		case 'm':
+			*width = val * 60;
+			break;
+		case 'h':
+			*width = val * BUCKET_1H;
+			break;
+		case 'd':
+			*width = val * BUCKET_1D;
+			break;
+		default:
+			return false;
+	}
+
+	return *width <= 366 * (time_t) BUCKET_1D;
+}
+
+/**
+ * @brief  Write time as YYYYMMDDhhmm
+ *
+ * @param t time
+ *
+ * @return   time as in file names
+ */
+std::string bucket_format(time_t t) {
+	char buf[32];
+	struct tm tm;
+
+	gmtime_r(&t, &tm);
+	strftime(buf, sizeof(buf), "%Y%m%d%H%M", &tm);
+
+	return buf;
+}
+
@@ -0,0 +1,54 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 04:17:36 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef BUCKET_H_
+#define BUCKET_H_
+
+#include <ctime>
+#include <string>
+
+/*
+ * Time buckets of record files. Records carry no time, files are named by
+ * the collector as nfcapd.YYYYMMDDhhmm, the name is taken as the time of
+ * all records of the file.
+ *
+ * Times are kept as seconds of the wall clock of names (no time zone is
+ * applied), buckets start at multiples of their width.
+ */
+
+#define BUCKET_5M			(5 * 60)
+#define BUCKET_1H			(60 * 60)
+#define BUCKET_1D			(24 * 60 * 60)
+
+bool bucket_parse(const char * str, time_t * t);
+bool bucket_file_time(const char * name, time_t * t);
+bool bucket_width(const char * str, time_t * width);
+std::string bucket_format(time_t t);
+
+/**
+ * @brief  Get start of the bucket holding a time
+ *
+ * @param t time
+ * @param width bucket width in seconds
+ *
+ * @return   bucket start
+ */
+static inline
+time_t bucket_start(time_t t, time_t width) {
+	return t - t % width;
+}
+
+#endif // BUCKET_H_
+
@@ -0,0 +1,200 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 09:27:50 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "checkpoint.h"
+
+#include <cstring>
+#include <unistd.h>
+
+#include "common.h"
+
+static const char SNAPSHOT_MAGIC[8] = { 'F', 'L', 'O', 'W', 'C', 'K', 'P', '1' };
+
+#define SNAPSHOT_KEY_MAX		16
+
+/**
+ * @brief  Write u32 to snapshot
+ */
+static inline
+bool put_u32(FILE * f, uint32_t val) {
+	return fwrite(&val, sizeof(val), 1, f) == 1;
+}
+
+/**
+ * @brief  Read u32 from snapshot
+ */
+static inline
+bool get_u32(FILE * f, uint32_t & val) {
+	return fread(&val, sizeof(val), 1, f) == 1;
+}
+
+/**
+ * @brief  Start writing snapshot
+ *
+ * @param w writer to init
+ * @param path final snapshot path, PATH.tmp is written first
+ * @param aggregation aggregation type
+ * @param mask aggregation mask
+ * @param key_len key length in bytes
+ * @param files completed files
+ *
+ * @return   false on error
+ */
+bool snapshot_begin(struct snapshot_writer * w, const std::string & path,
+							unsigned aggregation, unsigned mask, unsigned key_len,
+							const std::vector<std::string> & files) {
+	uint64_t zero = 0;
+	bool ok;
+
+	w->tmp = path + ".tmp";
+	w->key_len = key_len;
+	w->count = 0;
+
+	if (! (w->f = fopen(w->tmp.c_str(), "wb"))) {
+		perror(w->tmp.c_str());
+		return false;
+	}
+
+	ok = fwrite(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC), 1, w->f) == 1
+		&& put_u32(w->f, aggregation)
+		&& put_u32(w->f, mask)
+		&& put_u32(w->f, key_len)
+		&& put_u32(w->f, files.size());
+
+	for (auto & name : files) {
+		ok = ok && put_u32(w->f, name.size())
+			&& fwrite(name.data(), 1, name.size(), w->f) == name.size();
+	}
+
+	w->count_pos = ftell(w->f);
+	ok = ok && fwrite(&zero, sizeof(zero), 1, w->f) == 1;
+
+	if (! ok) {
+		fclose(w->f);
+		unlink(w->tmp.c_str());
+	}
+
+	return ok;
+}
+
+/**
+ * @brief  Append record to snapshot, errors are reported by snapshot_end()
+ *
+ * @param w writer to use
+ * @param key record key
+ * @param packets record packets
+ * @param bytes record bytes
+ */
+void snapshot_record(struct snapshot_writer * w, const uint8_t * key,
+							uint64_t packets, uint64_t bytes) {
+	fwrite(key, 1, w->key_len, w->f);
+	fwrite(&packets, sizeof(packets), 1, w->f);
+	fwrite(&bytes, sizeof(bytes), 1, w->f);
+	w->count++;
+}
+
+/**
+ * @brief  Finish snapshot and atomically replace the previous one
+ *
+ * @param w writer to finish
+ * @param path final snapshot path
+ *
+ * @return   false on error, previous snapshot is kept
+ */
+bool snapshot_end(struct snapshot_writer * w, const std::string & path) {
+	bool ok = ! ferror(w->f)
+		&& fseek(w->f, w->count_pos, SEEK_SET) == 0
+		&& fwrite(&w->count, sizeof(w->count), 1, w->f) == 1
+		&& fflush(w->f) == 0
+		&& fsync(fileno(w->f)) == 0;
+
+	ok = (fclose(w->f) == 0) && ok;
+
+	if (! ok || rename(w->tmp.c_str(), path.c_str())) {
+		unlink(w->tmp.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Load snapshot
+ *
+ * @param path snapshot path
+ * @param aggregation expected aggregation type
+ * @param mask expected aggregation mask
+ * @param key_len expected key length
+ * @param files completed files are stored here
+ * @param cb called for every record
+ * @param data user data passed to cb
+ *
+ * @return   false if snapshot is broken or does not match aggregation
+ */
+bool snapshot_load(const std::string & path, unsigned aggregation, unsigned mask,
+							unsigned key_len, std::vector<std::string> & files,
+							snapshot_cb_t cb, void * data) {
+	char magic[sizeof(SNAPSHOT_MAGIC)];
+	uint32_t agg, msk, len, count;
+	uint64_t records;
+	FILE * f;
+	bool ok;
+
+	if (! (f = fopen(path.c_str(), "rb"))) {
+		perror(path.c_str());
+		return false;
+	}
+
+	ok = fread(magic, sizeof(magic), 1, f) == 1
+		&& ! memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic))
+		&& get_u32(f, agg) && get_u32(f, msk) && get_u32(f, len)
+		&& get_u32(f, count);
+
+	if (ok && (agg != aggregation || msk != mask || len != key_len)) {
+		err() << "Snapshot '" << path << "' was taken with a different aggregation!\n";
+		fclose(f);
+		return false;
+	}
+
+	for (uint32_t i = 0; ok && i < count; ++i) {
+		uint32_t size;
+
+		if ((ok = get_u32(f, size))) {
+			std::string name(size, '\0');
+			ok = fread(&name[0], 1, size, f) == size;
+			files.push_back(name);
+		}
+	}
+
+	ok = ok && fread(&records, sizeof(records), 1, f) == 1;
+
+	for (uint64_t i = 0; ok && i < records; ++i) {
+		uint8_t key[SNAPSHOT_KEY_MAX];
+		uint64_t packets, bytes;
+
+		ok = fread(key, 1, key_len, f) == key_len
+			&& fread(&packets, sizeof(packets), 1, f) == 1
+			&& fread(&bytes, sizeof(bytes), 1, f) == 1;
+
+		if (ok)
+			cb(key, packets, bytes, data);
+	}
+
+	if (! ok)
+		err() << "Snapshot '" << path << "' is broken!\n";
+
+	fclose(f);
+	return ok;
+}
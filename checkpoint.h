@@ -0,0 +1,60 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 09:27:50 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <inttypes.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * Snapshot of aggregation state: completed files and partial aggregates.
+ *
+ * Layout (host byte order):
+ *   "FLOWCKP1", u32 aggregation, u32 mask, u32 key length,
+ *   u32 file count, files as u32 length + path,
+ *   u64 record count, records as key + u64 packets + u64 bytes
+ *
+ * A key may occur in more records, they are summed on load.
+ */
+
+/**
+ * @brief  Snapshot being written
+ */
+struct snapshot_writer {
+	FILE * f;
+	std::string tmp;				///< written here, renamed when complete
+	unsigned key_len;
+	uint64_t count;
+	long count_pos;				///< position of record count
+};
+
+typedef void (*snapshot_cb_t)(const uint8_t * key,
+										uint64_t packets, uint64_t bytes, void * data);
+
+bool snapshot_begin(struct snapshot_writer * w, const std::string & path,
+							unsigned aggregation, unsigned mask, unsigned key_len,
+							const std::vector<std::string> & files);
+void snapshot_record(struct snapshot_writer * w, const uint8_t * key,
+							uint64_t packets, uint64_t bytes);
+bool snapshot_end(struct snapshot_writer * w, const std::string & path);
+bool snapshot_load(const std::string & path, unsigned aggregation, unsigned mask,
+							unsigned key_len, std::vector<std::string> & files,
+							snapshot_cb_t cb, void * data);
+
+#endif // CHECKPOINT_H_
+
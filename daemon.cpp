@@ -0,0 +1,291 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 11:48:20 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "daemon.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <streambuf>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "common.h"
+#include "param.h"
+#include "aggregation.h"
+
+static volatile sig_atomic_t daemon_stop = 0;
+
+/**
+ * @brief  Stop serving on SIGINT/SIGTERM
+ */
+static
+void daemon_signal(int sig) {
+	UNUSED(sig);
+	daemon_stop = 1;
+}
+
+/**
+ * @brief  Output buffer of a connection. Flushes requested by std::endl are
+ *         ignored, data is sent when the buffer is full or drained.
+ */
+class daemon_buf : public std::streambuf {
+	public:
+		daemon_buf(int fd) : m_fd(fd) {
+			setp(m_buf, m_buf + sizeof(m_buf));
+		}
+
+		/**
+		 * @brief  Send buffered data
+		 *
+		 * @return   false if client is gone
+		 */
+		bool drain() {
+			for (char * p = pbase(); p < pptr(); /**/) {
+				ssize_t ret = write(m_fd, p, pptr() - p);
+
+				if (ret < 0 && errno == EINTR)
+					continue;
+				if (ret <= 0)
+					return false;
+				p += ret;
+			}
+
+			setp(m_buf, m_buf + sizeof(m_buf));
+			return true;
+		}
+
+	protected:
+		int overflow(int c) {
+			if (! drain())
+				return EOF;
+
+			if (c != EOF) {
+				*pptr() = c;
+				pbump(1);
+			}
+
+			return c == EOF ? 0 : c;
+		}
+
+	private:
+		int m_fd;
+		char m_buf[1 << 16];
+};
+
+/**
+ * @brief  Fill Unix socket address
+ *
+ * @return   false if path is too long
+ */
+static
+bool daemon_addr(struct sockaddr_un * addr, const char * path) {
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		err() << "Socket path '" << path << "' too long!\n";
+		return false;
+	}
+
+	strcpy(addr->sun_path, path);
+	return true;
+}
+
+/**
+ * @brief  Answer query of a connection, runs in a forked child
+ *
+ * @param fd connection
+ * @param store records to aggregate
+ *
+ * @return   false if query failed
+ */
+static
+bool daemon_answer(int fd, const struct flow_store * store) {
+	char line[DAEMON_QUERY_MAX];
+	std::vector<char *> args;
+	size_t len = 0;
+	char * save = NULL;
+	ssize_t ret;
+
+	while (len < sizeof(line) - 1 && (ret = read(fd, line + len, sizeof(line) - 1 - len)) > 0) {
+		len += ret;
+		if (memchr(line, '\n', len))
+			break;
+	}
+	line[len] = '\0';
+
+	// output and errors go to client
+	dup2(fd, STDOUT_FILENO);
+	dup2(fd, STDERR_FILENO);
+	close(fd);
+
+	if (! memchr(line, '\n', len)) {
+		err() << "Query has to be a single line up to " << DAEMON_QUERY_MAX << " bytes!\n";
+		return false;
+	}
+
+	for (char * tok = strtok_r(line, " \t\r\n", &save); tok; tok = strtok_r(NULL, " \t\r\n", &save))
+		args.push_back(tok);
+
+	if (! Param::getInstance().query(args.size(), args.data()))
+		return false;
+
+	daemon_buf buf(STDOUT_FILENO);
+	std::streambuf * orig = std::cout.rdbuf(&buf);
+	bool ok = Aggregation::run_store(store);
+
+	ok = buf.drain() && ok;
+	std::cout.rdbuf(orig);
+
+	return ok;
+}
+
+/**
+ * @brief  Serve queries until SIGINT or SIGTERM
+ *
+ * @param path Unix socket path, replaced if exists
+ * @param store records to aggregate
+ *
+ * @return   false if socket could not be set up
+ */
+bool daemon_serve(const char * path, const struct flow_store * store) {
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	int fd;
+
+	if (! daemon_addr(&addr, path))
+		return false;
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		perror("socket");
+		return false;
+	}
+
+	unlink(path);
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) || listen(fd, 16)) {
+		perror(path);
+		close(fd);
+		return false;
+	}
+
+	// no SA_RESTART, accept() has to return on signal
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = daemon_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	while (! daemon_stop) {
+		int conn = accept(fd, NULL, NULL);
+		pid_t pid;
+
+		if (conn < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			perror("accept");
+			break;
+		}
+
+		// reap answered queries
+		while (waitpid(-1, NULL, WNOHANG) > 0)
+			;
+
+		std::cout.flush();
+		std::cerr.flush();
+
+		if ((pid = fork()) == 0) {
+			bool ok;
+
+			close(fd);
+			ok = daemon_answer(conn, store);
+			std::cout.flush();
+			std::cerr.flush();
+			_exit(ok ? 0 : 1);
+		}
+
+		if (pid < 0)
+			perror("fork");
+		close(conn);
+	}
+
+	close(fd);
+	unlink(path);
+
+	while (wait(NULL) > 0)
+		;
+
+	return daemon_stop;
+}
+
+/**
+ * @brief  Send query to daemon and print the answer
+ *
+ * @param path Unix socket path
+ * @param argc arguments count
+ * @param argv[] arguments vector, '-a' and '-s' are sent
+ *
+ * @return   false if daemon is not available or query failed
+ */
+bool daemon_query(const char * path, int argc, char * argv[]) {
+	struct sockaddr_un addr;
+	std::string query;
+	char buf[1 << 16];
+	bool first = true;
+	bool ok = true;
+	ssize_t ret;
+	int fd;
+
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (! strcmp(argv[i], "-a") || ! strcmp(argv[i], "-s")) {
+			query = query + argv[i] + " " + argv[i + 1] + " ";
+			++i;
+		}
+	}
+	query += "\n";
+
+	if (! daemon_addr(&addr, path))
+		return false;
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		perror("socket");
+		return false;
+	}
+
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr))
+			|| write(fd, query.data(), query.size()) != (ssize_t) query.size()) {
+		perror(path);
+		close(fd);
+		return false;
+	}
+
+	while ((ret = read(fd, buf, sizeof(buf))) > 0) {
+		// daemon reports errors instead of output
+		if (first && ! strncmp(buf, "ERROR: ", std::min<size_t>(ret, 7)))
+			ok = false;
+		first = false;
+
+		if (fwrite(buf, 1, ret, ok ? stdout : stderr) != (size_t) ret)
+			break;
+	}
+
+	close(fd);
+	return ok && ret == 0;
+}
@@ -0,0 +1,34 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 11:48:20 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef DAEMON_H_
+#define DAEMON_H_
+
+#include "store.h"
+
+/*
+ * Daemon answering queries over a Unix socket. A query is a single line of
+ * arguments ("-a srcip4/24 -s bytes"), the answer is the usual output and
+ * the connection is closed. Errors are sent as "ERROR: ..." lines. Every
+ * query is answered by a forked child, so the store is shared read-only.
+ */
+
+#define DAEMON_QUERY_MAX		1024
+
+bool daemon_serve(const char * path, const struct flow_store * store);
+bool daemon_query(const char * path, int argc, char * argv[]);
+
+#endif // DAEMON_H_
+
@@ -17,6 +17,9 @@
 #define DIRUSE_H_
 
 #include <list>
+#include <set>
+#include <string>
+#include <vector>
 #include <fstream>
 #include <ios>
 #include <stdio.h>
@@ -31,6 +34,8 @@
 #include "common.h"
 #include "flow.h"
 #include "file_list.h"
+#include "sidecar.h"
+#include "sorted.h"
 
 /**
  * @brief  Filepool structure
@@ -59,7 +64,9 @@ class Filepool {
 					struct dirent *ent;
 					if ((dir = opendir(path.c_str())) != NULL) {
 						while ((ent = readdir(dir)) != NULL) {
-							if (strcmp(ent->d_name, ".") && strcmp(ent->d_name, "..")) {
+							// sidecars (and their temporaries) are not records
+							if (strcmp(ent->d_name, ".") && strcmp(ent->d_name, "..")
+									&& ! strstr(ent->d_name, SIDECAR_SUFFIX)) {
 								if (stat((path + "/" + ent->d_name).c_str(), &s2) == 0) {
 
 									if (s2.st_mode & S_IFREG) {
@@ -108,6 +115,79 @@ class Filepool {
 			return ret;
 		}
 
+		/**
+		 * @brief  Initialize filepool from a list of files
+		 *
+		 * @param paths files to use
+		 *
+		 * @return   true on succes
+		 */
+		bool init(const std::vector<std::string> & paths) {
+			linked_list_init(&list);
+
+			for (auto & path : paths) {
+				if (! insert(path))
+					return false;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief  Add a file to the pool
+		 *
+		 * @param path file to add, it becomes the last node of list
+		 *
+		 * @return   true on success
+		 */
+		bool add(const std::string & path) {
+			return insert(path);
+		}
+
+		/**
+		 * @brief  Get total size of files in the pool
+		 *
+		 * @return   size in bytes
+		 */
+		uint64_t size() {
+			uint64_t ret = 0;
+			struct stat s;
+
+			for (struct linked_list_node * i = linked_list_last(&list); i; i = i->prev) {
+				if (fstat(fileno(i->f), &s) == 0)
+					ret += s.st_size;
+			}
+
+			return ret;
+		}
+
+		/**
+		 * @brief  Remove files from the pool
+		 *
+		 * @param names paths of files to remove
+		 *
+		 * @return   number of files removed
+		 */
+		size_t drop(const std::set<std::string> & names) {
+			struct linked_list_node ** link = &list.end;
+			size_t ret = 0;
+
+			while (*link) {
+				struct linked_list_node * i = *link;
+
+				if (names.count(i->name)) {
+					*link = i->prev;
+					fclose(i->f);
+					free(i->name);
+					delete i;
+					ret++;
+				} else
+					link = &i->prev;
+			}
+
+			return ret;
+		}
+
 		/**
 		 * @brief  Get singleton instance
 		 *
@@ -132,6 +212,7 @@ class Filepool {
 			for (struct linked_list_node * i = linked_list_last(&list); i; /**/){
 				struct linked_list_node * tmp = i->prev;
 				fclose(i->f);
+				free(i->name);
 				delete i;
 				i = tmp;
 			}
@@ -152,9 +233,15 @@ class Filepool {
 			if ((node->f = fopen(fname.c_str(), "rb")) == NULL) {
 				perror(fname.c_str());
 				err() << "Failed to add to pool!\n";
+				delete node;
 				return false;
 			}
 
+			node->name = strdup(fname.c_str());
+
+			// compacted segments are read as record files
+			sorted_skip(node->f);
+
 			linked_list_push(node, &list);
 
 			return true;
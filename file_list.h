@@ -28,6 +28,7 @@
 struct linked_list_node {
 	struct linked_list_node * prev;
 	FILE * f;
+	char * name;			///< path of the file
 };
 
 /**
@@ -0,0 +1,111 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 03:20:47 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "filter.h"
+
+#include <cstdlib>
+#include <string>
+
+/**
+ * @brief  Init filter matching all records
+ *
+ * @param f filter to init
+ */
+void filter_init(struct flow_filter * f) {
+	memset(f, 0, sizeof(*f));
+	f->src_port = -1;
+	f->dst_port = -1;
+}
+
+/**
+ * @brief  Does filter match all records?
+ *
+ * @param f filter to check
+ *
+ * @return   true if no criterion is set
+ */
+bool filter_empty(const struct flow_filter * f) {
+	return ! f->src.set && ! f->dst.set && f->src_port < 0 && f->dst_port < 0;
+}
+
+/**
+ * @brief  Parse network, ADDR or ADDR/LEN, IPv4 or IPv6
+ *
+ * @param arg argument to parse
+ * @param net network is stored here
+ *
+ * @return   false if argument is not a network
+ */
+bool filter_parse_net(const char * arg, struct filter_net * net) {
+	std::string addr(arg);
+	size_t slash = addr.find('/');
+	bool ipv6 = addr.find(':') != std::string::npos;
+	unsigned max = ipv6 ? 128 : 32;
+	unsigned len = max;
+
+	if (slash != std::string::npos) {
+		char * endptr = NULL;
+		unsigned long val = strtoul(addr.c_str() + slash + 1, &endptr, 10);
+
+		if (slash + 1 == addr.size() || *endptr != '\0' || val > max)
+			return false;
+		len = val;
+		addr.resize(slash);
+	}
+
+	memset(&net->addr, 0, sizeof(net->addr));
+
+	if (ipv6) {
+		if (inet_pton(AF_INET6, addr.c_str(), &net->addr) != 1)
+			return false;
+	} else {
+		if (inet_pton(AF_INET, addr.c_str(), net->addr.s6_addr + 12) != 1)
+			return false;
+		len += 96;
+	}
+
+	// clear host bits, network is then the lowest address of the range
+	for (unsigned i = 0; i < sizeof(net->addr); ++i) {
+		if (8 * i >= len)
+			net->addr.s6_addr[i] = 0;
+		else if (8 * (i + 1) > len)
+			net->addr.s6_addr[i] &= 0xff00 >> (len - 8 * i);
+	}
+
+	net->family = ipv6 ? AF_INET6 : AF_INET;
+	net->len = len;
+	net->set = true;
+
+	return true;
+}
+
+/**
+ * @brief  Get address range of network
+ *
+ * @param net network
+ * @param lo lowest address is stored here
+ * @param hi highest address is stored here
+ */
+void filter_net_range(const struct filter_net * net, struct in6_addr * lo, struct in6_addr * hi) {
+	*lo = net->addr;
+	*hi = net->addr;
+
+	for (unsigned i = 0; i < sizeof(hi->s6_addr); ++i) {
+		if (8 * i >= net->len)
+			hi->s6_addr[i] = 0xff;
+		else if (8 * (i + 1) > net->len)
+			hi->s6_addr[i] |= 0xff >> (net->len - 8 * i);
+	}
+}
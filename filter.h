@@ -0,0 +1,98 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 03:20:47 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <cstring>
+
+/*
+ * Record filter, records not matching are skipped when read. IPv4
+ * networks are kept as IPv4-compatible IPv6 (::a.b.c.d), the way Flow
+ * stores IPv4 addresses, with the prefix length moved by 96 bits. The
+ * family is kept as well, a network matches only records of its family
+ * (::/0 does not match IPv4 records, 0.0.0.0/0 no IPv6 ones in ::/96).
+ */
+
+/**
+ * @brief  Network of a filter
+ */
+struct filter_net {
+	bool set;
+	uint32_t family;						///< AF_INET or AF_INET6
+	struct in6_addr addr;				///< network, host bits cleared
+	unsigned len;							///< prefix length in bits, up to 128
+};
+
+/**
+ * @brief  Record filter, criteria not set match all records
+ */
+struct flow_filter {
+	struct filter_net src;
+	struct filter_net dst;
+	int src_port;							///< host order, -1 if not set
+	int dst_port;							///< host order, -1 if not set
+};
+
+void filter_init(struct flow_filter * f);
+bool filter_empty(const struct flow_filter * f);
+bool filter_parse_net(const char * arg, struct filter_net * net);
+void filter_net_range(const struct filter_net * net, struct in6_addr * lo, struct in6_addr * hi);
+
+/**
+ * @brief  Is address in network?
+ *
+ * @param net network
+ * @param family family of the address, AF_INET or AF_INET6
+ * @param addr address to check
+ *
+ * @return   true if the family and the prefix match
+ */
+inline bool filter_net_match(const struct filter_net * net, uint32_t family,
+										const struct in6_addr * addr) {
+	unsigned bytes = net->len / 8;
+	unsigned bits = net->len % 8;
+
+	if (family != net->family || memcmp(addr, &net->addr, bytes))
+		return false;
+
+	return ! bits || ! ((addr->s6_addr[bytes] ^ net->addr.s6_addr[bytes]) & (0xff00 >> bits));
+}
+
+/**
+ * @brief  Does record match filter?
+ *
+ * @param f filter
+ * @param family family of the record, AF_INET or AF_INET6
+ * @param src source address
+ * @param dst destination address
+ * @param src_port source port, network order
+ * @param dst_port destination port, network order
+ *
+ * @return   true if all set criteria match
+ */
+inline bool filter_match(const struct flow_filter * f, uint32_t family, const struct in6_addr * src,
+								const struct in6_addr * dst, uint16_t src_port, uint16_t dst_port) {
+	return (! f->src.set || filter_net_match(&f->src, family, src))
+		&& (! f->dst.set || filter_net_match(&f->dst, family, dst))
+		&& (f->src_port < 0 || ntohs(src_port) == f->src_port)
+		&& (f->dst_port < 0 || ntohs(dst_port) == f->dst_port);
+}
+
+#endif // FILTER_H_
+
@@ -32,6 +32,7 @@
 
 #include "file_list.h"
 #include "linked_list.h"
+#include "param.h"
 
 
 /**
@@ -52,6 +53,12 @@ class Flow {
 		struct rbtree_node			node_agg;		// node for aggregation tree
 		struct bstree_node			node_sort;		// node for sort tree
 
+		/*
+		 * Flows come from per-thread pools with --hugepages, see hugepage.cpp.
+		 */
+		static void * operator new(size_t size);
+		static void operator delete(void * ptr);
+
 		/**
 		 * @brief  Is source an IPv4?
 		 *
@@ -116,6 +123,20 @@ class Flow {
 			std::cout << "#dstip,packets,bytes\n";
 		}
 
+		/**
+		 * @brief  Print source prefix header
+		 */
+		static void print_srcprefix_header() {
+			std::cout << "#srcip/len,packets,bytes\n";
+		}
+
+		/**
+		 * @brief  Print destination prefix header
+		 */
+		static void print_dstprefix_header() {
+			std::cout << "#dstip/len,packets,bytes\n";
+		}
+
 		/**
 		 * @brief  Print destination port header
 		 */
@@ -151,7 +172,7 @@ class Flow {
 		static void print_dstip(const Flow * flow) {
 			char dstip[INET6_ADDRSTRLEN];
 
-			if (is_ipv4_src(flow))
+			if (is_ipv4_dst(flow))
 				inet_ntop(AF_INET, (((char *)&flow->data.dst_addr) + 12), dstip, INET6_ADDRSTRLEN);
 			else
 				inet_ntop(AF_INET6, &flow->data.dst_addr, dstip, INET6_ADDRSTRLEN);
@@ -259,14 +280,14 @@ class Flow {
 		}
 
 		/**
-		 * @brief  Get flow from a file
+		 * @brief  Get flow from a file, filter is not applied
 		 *
 		 * @param flow read Flow
 		 * @param node node describing file
 		 *
 		 * @return   true on success
 		 */
-		static bool getFlow(Flow * flow, struct linked_list_node * node) {
+		static bool readFlow(Flow * flow, struct linked_list_node * node) {
 			int c = fread(&flow->data, sizeof(struct Flow::data), 1, node->f);
 
 			if (! feof(node->f) && c > 0) {
@@ -276,6 +297,27 @@ class Flow {
 			} else
 				return false;
 		}
+
+		/**
+		 * @brief  Get flow matching filter from a file
+		 *
+		 * @param flow read Flow
+		 * @param node node describing file
+		 *
+		 * @return   true on success
+		 */
+		static bool getFlow(Flow * flow, struct linked_list_node * node) {
+			const struct flow_filter * filter = Param::filter();
+
+			while (readFlow(flow, node)) {
+				if (! filter || filter_match(filter, flow->data.sa_family,
+							&flow->data.src_addr, &flow->data.dst_addr,
+							flow->data.src_port, flow->data.dst_port))
+					return true;
+			}
+
+			return false;
+		}
 };
 
 #endif // FLOW_H_
@@ -0,0 +1,448 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 09:12:40 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "hhh.h"
+
+#include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+/*
+ * Helpers for keys
+ */
+static inline
+bool key_eq(const struct hhh_key * a, const struct hhh_key * b) {
+	return a->hi == b->hi && a->lo == b->lo;
+}
+
+static inline
+unsigned key_hash(const struct hhh_key * k) {
+	uint64_t h = (k->hi ^ (k->lo * 0x9E3779B97F4A7C15ULL)) * 0xC2B2AE3D27D4EB4FULL;
+	return (unsigned)(h >> 32);
+}
+
+/**
+ * @brief  Mask key to prefix of length len
+ *
+ * @param dst masked key
+ * @param src key to mask
+ * @param width address width (32 or 128)
+ * @param len prefix length, 0 < len <= width
+ */
+static inline
+void key_mask(struct hhh_key * dst, const struct hhh_key * src,
+					unsigned width, unsigned len) {
+	if (width == 32) {
+		dst->hi = 0;
+		dst->lo = src->lo & (0xFFFFFFFFULL << (32 - len)) & 0xFFFFFFFFULL;
+	} else if (len <= 64) {
+		dst->hi = src->hi & (len == 64 ? ~0ULL : ~(~0ULL >> len));
+		dst->lo = 0;
+	} else {
+		dst->hi = src->hi;
+		dst->lo = src->lo & (len == 128 ? ~0ULL : ~(~0ULL >> (len - 64)));
+	}
+}
+
+/*
+ * Space-Saving summary
+ */
+static void ss_init(struct space_saving * ss, unsigned capacity) {
+	unsigned index_size = 1;
+
+	while (index_size < 2 * capacity)
+		index_size <<= 1;
+
+	ss->capacity = capacity;
+	ss->size = 0;
+	ss->entries = new struct ss_entry[capacity];
+	ss->heap = new unsigned[capacity];
+	ss->index = new int[index_size];
+	ss->index_mask = index_size - 1;
+	memset(ss->index, 0xFF, index_size * sizeof(int));
+}
+
+static void ss_free(struct space_saving * ss) {
+	delete [] ss->entries;
+	delete [] ss->heap;
+	delete [] ss->index;
+}
+
+static inline
+void heap_swap(struct space_saving * ss, unsigned i, unsigned j) {
+	unsigned tmp = ss->heap[i];
+	ss->heap[i] = ss->heap[j];
+	ss->heap[j] = tmp;
+	ss->entries[ss->heap[i]].heap_idx = i;
+	ss->entries[ss->heap[j]].heap_idx = j;
+}
+
+/**
+ * @brief  Restore heap property after count of heap[i] grew
+ */
+static inline
+void heap_down(struct space_saving * ss, unsigned i) {
+	for (;;) {
+		unsigned l = 2 * i + 1;
+		unsigned r = l + 1;
+		unsigned min = i;
+
+		if (l < ss->size && ss->entries[ss->heap[l]].count < ss->entries[ss->heap[min]].count)
+			min = l;
+		if (r < ss->size && ss->entries[ss->heap[r]].count < ss->entries[ss->heap[min]].count)
+			min = r;
+		if (min == i)
+			return;
+
+		heap_swap(ss, i, min);
+		i = min;
+	}
+}
+
+static inline
+void heap_up(struct space_saving * ss, unsigned i) {
+	while (i > 0) {
+		unsigned p = (i - 1) / 2;
+		if (ss->entries[ss->heap[p]].count <= ss->entries[ss->heap[i]].count)
+			return;
+		heap_swap(ss, i, p);
+		i = p;
+	}
+}
+
+/**
+ * @brief  Find slot in index for key
+ *
+ * @return   slot holding the key or an empty slot where the key belongs
+ */
+static inline
+unsigned index_slot(const struct space_saving * ss, const struct hhh_key * key) {
+	unsigned slot = key_hash(key) & ss->index_mask;
+
+	while (ss->index[slot] >= 0 && ! key_eq(&ss->entries[ss->index[slot]].key, key))
+		slot = (slot + 1) & ss->index_mask;
+
+	return slot;
+}
+
+/**
+ * @brief  Remove key from linear probing index using backward shift
+ */
+static void index_remove(struct space_saving * ss, const struct hhh_key * key) {
+	unsigned hole = index_slot(ss, key);
+	unsigned slot = hole;
+
+	assert(ss->index[hole] >= 0);
+
+	for (;;) {
+		slot = (slot + 1) & ss->index_mask;
+		if (ss->index[slot] < 0)
+			break;
+
+		unsigned home = key_hash(&ss->entries[ss->index[slot]].key) & ss->index_mask;
+		// move entry back if its home is not in (hole, slot]
+		if (((slot - home) & ss->index_mask) >= ((slot - hole) & ss->index_mask)) {
+			ss->index[hole] = ss->index[slot];
+			hole = slot;
+		}
+	}
+
+	ss->index[hole] = -1;
+}
+
+/**
+ * @brief  Add weighted key to summary
+ *
+ * @param ss summary to update
+ * @param key key to add
+ * @param weight weight of key
+ * @param error already accumulated overestimation of weight (merges)
+ * @param packets packets to add
+ * @param bytes bytes to add
+ */
+static void ss_update(struct space_saving * ss, const struct hhh_key * key,
+							uint64_t weight, uint64_t error,
+							uint64_t packets, uint64_t bytes) {
+	unsigned slot = index_slot(ss, key);
+	struct ss_entry * e;
+
+	if (ss->index[slot] >= 0) {
+		e = &ss->entries[ss->index[slot]];
+		e->count += weight;
+		e->error += error;
+		e->packets += packets;
+		e->bytes += bytes;
+		heap_down(ss, e->heap_idx);
+		return;
+	}
+
+	if (ss->size < ss->capacity) {
+		unsigned idx = ss->size++;
+
+		e = &ss->entries[idx];
+		e->key = *key;
+		e->count = weight;
+		e->error = error;
+		e->packets = packets;
+		e->bytes = bytes;
+		e->heap_idx = idx;
+		ss->heap[idx] = idx;
+		ss->index[slot] = idx;
+		heap_up(ss, idx);
+		return;
+	}
+
+	// replace minimal counter, new key inherits its count as an error
+	unsigned idx = ss->heap[0];
+	uint64_t min = ss->entries[idx].count;
+
+	e = &ss->entries[idx];
+	index_remove(ss, &e->key);
+	e->key = *key;
+	e->count = min + weight;
+	e->error = min + error;
+	e->packets = packets;
+	e->bytes = bytes;
+	ss->index[index_slot(ss, key)] = idx;
+	heap_down(ss, 0);
+}
+
+/*
+ * HHH over all levels
+ */
+
+/**
+ * @brief  Initialize HHH summaries
+ *
+ * @param h structure to init
+ * @param width address width, 32 for IPv4 or 128 for IPv6
+ * @param levels most specific prefix length tracked
+ * @param capacity counters per level
+ */
+void hhh_init(struct hhh * h, unsigned width, unsigned levels, unsigned capacity) {
+	assert(levels > 0 && levels <= width);
+	assert(capacity > 0);
+
+	h->width = width;
+	h->levels = levels;
+	h->total = 0;
+	h->level = new struct space_saving[levels];
+
+	for (unsigned i = 0; i < levels; ++i)
+		ss_init(&h->level[i], capacity);
+}
+
+/**
+ * @brief  Free HHH summaries
+ *
+ * @param h structure to free
+ */
+void hhh_free(struct hhh * h) {
+	for (unsigned i = 0; i < h->levels; ++i)
+		ss_free(&h->level[i]);
+
+	delete [] h->level;
+	h->level = NULL;
+}
+
+/**
+ * @brief  Account a record on every level
+ *
+ * @param h summaries to update
+ * @param key full (most specific) key of a record
+ * @param weight weight used for heavy hitter detection
+ * @param packets record packets
+ * @param bytes record bytes
+ */
+void hhh_update(struct hhh * h, const struct hhh_key * key,
+					uint64_t weight, uint64_t packets, uint64_t bytes) {
+	struct hhh_key masked;
+
+	h->total += weight;
+
+	for (unsigned len = 1; len <= h->levels; ++len) {
+		key_mask(&masked, key, h->width, len);
+		ss_update(&h->level[len - 1], &masked, weight, 0, packets, bytes);
+	}
+}
+
+/**
+ * @brief  Minimal count of a summary, keys not monitored by a full
+ *         summary may have had up to this weight
+ */
+static inline
+uint64_t ss_min(const struct space_saving * ss) {
+	return ss->size < ss->capacity ? 0 : ss->entries[ss->heap[0]].count;
+}
+
+static inline
+bool ss_entry_greater(const struct ss_entry & a, const struct ss_entry & b) {
+	return a.count > b.count;
+}
+
+/**
+ * @brief  Merge summary src into dst
+ *
+ * Mergeable summaries (Agarwal et al.): a key missing in one summary gets
+ * minimal count of that summary as both count and error, the union is
+ * truncated to capacity keeping the largest counts. The error of a count
+ * stays bounded by total weight of both summaries / capacity.
+ *
+ * @param dst summary to merge to
+ * @param src summary to merge from, same capacity
+ */
+static void ss_merge(struct space_saving * dst, const struct space_saving * src) {
+	const uint64_t dst_min = ss_min(dst);
+	const uint64_t src_min = ss_min(src);
+	std::vector<struct ss_entry> all;
+
+	all.reserve(dst->size + src->size);
+
+	for (unsigned j = 0; j < dst->size; ++j) {
+		struct ss_entry e = dst->entries[j];
+		unsigned slot = index_slot(src, &e.key);
+
+		if (src->index[slot] >= 0) {
+			const struct ss_entry * o = &src->entries[src->index[slot]];
+			e.count += o->count;
+			e.error += o->error;
+			e.packets += o->packets;
+			e.bytes += o->bytes;
+		} else {
+			e.count += src_min;
+			e.error += src_min;
+		}
+		all.push_back(e);
+	}
+
+	for (unsigned j = 0; j < src->size; ++j) {
+		struct ss_entry e = src->entries[j];
+
+		if (dst->index[index_slot(dst, &e.key)] >= 0)
+			continue;
+
+		e.count += dst_min;
+		e.error += dst_min;
+		all.push_back(e);
+	}
+
+	if (all.size() > dst->capacity) {
+		std::nth_element(all.begin(), all.begin() + dst->capacity, all.end(), ss_entry_greater);
+		all.resize(dst->capacity);
+	}
+
+	dst->size = 0;
+	memset(dst->index, 0xFF, (dst->index_mask + 1) * sizeof(int));
+
+	for (size_t j = 0; j < all.size(); ++j)
+		ss_update(dst, &all[j].key, all[j].count, all[j].error, all[j].packets, all[j].bytes);
+}
+
+/**
+ * @brief  Merge summaries of src into dst, both have to share geometry
+ *
+ * @param dst summaries to merge to
+ * @param src summaries to merge from
+ */
+void hhh_merge(struct hhh * dst, const struct hhh * src) {
+	assert(dst->width == src->width && dst->levels == src->levels);
+
+	dst->total += src->total;
+
+	for (unsigned i = 0; i < src->levels; ++i)
+		ss_merge(&dst->level[i], &src->level[i]);
+}
+
+/**
+ * @brief  Is key a descendant of prefix pkey/plen?
+ */
+static inline
+bool is_descendant(const struct hhh_key * key, const struct hhh_key * pkey,
+						unsigned width, unsigned plen) {
+	struct hhh_key masked;
+	key_mask(&masked, key, width, plen);
+	return key_eq(&masked, pkey);
+}
+
+/**
+ * @brief  Compute hierarchical heavy hitters
+ *
+ * Levels are traversed from the most specific one. Weight of every
+ * candidate is discounted by its closest heavy descendants (those not
+ * covered by another, more specific, heavy hitter yet).
+ *
+ * @param h merged summaries
+ * @param threshold fraction of total weight, 0 < threshold <= 1
+ * @param items allocated array of results, caller frees with delete []
+ *
+ * @return   number of heavy hitters found
+ */
+size_t hhh_output(const struct hhh * h, double threshold, struct hhh_item ** items) {
+	std::vector<struct hhh_item> found;
+	std::vector<struct ss_entry> full;		// unconditioned estimates of found
+	std::vector<bool> covered;
+	const double limit = threshold * (double) h->total;
+
+	for (unsigned len = h->levels; len > 0; --len) {
+		const struct space_saving * ss = &h->level[len - 1];
+		const size_t level_begin = found.size();
+
+		for (unsigned j = 0; j < ss->size; ++j) {
+			const struct ss_entry * e = &ss->entries[j];
+			uint64_t lower = 0;
+			uint64_t packets = 0;
+			uint64_t bytes = 0;
+
+			if ((double) e->count < limit)
+				continue;
+
+			for (size_t k = 0; k < level_begin; ++k) {
+				if (! covered[k] && is_descendant(&found[k].key, &e->key, h->width, len)) {
+					lower += full[k].count - full[k].error;
+					packets += full[k].packets;
+					bytes += full[k].bytes;
+				}
+			}
+
+			if ((double) (e->count - (lower < e->count ? lower : e->count)) < limit)
+				continue;
+
+			struct hhh_item item;
+			item.key = e->key;
+			item.len = len;
+			item.count = e->count - lower;
+			item.packets = e->packets > packets ? e->packets - packets : 0;
+			item.bytes = e->bytes > bytes ? e->bytes - bytes : 0;
+			found.push_back(item);
+			full.push_back(*e);
+			covered.push_back(false);
+		}
+
+		// heavy hitters of this level cover their descendants
+		for (size_t k = 0; k < level_begin; ++k) {
+			for (size_t n = level_begin; n < found.size() && ! covered[k]; ++n) {
+				if (is_descendant(&found[k].key, &found[n].key, h->width, len))
+					covered[k] = true;
+			}
+		}
+	}
+
+	*items = new struct hhh_item[found.size() ? found.size() : 1];
+	for (size_t i = 0; i < found.size(); ++i)
+		(*items)[i] = found[i];
+
+	return found.size();
+}
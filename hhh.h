@@ -0,0 +1,95 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 09:12:40 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef HHH_H_
+#define HHH_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/*
+ * Hierarchical heavy hitters (HHH) over IP prefixes.
+ *
+ * Every prefix length (level) keeps its own Space-Saving summary with
+ * a fixed number of counters, so memory is bounded no matter how many
+ * distinct addresses are seen. A record updates one counter on every
+ * level in a single pass. Summaries of different threads are merged with
+ * the error bound of a single summary of all records (total / capacity),
+ * the result is the set of prefixes whose traffic exceeds the threshold
+ * after discounting their heavy descendants.
+ */
+
+/**
+ * @brief  Address key, IPv4 uses only lower 32 bits of lo, host order
+ */
+struct hhh_key {
+	uint64_t hi;
+	uint64_t lo;
+};
+
+/**
+ * @brief  Space-Saving counter
+ */
+struct ss_entry {
+	struct hhh_key key;
+	uint64_t count;			///< overestimated weight
+	uint64_t error;			///< maximal overestimation of count
+	uint64_t packets;			///< packets seen while monitored
+	uint64_t bytes;			///< bytes seen while monitored
+	unsigned heap_idx;		///< position in min-heap
+};
+
+/**
+ * @brief  Space-Saving summary of a single level
+ */
+struct space_saving {
+	unsigned capacity;
+	unsigned size;
+	struct ss_entry * entries;
+	unsigned * heap;			///< min-heap of entry indexes ordered by count
+	int * index;				///< linear probing hash, entry index or -1
+	unsigned index_mask;
+};
+
+/**
+ * @brief  Summaries of all levels
+ */
+struct hhh {
+	unsigned width;			///< 32 for IPv4, 128 for IPv6
+	unsigned levels;			///< prefix lengths 1..levels are tracked
+	uint64_t total;			///< total weight inserted
+	struct space_saving * level;
+};
+
+/**
+ * @brief  Single reported heavy hitter
+ */
+struct hhh_item {
+	struct hhh_key key;
+	unsigned len;				///< prefix length
+	uint64_t count;			///< conditioned weight (upper estimate)
+	uint64_t packets;			///< conditioned packets (lower estimate)
+	uint64_t bytes;			///< conditioned bytes (lower estimate)
+};
+
+void hhh_init(struct hhh * h, unsigned width, unsigned levels, unsigned capacity);
+void hhh_free(struct hhh * h);
+void hhh_update(struct hhh * h, const struct hhh_key * key,
+					uint64_t weight, uint64_t packets, uint64_t bytes);
+void hhh_merge(struct hhh * dst, const struct hhh * src);
+size_t hhh_output(const struct hhh * h, double threshold, struct hhh_item ** items);
+
+#endif // HHH_H_
+
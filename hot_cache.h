@@ -0,0 +1,120 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 04:05:51 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef HOT_CACHE_H_
+#define HOT_CACHE_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <cstring>
+#include <cassert>
+
+#include "hugepage.h"
+
+/*
+ * Small direct-mapped cache of recently seen keys with partial counters.
+ * It sits in front of the aggregation index of a worker; repeated keys
+ * only bump counters here, the index is touched when an entry is evicted
+ * or the cache is flushed.
+ */
+
+#define HOT_KEY_MAX		16
+
+/**
+ * @brief  Cached key with partial counters
+ */
+struct hot_entry {
+	uint8_t key[HOT_KEY_MAX];
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t valid;
+};
+
+/**
+ * @brief  Direct-mapped cache
+ */
+struct hot_cache {
+	struct hot_entry * entries;
+	unsigned mask;					///< number of entries - 1
+	unsigned key_len;				///< key length in bytes
+	size_t key_offset;			///< offset of key inside records
+};
+
+/**
+ * @brief  Init cache
+ *
+ * @param cache cache to init
+ * @param size number of entries, power of two
+ * @param key_len key length in bytes
+ * @param key_offset offset of key inside records
+ */
+inline void hot_cache_init(struct hot_cache * cache, unsigned size,
+									unsigned key_len, size_t key_offset) {
+	assert(size && ! (size & (size - 1)));
+	assert(key_len <= HOT_KEY_MAX);
+
+	cache->entries = (struct hot_entry *) huge_alloc(size * sizeof(struct hot_entry));
+	cache->mask = size - 1;
+	cache->key_len = key_len;
+	cache->key_offset = key_offset;
+	assert(cache->entries);
+}
+
+/**
+ * @brief  Free cache
+ *
+ * @param cache cache to free
+ */
+inline void hot_cache_free(struct hot_cache * cache) {
+	huge_free(cache->entries, (cache->mask + 1) * sizeof(struct hot_entry));
+	cache->entries = NULL;
+}
+
+/**
+ * @brief  Get entry where key of record belongs
+ *
+ * @param cache cache to use
+ * @param record record holding key at key_offset
+ *
+ * @return   entry for the key, it may hold a different key
+ */
+inline struct hot_entry * hot_cache_entry(struct hot_cache * cache, const void * record) {
+	const uint8_t * key = (const uint8_t *) record + cache->key_offset;
+	uint64_t h;
+
+	if (cache->key_len == sizeof(uint16_t)) {
+		h = *(const uint16_t *) key;
+	} else {
+		uint64_t a, b;
+		memcpy(&a, key, sizeof(a));
+		memcpy(&b, key + sizeof(a), sizeof(b));
+		h = (a ^ b) * 0x9E3779B97F4A7C15ULL;
+		h ^= h >> 32;
+	}
+
+	return &cache->entries[h & cache->mask];
+}
+
+/**
+ * @brief  Does entry hold key of record?
+ */
+inline bool hot_cache_hit(const struct hot_cache * cache,
+									const struct hot_entry * e, const void * record) {
+	return e->valid
+		&& ! memcmp(e->key, (const uint8_t *) record + cache->key_offset, cache->key_len);
+}
+
+#endif // HOT_CACHE_H_
+
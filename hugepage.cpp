@@ -0,0 +1,245 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 07:12:40 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "hugepage.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <new>
+#include <inttypes.h>
+#include <sys/mman.h>
+
+#include "param.h"
+#include "flow.h"
+
+/**
+ * @brief  Bytes obtained by huge_alloc() using each method
+ */
+static struct {
+	uint64_t hugetlb;
+	uint64_t thp;
+	uint64_t small;
+	uint64_t heap;
+} huge_stats;
+
+#define FLOW_POOL_CHUNK		(2 * HUGE_PAGE_SIZE)
+
+/**
+ * @brief  Flow pool of a thread, flows are carved from big chunks. A worker
+ *         uses pool of its slot, so memory stays with the slot (and its
+ *         NUMA node) across files.
+ */
+static __thread struct flow_pool thread_pool;
+static __thread struct flow_pool * flow_pool;
+
+/**
+ * @brief  Should allocation of size use pages instead of heap?
+ */
+static inline
+bool huge_wanted(size_t size) {
+	return Param::hugepages() && size >= HUGE_PAGE_SIZE / 2;
+}
+
+/**
+ * @brief  Round size up to huge page boundary
+ */
+static inline
+size_t huge_round(size_t size) {
+	return (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+}
+
+/**
+ * @brief  Allocate zeroed memory, backed by huge pages if possible
+ *
+ * @param size size in bytes
+ *
+ * @return   allocated memory or NULL
+ */
+void * huge_alloc(size_t size) {
+	void * ptr;
+
+	if (! huge_wanted(size)) {
+		__atomic_fetch_add(&huge_stats.heap, size, __ATOMIC_RELAXED);
+		return calloc(1, size);
+	}
+
+	size = huge_round(size);
+
+#ifdef MAP_HUGETLB
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (ptr != MAP_FAILED) {
+		__atomic_fetch_add(&huge_stats.hugetlb, size, __ATOMIC_RELAXED);
+		return ptr;
+	}
+#endif
+
+	/*
+	 * No reserved huge pages, ask for transparent ones. Map one more huge
+	 * page so the region can be aligned, THP backs aligned 2 MB ranges only.
+	 */
+	char * raw = (char *) mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+										MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED)
+		return NULL;
+
+	char * aligned = (char *) huge_round((size_t) raw);
+
+	if (aligned != raw)
+		munmap(raw, aligned - raw);
+	if (aligned + size != raw + size + HUGE_PAGE_SIZE)
+		munmap(aligned + size, raw + HUGE_PAGE_SIZE - aligned);
+
+#ifdef MADV_HUGEPAGE
+	if (! madvise(aligned, size, MADV_HUGEPAGE)) {
+		__atomic_fetch_add(&huge_stats.thp, size, __ATOMIC_RELAXED);
+		return aligned;
+	}
+#endif
+
+	__atomic_fetch_add(&huge_stats.small, size, __ATOMIC_RELAXED);
+	return aligned;
+}
+
+/**
+ * @brief  Free memory obtained by huge_alloc()
+ *
+ * @param ptr memory to free
+ * @param size size passed to huge_alloc()
+ */
+void huge_free(void * ptr, size_t size) {
+	if (! ptr)
+		return;
+
+	if (huge_wanted(size))
+		munmap(ptr, huge_round(size));
+	else
+		free(ptr);
+}
+
+/**
+ * @brief  Read amount of transparent huge pages in use
+ *
+ * @return   AnonHugePages of the process in kB, 0 if unknown
+ */
+static
+unsigned long anon_huge_kb() {
+	FILE * f = fopen("/proc/self/smaps_rollup", "r");
+	unsigned long kb = 0;
+	char line[128];
+
+	if (! f)
+		return 0;
+
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1)
+			break;
+
+	fclose(f);
+	return kb;
+}
+
+/**
+ * @brief  Print how aggregation memory was obtained
+ *
+ * @param os stream to print to
+ */
+void huge_print_stats(std::ostream & os) {
+	const uint64_t MB = 1 << 20;
+
+	if (! Param::hugepages()) {
+		os << "hugepages: off, " << huge_stats.heap / MB << " MB on heap\n";
+		return;
+	}
+
+	os << "hugepages: " << huge_stats.hugetlb / MB << " MB hugetlb, "
+		<< huge_stats.thp / MB << " MB transparent (" << anon_huge_kb() / 1024
+		<< " MB in use), " << huge_stats.small / MB << " MB small pages, "
+		<< huge_stats.heap / MB << " MB on heap\n";
+}
+
+/**
+ * @brief  Use pool for flows allocated by calling thread
+ *
+ * @param pool pool to use, NULL for pool of the thread
+ */
+void flow_pool_attach(struct flow_pool * pool) {
+	flow_pool = pool;
+}
+
+/**
+ * @brief  Get pool of calling thread
+ */
+static inline
+struct flow_pool * flow_pool_get() {
+	return flow_pool ? flow_pool : &thread_pool;
+}
+
+/**
+ * @brief  Allocate a flow from pool of calling thread
+ *
+ * Pools are used only with huge pages, flows are never returned to the
+ * system, freed flows are reused by the thread freeing them.
+ *
+ * @param size size of Flow
+ *
+ * @return   memory for flow
+ */
+void * Flow::operator new(size_t size) {
+	if (! Param::hugepages())
+		return ::operator new(size);
+
+	struct flow_pool * pool = flow_pool_get();
+
+	if (pool->free) {
+		void * ptr = pool->free;
+		pool->free = *(void **) ptr;
+		return ptr;
+	}
+
+	size = (size + alignof(Flow) - 1) & ~(alignof(Flow) - 1);
+
+	if (pool->cur + size > pool->end) {
+		pool->cur = (char *) huge_alloc(FLOW_POOL_CHUNK);
+		if (! pool->cur)
+			throw std::bad_alloc();
+		pool->end = pool->cur + FLOW_POOL_CHUNK;
+	}
+
+	void * ptr = pool->cur;
+	pool->cur += size;
+	return ptr;
+}
+
+/**
+ * @brief  Return a flow to pool of calling thread
+ *
+ * @param ptr flow to free
+ */
+void Flow::operator delete(void * ptr) {
+	if (! Param::hugepages()) {
+		::operator delete(ptr);
+		return;
+	}
+
+	if (! ptr)
+		return;
+
+	struct flow_pool * pool = flow_pool_get();
+
+	*(void **) ptr = pool->free;
+	pool->free = ptr;
+}
@@ -0,0 +1,46 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 07:12:40 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef HUGEPAGE_H_
+#define HUGEPAGE_H_
+
+#include <stddef.h>
+#include <iostream>
+
+/*
+ * Large aggregation memory (flow pools, hash tables, port map) backed by
+ * 2 MB pages if requested by --hugepages. Explicit huge pages (MAP_HUGETLB)
+ * are tried first, then transparent huge pages (MADV_HUGEPAGE), then
+ * ordinary pages. Without --hugepages the heap is used.
+ */
+
+#define HUGE_PAGE_SIZE		(2UL << 20)
+
+/**
+ * @brief  Pool of Flow nodes, used with huge pages only
+ */
+struct flow_pool {
+	char * cur;
+	char * end;
+	void * free;					///< freed flows chained through first word
+};
+
+void flow_pool_attach(struct flow_pool * pool);
+void * huge_alloc(size_t size);
+void huge_free(void * ptr, size_t size);
+void huge_print_stats(std::ostream & os);
+
+#endif // HUGEPAGE_H_
+
@@ -19,6 +19,14 @@
 #include "file.h"
 #include "flow.h"
 #include "aggregation.h"
+#include "hugepage.h"
+#include "store.h"
+#include "daemon.h"
+#include "segment.h"
+#include "zone.h"
+#include "sorted.h"
+#include "rollup.h"
+#include "alert.h"
 
 enum {
 	RET_OK,
@@ -28,6 +36,135 @@ enum {
 };
 
 
+/**
+ * @brief  Columns needed to answer the aggregation given by Param
+ *
+ * @return   STORE_* bits, all columns if queries may vary
+ */
+static
+unsigned query_columns() {
+	if (Param::mode() == Param::MODE_SERVE || Param::shm_cache())
+		return STORE_ALL;
+
+	switch (Param::aggregation()) {
+		case Param::AGG_SRCPORT:
+			return STORE_SRC_PORT | STORE_PACKETS | STORE_BYTES;
+		case Param::AGG_DSTPORT:
+			return STORE_DST_PORT | STORE_PACKETS | STORE_BYTES;
+		case Param::AGG_SRCIP:
+		case Param::AGG_SRCIP4:
+		case Param::AGG_SRCIP6:
+			return STORE_SRC_ADDR | STORE_PACKETS | STORE_BYTES;
+		case Param::AGG_DSTIP:
+		case Param::AGG_DSTIP4:
+		case Param::AGG_DSTIP6:
+			return STORE_DST_ADDR | STORE_PACKETS | STORE_BYTES;
+		default:
+			return STORE_ALL;
+	}
+}
+
+/**
+ * @brief  Get key column of the aggregation
+ *
+ * @return   column in the order of flow_store
+ */
+static
+unsigned query_column() {
+	switch (Param::aggregation()) {
+		case Param::AGG_SRCPORT:
+			return 2;
+		case Param::AGG_DSTPORT:
+			return 3;
+		case Param::AGG_DSTIP:
+		case Param::AGG_DSTIP4:
+		case Param::AGG_DSTIP6:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/**
+ * @brief  Is there a columnar segment in the file pool?
+ *
+ * @return   true if a file is a segment
+ */
+static
+bool pool_segments() {
+	for (struct linked_list_node * l = linked_list_last(&Filepool::getInstance().list); l; l = l->prev) {
+		if (segment_check(l->f))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief  Drop files of the pool whose zone maps can not match filter
+ */
+static
+void prune_pool() {
+	struct zone_map * z = new struct zone_map;
+	std::set<std::string> skip;
+	size_t files = 0;
+
+	for (struct linked_list_node * l = linked_list_last(&Filepool::getInstance().list); l; l = l->prev) {
+		files++;
+		if (zone_get(z, l) && ! zone_match(z, Param::filter()))
+			skip.insert(l->name);
+	}
+
+	Filepool::getInstance().drop(skip);
+	delete z;
+
+	if (Param::stats())
+		std::cerr << "zone: " << skip.size() << " of " << files << " files skipped\n";
+}
+
+/**
+ * @brief  Get records of the file pool by columns, attached from cache if
+ *         it was published for the same files
+ *
+ * @param store store to init
+ *
+ * @return   RET_OK on success, otherwise error code indicating error
+ */
+static
+int load_store(struct flow_store * store) {
+	std::string manifest;
+
+	if (Param::shm_cache()) {
+		manifest = store_manifest(&Filepool::getInstance().list);
+
+		if (store_attach(store, Param::shm_cache(), manifest)) {
+			if (Param::stats())
+				std::cerr << "store: " << store->rows << " records attached from '"
+					<< Param::shm_cache() << "'\n";
+			return RET_OK;
+		}
+	}
+
+	if (! store_init(store, store_rows(&Filepool::getInstance().list), query_columns())) {
+		err() << "Unable to allocate record store!\n";
+		return RET_ERR_AGG;
+	}
+
+	if (! store_load(store, &Filepool::getInstance().list)) {
+		store_free(store);
+		return RET_ERR_FILE;
+	}
+
+	if (Param::shm_cache() && ! store_publish(store, Param::shm_cache(), manifest))
+		warn() << "Unable to publish records to '" << Param::shm_cache() << "'\n";
+
+	if (Param::stats())
+		std::cerr << "store: " << store->rows << " records, "
+			<< (store_memory(store) >> 20) << " MB\n";
+
+	return RET_OK;
+}
+
 /**
  * @brief  Main
  *
@@ -42,12 +179,105 @@ int main(int argc, char * argv[]) {
 	if (! Param::getInstance().is_valid())
 		return RET_ERR_PARAM;
 
-		if (! Filepool::getInstance().init(Param::getInstance().path()))
+	if (Param::alert() && ! alert_init(Param::alerts()))
+		return RET_ERR_FILE;
+
+	// query is answered by daemon, no files needed
+	if (Param::mode() == Param::MODE_QUERY)
+		return daemon_query(Param::socket_path(), argc, argv) ? RET_OK : RET_ERR_AGG;
+
+	// rollup buckets covering the time range are merged
+	if (Param::from()) {
+		std::vector<std::string> paths;
+
+		if (! rollup_select(Param::getInstance().path(), Param::from(), Param::to(), paths)
+				|| ! Filepool::getInstance().init(paths))
+			return RET_ERR_FILE;
+	} else if (Param::mode() == Param::MODE_WINDOW || Param::mode() == Param::MODE_WATCH) {
+		// directory is listed or watched, files are opened when they appear
+		Filepool::getInstance().init(std::vector<std::string>());
+		if (Param::mode() == Param::MODE_WATCH)
+			return Aggregation::run_watch() ? RET_OK : RET_ERR_AGG;
+		return Aggregation::run_window() ? RET_OK : RET_ERR_AGG;
+	} else if (! Filepool::getInstance().init(Param::getInstance().path()))
 		return RET_ERR_FILE;
 
+	if (Param::mode() == Param::MODE_CONVERT)
+		return segment_convert(&Filepool::getInstance().list, Param::output()) ? RET_OK : RET_ERR_FILE;
+
+	if (Param::mode() == Param::MODE_COMPACT)
+		return sorted_compact(&Filepool::getInstance().list, Param::output(),
+					query_column()) ? RET_OK : RET_ERR_FILE;
+
+	if (Param::mode() == Param::MODE_ROLLUP)
+		return Aggregation::run_rollup() ? RET_OK : RET_ERR_AGG;
+
+	if (Param::filter())
+		prune_pool();
+
+	if (Param::bucket()) {
+		if (! Aggregation::run_buckets())
+			return RET_ERR_AGG;
+
+		if (Param::stats())
+			huge_print_stats(std::cerr);
+
+		return RET_OK;
+	}
+
+	if (Param::sidecar()) {
+		if (! Aggregation::run_sidecar())
+			return RET_ERR_AGG;
+
+		if (Param::stats())
+			huge_print_stats(std::cerr);
+
+		return RET_OK;
+	}
+
+	// segments are read by columns, only the store answers from columns
+	bool segments = Param::mode() == Param::MODE_AGGREGATE && pool_segments();
+
+	if (segments && (Param::hhh() != 0 || Param::checkpoint() || Param::mem_limit() != 0
+				|| Param::partial() || Param::shards() || Param::alert())) {
+		err() << "Columnar segments can not be combined with '--hhh', '--checkpoint',"
+			<< " '--mem-limit', '--partial', '--shards' or alerts!\n";
+		return RET_ERR_PARAM;
+	}
+
+	if (Param::mode() == Param::MODE_SERVE || Param::shm_cache() || segments) {
+		struct flow_store store;
+		int ret = load_store(&store);
+		bool ok;
+
+		if (ret != RET_OK)
+			return ret;
+
+		if (Param::mode() == Param::MODE_SERVE)
+			ok = daemon_serve(Param::socket_path(), &store);
+		else
+			ok = Aggregation::run_store(&store);
+
+		store_free(&store);
+
+		if (Param::stats())
+			huge_print_stats(std::cerr);
+
+		return ok ? RET_OK : RET_ERR_AGG;
+	}
+
+	if (Param::mode() == Param::MODE_MERGE) {
+		if (! Aggregation::run_merge())
+			return RET_ERR_AGG;
+	} else if (Param::hhh() != 0) {
+		if (! Aggregation::run_hhh())
+			return RET_ERR_AGG;
+	} else
 #ifdef USE_PORTMAP
-	if (Param::getInstance().aggregation() == Param::AGG_SRCPORT
-			|| Param::getInstance().aggregation() == Param::AGG_DSTPORT) {
+	// port map is not checkpointed, sharded, merged sorted nor written as partial, ports go through the index then
+	if ((Param::getInstance().aggregation() == Param::AGG_SRCPORT
+			|| Param::getInstance().aggregation() == Param::AGG_DSTPORT)
+			&& ! Param::checkpoint() && ! Param::partial() && ! Param::shards()) {
 		if (! Aggregation::run_port())
 			return RET_ERR_AGG;
 	} else
@@ -55,6 +285,9 @@ int main(int argc, char * argv[]) {
 		if (! Aggregation::run())
 			return RET_ERR_AGG;
 
+	if (Param::stats())
+		huge_print_stats(std::cerr);
+
 	return RET_OK;
 }
 
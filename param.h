@@ -21,8 +21,11 @@
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <climits>
 
 #include "common.h"
+#include "filter.h"
+#include "bucket.h"
 
 /**
  * @brief  Parameter singleton class
@@ -35,7 +38,33 @@ class Param {
 		enum sort_t {
 			SORT_UNKNOWN,
 			SORT_BYTES,
-			SORT_PACKETS
+			SORT_PACKETS,
+			SORT_KEY
+		};
+
+		/**
+		 * @brief  What the program does
+		 */
+		enum mode_t {
+			MODE_AGGREGATE,
+			MODE_MERGE,
+			MODE_SERVE,
+			MODE_QUERY,
+			MODE_CONVERT,
+			MODE_COMPACT,
+			MODE_ROLLUP,
+			MODE_WINDOW,
+			MODE_WATCH
+		};
+
+		/**
+		 * @brief  Aggregation index used by workers
+		 */
+		enum engine_t {
+			ENGINE_RBTREE,
+			ENGINE_ART,
+			ENGINE_SHARED,
+			ENGINE_SORTED
 		};
 
 		/**
@@ -66,6 +95,278 @@ class Param {
 			return getInstance().m_sort;
 		}
 
+		/**
+		 * @brief  Get aggregation engine
+		 *
+		 * @return  engine used for aggregation index
+		 */
+		static engine_t engine() {
+			return getInstance().m_engine;
+		}
+
+		/**
+		 * @brief  Get front cache size
+		 *
+		 * @return  number of cache entries per thread, 0 if not used
+		 */
+		static unsigned cache() {
+			return getInstance().m_cache;
+		}
+
+		/**
+		 * @brief  Get keys held by shared map
+		 *
+		 * @return  keys taken by shared map, 0 for default
+		 */
+		static unsigned shared_keys() {
+			return getInstance().m_shared_keys;
+		}
+
+		/**
+		 * @brief  Get pre-aggregation block size
+		 *
+		 * @return  number of records combined in a block, 0 if not used
+		 */
+		static unsigned block() {
+			return getInstance().m_block;
+		}
+
+		/**
+		 * @brief  Back aggregation memory by huge pages?
+		 *
+		 * @return  true if huge pages were requested
+		 */
+		static bool hugepages() {
+			return getInstance().m_hugepages;
+		}
+
+		/**
+		 * @brief  Print statistics when done?
+		 *
+		 * @return  true if statistics were requested
+		 */
+		static bool stats() {
+			return getInstance().m_stats;
+		}
+
+		/**
+		 * @brief  Place workers and their memory on NUMA nodes?
+		 *
+		 * @return  true if NUMA placement was requested
+		 */
+		static bool numa() {
+			return getInstance().m_numa;
+		}
+
+		/**
+		 * @brief  Get memory limit of aggregation
+		 *
+		 * @return  limit in bytes, 0 if not limited
+		 */
+		static uint64_t mem_limit() {
+			return getInstance().m_mem_limit;
+		}
+
+		/**
+		 * @brief  Get checkpoint file
+		 *
+		 * @return  snapshot path, NULL if checkpointing is off
+		 */
+		static const char * checkpoint() {
+			return getInstance().m_checkpoint;
+		}
+
+		/**
+		 * @brief  Get checkpoint interval
+		 *
+		 * @return  minimal number of seconds between snapshots
+		 */
+		static unsigned checkpoint_interval() {
+			return getInstance().m_checkpoint_interval;
+		}
+
+		/**
+		 * @brief  Resume from checkpoint?
+		 *
+		 * @return  true if state should be loaded from checkpoint
+		 */
+		static bool resume() {
+			return getInstance().m_resume;
+		}
+
+		/**
+		 * @brief  Get partial output file
+		 *
+		 * @return  path binary partial is written to, NULL if off
+		 */
+		static const char * partial() {
+			return getInstance().m_partial;
+		}
+
+		/**
+		 * @brief  Get mode
+		 *
+		 * @return  aggregation, merge of partials, daemon, daemon query,
+		 *          conversion to columnar segments, compaction, time rollup
+		 *          sliding window or following a directory
+		 */
+		static mode_t mode() {
+			return getInstance().m_mode;
+		}
+
+		/**
+		 * @brief  Get daemon socket
+		 *
+		 * @return  Unix socket path, NULL if not given
+		 */
+		static const char * socket_path() {
+			return getInstance().m_socket;
+		}
+
+		/**
+		 * @brief  Get decoded records cache
+		 *
+		 * @return  file records are published to and attached from, NULL if off
+		 */
+		static const char * shm_cache() {
+			return getInstance().m_shm_cache;
+		}
+
+		/**
+		 * @brief  Get output directory of conversion
+		 *
+		 * @return  directory segments are written to, NULL if not given
+		 */
+		static const char * output() {
+			return getInstance().m_output;
+		}
+
+		/**
+		 * @brief  Get width of time buckets aggregated apart
+		 *
+		 * @return  bucket width in seconds, 0 if off
+		 */
+		static time_t bucket() {
+			return getInstance().m_bucket;
+		}
+
+		/**
+		 * @brief  Get width of sliding window
+		 *
+		 * @return  window width in seconds, 0 if not given
+		 */
+		static time_t window() {
+			return getInstance().m_window;
+		}
+
+		/**
+		 * @brief  Get seconds between outputs of sliding window or watch
+		 *
+		 * @return  interval, 0 to print once and exit
+		 */
+		static unsigned interval() {
+			return getInstance().m_interval;
+		}
+
+		/**
+		 * @brief  Get number of keys printed by sliding window or watch
+		 *
+		 * @return  number of keys, 0 for all
+		 */
+		static unsigned top() {
+			return getInstance().m_top;
+		}
+
+		/**
+		 * @brief  Get packets limit of alerts
+		 *
+		 * @return  packets a key is reported at, 0 if off
+		 */
+		static uint64_t alert_packets() {
+			return getInstance().m_alert_packets;
+		}
+
+		/**
+		 * @brief  Get bytes limit of alerts
+		 *
+		 * @return  bytes a key is reported at, 0 if off
+		 */
+		static uint64_t alert_bytes() {
+			return getInstance().m_alert_bytes;
+		}
+
+		/**
+		 * @brief  Are alerts on?
+		 *
+		 * @return  true if a limit is set
+		 */
+		static bool alert() {
+			return getInstance().m_alert_packets || getInstance().m_alert_bytes;
+		}
+
+		/**
+		 * @brief  Get alert stream
+		 *
+		 * @return  file alerts are appended to, NULL for stderr
+		 */
+		static const char * alerts() {
+			return getInstance().m_alerts;
+		}
+
+		/**
+		 * @brief  Get start of time range of rollup buckets merged
+		 *
+		 * @return  range start, 0 if buckets are not selected by time
+		 */
+		static time_t from() {
+			return getInstance().m_from;
+		}
+
+		/**
+		 * @brief  Get end of time range of rollup buckets merged
+		 *
+		 * @return  range end (excluded), 0 if open
+		 */
+		static time_t to() {
+			return getInstance().m_to;
+		}
+
+		/**
+		 * @brief  Keep per-file partials next to files?
+		 *
+		 * @return  true if sidecars are used
+		 */
+		static bool sidecar() {
+			return getInstance().m_sidecar;
+		}
+
+		/**
+		 * @brief  Build missing zone maps of filtered files?
+		 *
+		 * @return  true if zone maps are written next to files
+		 */
+		static bool build_zones() {
+			return getInstance().m_build_zones;
+		}
+
+		/**
+		 * @brief  Get record filter
+		 *
+		 * @return  filter records have to match, NULL if all records are used
+		 */
+		static const struct flow_filter * filter() {
+			return getInstance().m_filtered ? &getInstance().m_filter : NULL;
+		}
+
+		/**
+		 * @brief  Get number of shards
+		 *
+		 * @return  number of worker processes owning keys, 0 if off
+		 */
+		static unsigned shards() {
+			return getInstance().m_shards;
+		}
+
 		/**
 		 * @brief  Are program arguments valid?
 		 *
@@ -96,120 +397,509 @@ class Param {
 		bool init(int argc, char * argv[]) {
 			assert((! m_valid) && "Multiple Param init!");
 
-			const char * srcip4 = "srcip4/";
-			const char * dstip4 = "dstip4/";
-			const char * srcip6 = "srcip6/";
-			const char * dstip6 = "dstip6/";
-
 			argc > 1 ? m_valid = true : m_valid = false;
 
-			for (int i = 1; i < argc; i += 2) {
-				if (! strcmp(argv[i], "-f")) {
+			// mode other than aggregation is given as the first argument
+			int first = 1;
+			if (argc > 1) {
+				first = 2;
+				if (! strcmp(argv[1], "merge"))
+					m_mode = MODE_MERGE;
+				else if (! strcmp(argv[1], "serve"))
+					m_mode = MODE_SERVE;
+				else if (! strcmp(argv[1], "query"))
+					m_mode = MODE_QUERY;
+				else if (! strcmp(argv[1], "convert"))
+					m_mode = MODE_CONVERT;
+				else if (! strcmp(argv[1], "compact"))
+					m_mode = MODE_COMPACT;
+				else if (! strcmp(argv[1], "rollup"))
+					m_mode = MODE_ROLLUP;
+				else if (! strcmp(argv[1], "window"))
+					m_mode = MODE_WINDOW;
+				else if (! strcmp(argv[1], "watch"))
+					m_mode = MODE_WATCH;
+				else
+					first = 1;
+			}
+
+			for (int i = first; i < argc; i += 2) {
+				// flags take no parameter, step back to stay on the next option
+				if (! strcmp(argv[i], "--hugepages")) {
+					m_hugepages = true;
+					--i;
+				} else if (! strcmp(argv[i], "--stats")) {
+					m_stats = true;
+					--i;
+				} else if (! strcmp(argv[i], "--numa")) {
+					m_numa = true;
+					--i;
+				} else if (! strcmp(argv[i], "--resume")) {
+					m_resume = true;
+					--i;
+				} else if (! strcmp(argv[i], "--sidecar")) {
+					m_sidecar = true;
+					--i;
+				} else if (! strcmp(argv[i], "--build-zones")) {
+					m_build_zones = true;
+					--i;
+				} else if (! strcmp(argv[i], "-f")) {
+					if (i + 1 == argc) {
+						err() << "Option '-f' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else {
+						m_dirname = argv[i + 1];
+					}
+				} else if (! strcmp(argv[i], "-a")) {
+					if (i + 1 == argc) {
+						err() << "Option '-a' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_aggregation(argv[i + 1])) {
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "-s")) {
+					if (i + 1 == argc) {
+						err() << "Option '-s' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_sort(argv[i + 1])) {
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--hhh")) {
+					if (i + 1 == argc) {
+						err() << "Option '--hhh' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_fraction(argv[i + 1], m_hhh)) {
+						m_valid = false;
+						break;
+					} else if (m_hhh < MIN_HHH) {
+						err() << "HHH fraction has to be at least " << MIN_HHH << "!\n";
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--cache")) {
+					if (i + 1 == argc) {
+						err() << "Option '--cache' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_unsigned(argv[i + 1], m_cache)
+							|| (m_cache & (m_cache - 1)) || m_cache > MAX_CACHE) {
+						err() << "Cache size has to be a power of two up to "
+							<< MAX_CACHE << "!\n";
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--block")) {
+					if (i + 1 == argc) {
+						err() << "Option '--block' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_unsigned(argv[i + 1], m_block) || m_block > MAX_BLOCK) {
+						err() << "Block size has to be up to " << MAX_BLOCK << "!\n";
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--mem-limit")) {
+					if (i + 1 == argc) {
+						err() << "Option '--mem-limit' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_size(argv[i + 1], m_mem_limit) || ! m_mem_limit) {
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--checkpoint")) {
+					if (i + 1 == argc) {
+						err() << "Option '--checkpoint' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else {
+						m_checkpoint = argv[i + 1];
+					}
+				} else if (! strcmp(argv[i], "--shards")) {
+					if (i + 1 == argc) {
+						err() << "Option '--shards' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_unsigned(argv[i + 1], m_shards)
+							|| m_shards == 0 || m_shards > MAX_SHARDS) {
+						err() << "Number of shards has to be from 1 to " << MAX_SHARDS << "!\n";
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--socket")) {
+					if (i + 1 == argc) {
+						err() << "Option '--socket' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else {
+						m_socket = argv[i + 1];
+					}
+				} else if (! strcmp(argv[i], "--shm-cache")) {
+					if (i + 1 == argc) {
+						err() << "Option '--shm-cache' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else {
+						m_shm_cache = argv[i + 1];
+					}
+				} else if (! strcmp(argv[i], "--src-net") || ! strcmp(argv[i], "--dst-net")) {
+					if (i + 1 == argc) {
+						err() << "Option '" << argv[i] << "' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! filter_parse_net(argv[i + 1],
+								argv[i][2] == 's' ? &m_filter.src : &m_filter.dst)) {
+						err() << "Bad network '" << argv[i + 1] << "'!\n";
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--src-port") || ! strcmp(argv[i], "--dst-port")) {
+					unsigned port;
+
+					if (i + 1 == argc) {
+						err() << "Option '" << argv[i] << "' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_unsigned(argv[i + 1], port) || port > 0xffff) {
+						err() << "Port has to be up to 65535!\n";
+						m_valid = false;
+						break;
+					}
+					(argv[i][2] == 's' ? m_filter.src_port : m_filter.dst_port) = port;
+				} else if (! strcmp(argv[i], "--output")) {
+					if (i + 1 == argc) {
+						err() << "Option '--output' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else {
+						m_output = argv[i + 1];
+					}
+				} else if (! strcmp(argv[i], "--bucket")) {
+					if (i + 1 == argc) {
+						err() << "Option '--bucket' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! bucket_width(argv[i + 1], &m_bucket)) {
+						err() << "Bad bucket width '" << argv[i + 1] << "' (e.g. 5m, 1h or 1d)!\n";
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--window")) {
+					if (i + 1 == argc) {
+						err() << "Option '--window' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! bucket_width(argv[i + 1], &m_window)) {
+						err() << "Bad window width '" << argv[i + 1] << "' (e.g. 60m)!\n";
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--interval")) {
+					if (i + 1 == argc) {
+						err() << "Option '--interval' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_unsigned(argv[i + 1], m_interval)) {
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--top")) {
+					if (i + 1 == argc) {
+						err() << "Option '--top' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_unsigned(argv[i + 1], m_top)) {
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--alert-packets") || ! strcmp(argv[i], "--alert-bytes")) {
 					if (i + 1 == argc) {
-						err() << "Option '-f' requires a parameter!\n";
+						err() << "Option '" << argv[i] << "' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_size(argv[i + 1], argv[i][8] == 'p' ? m_alert_packets : m_alert_bytes)) {
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--alerts")) {
+					if (i + 1 == argc) {
+						err() << "Option '--alerts' requires a parameter!\n";
 						m_valid = false;
 						break;
 					} else {
-						m_dirname = argv[i + 1];
+						m_alerts = argv[i + 1];
 					}
-				} else if (! strcmp(argv[i], "-a")) {
+				} else if (! strcmp(argv[i], "--from") || ! strcmp(argv[i], "--to")) {
 					if (i + 1 == argc) {
-						err() << "Option '-a' requires a parameter!\n";
+						err() << "Option '" << argv[i] << "' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! bucket_parse(argv[i + 1], argv[i][2] == 'f' ? &m_from : &m_to)) {
+						err() << "Bad time '" << argv[i + 1] << "', use YYYYMMDDhhmm!\n";
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--partial")) {
+					if (i + 1 == argc) {
+						err() << "Option '--partial' requires a parameter!\n";
 						m_valid = false;
 						break;
-					} else if (! strncmp(argv[i + 1], srcip4, strlen(srcip4))) {
-						m_aggregation = AGG_SRCIP4;
-						if (! get_mask(argv[i + 1], srcip4)) {
-							m_valid = false;
-							break;
-						}
-					} else if (! strncmp(argv[i + 1], dstip4, strlen(dstip4))) {
-						m_aggregation = AGG_DSTIP4;
-						if (! get_mask(argv[i + 1], dstip4)) {
-							m_valid = false;
-							break;
-						}
-					} else if (! strncmp(argv[i + 1], srcip6, strlen(srcip6))) {
-						m_aggregation = AGG_SRCIP6;
-						if (! get_mask(argv[i + 1], srcip6)) {
-							m_valid = false;
-							break;
-						}
-					} else if (! strncmp(argv[i + 1], dstip6, strlen(dstip6))) {
-						m_aggregation = AGG_DSTIP6;
-						if (! get_mask(argv[i + 1], dstip6)) {
-							m_valid = false;
-							break;
-						}
-					} else if (! strcmp(argv[i + 1], "srcip")) {
-						m_aggregation = AGG_SRCIP;
-					} else if (! strcmp(argv[i + 1], "dstip")) {
-						m_aggregation = AGG_DSTIP;
-					} else if (! strcmp(argv[i + 1], "srcport")) {
-						m_aggregation = AGG_SRCPORT;
-					} else if (! strcmp(argv[i + 1], "dstport")) {
-						m_aggregation = AGG_DSTPORT;
 					} else {
-						err() << "Unknown aggregation type '" << argv[i + 1] << "'!\n";
+						m_partial = argv[i + 1];
+					}
+				} else if (! strcmp(argv[i], "--checkpoint-interval")) {
+					if (i + 1 == argc) {
+						err() << "Option '--checkpoint-interval' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_unsigned(argv[i + 1], m_checkpoint_interval)) {
 						m_valid = false;
 						break;
 					}
-				} else if (! strcmp(argv[i], "-s")) {
+				} else if (! strcmp(argv[i], "--engine")) {
 					if (i + 1 == argc) {
-						err() << "Option '-s' requires a parameter!\n";
+						err() << "Option '--engine' requires a parameter!\n";
 						m_valid = false;
 						break;
+					} else if (! strcmp(argv[i + 1], "rbtree")) {
+						m_engine = ENGINE_RBTREE;
+					} else if (! strcmp(argv[i + 1], "art")) {
+						m_engine = ENGINE_ART;
+					} else if (! strcmp(argv[i + 1], "shared")) {
+						m_engine = ENGINE_SHARED;
+					} else if (! strcmp(argv[i + 1], "sorted")) {
+						m_engine = ENGINE_SORTED;
 					} else {
-						if (! strcmp(argv[i + 1], "packets")) {
-							m_sort = SORT_PACKETS;
-						} else if (! strcmp(argv[i + 1], "bytes")) {
-							m_sort = SORT_BYTES;
-						} else {
-							err() << "Unknown sort type '" << argv[i + 1] << "'!\n";
-							m_valid = false;
-							break;
-						}
+						err() << "Unknown engine '" << argv[i + 1] << "'!\n";
+						m_valid = false;
+						break;
+					}
+				} else if (! strcmp(argv[i], "--shared-keys")) {
+					if (i + 1 == argc) {
+						err() << "Option '--shared-keys' requires a parameter!\n";
+						m_valid = false;
+						break;
+					} else if (! get_unsigned(argv[i + 1], m_shared_keys)
+							|| m_shared_keys == 0 || m_shared_keys > MAX_SHARED_KEYS) {
+						err() << "Shared map keys have to be 1 up to " << MAX_SHARED_KEYS << "!\n";
+						m_valid = false;
+						break;
 					}
 				} else {
 					err() << "Unknown option '" << argv[i] << "'!\n";
 				}
 			}
 
-			if (m_valid && m_sort == SORT_UNKNOWN) {
+			if (m_valid && m_partial && m_sort != SORT_UNKNOWN && m_sort != SORT_KEY) {
+				err() << "Partial output is written ordered by key, '-s' has to be 'key' or left out!\n";
+				m_valid = false;
+			}
+
+			// partial is always written ordered by key
+			if (m_partial && m_sort == SORT_UNKNOWN)
+				m_sort = SORT_KEY;
+
+			if (m_valid && m_sort == SORT_UNKNOWN
+					&& m_mode != MODE_SERVE && m_mode != MODE_CONVERT && m_mode != MODE_COMPACT
+					&& m_mode != MODE_ROLLUP) {
 				err() << "Sort type not entered!\n";
 				m_valid = false;
 			}
 
-			if (m_valid && m_dirname == NULL) {
+			if (m_valid && m_dirname == NULL && m_mode != MODE_QUERY) {
 				err() << "Directory or file name not entered!\n";
 				m_valid = false;
 			}
 
-			if (m_valid && m_aggregation == AGG_UNKNOWN) {
+			if (m_valid && m_aggregation == AGG_UNKNOWN
+					&& (m_mode == MODE_AGGREGATE || m_mode == MODE_QUERY || m_mode == MODE_COMPACT
+						|| m_mode == MODE_ROLLUP || m_mode == MODE_WINDOW || m_mode == MODE_WATCH)) {
 				err() << "Aggregation type not entered!\n";
 				m_valid = false;
 			}
 
-			if (m_aggregation == AGG_SRCIP4 || m_aggregation == AGG_DSTIP4) {
-				if (m_mask > 32) {
-					err() << "Given mask too big for IPv4!\n";
-					m_valid = false;
-				}
+			if (! check_mask())
+				m_valid = false;
+
+			if (m_valid && m_hhh != 0
+					&& m_aggregation != AGG_SRCIP4 && m_aggregation != AGG_DSTIP4
+					&& m_aggregation != AGG_SRCIP6 && m_aggregation != AGG_DSTIP6) {
+				err() << "HHH mode requires masked aggregation (e.g. srcip4/32)!\n";
+				m_valid = false;
 			}
 
-			if (m_aggregation == AGG_SRCIP6 || m_aggregation == AGG_DSTIP6) {
-				if (m_mask > 128) {
-					err() << "Given mask too big for IPv6!\n";
-					m_valid = false;
-				}
+			if (m_valid && m_hhh != 0 && m_sort == SORT_KEY) {
+				err() << "HHH mode requires packets or bytes sort!\n";
+				m_valid = false;
 			}
 
-			if (m_aggregation == AGG_SRCIP4 || m_aggregation == AGG_DSTIP4
-				|| m_aggregation == AGG_SRCIP6 || m_aggregation == AGG_DSTIP6) {
-				if (m_mask == 0) {
-					err() << "Mask has to be non-zero!\n";
-					m_valid = false;
-				}
+			if (m_valid && m_mem_limit != 0 && m_engine == ENGINE_SHARED) {
+				err() << "Shared engine can not spill, '--mem-limit' not supported!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_resume && ! m_checkpoint) {
+				err() << "Option '--resume' requires '--checkpoint'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_checkpoint && (m_hhh != 0 || m_mem_limit != 0)) {
+				err() << "Checkpoint can not be combined with '--hhh' or '--mem-limit'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_partial && m_hhh != 0) {
+				err() << "HHH mode can not write partial output!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_mode == MODE_MERGE && (m_aggregation != AGG_UNKNOWN || m_hhh != 0
+						|| m_checkpoint || m_mem_limit != 0)) {
+				err() << "Merge mode takes aggregation from partials, '-a', '--hhh',"
+					<< " '--checkpoint' and '--mem-limit' not supported!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_shards != 0 && (m_mode == MODE_MERGE || m_hhh != 0 || m_checkpoint
+						|| m_mem_limit != 0 || m_cache != 0 || m_engine == ENGINE_SHARED)) {
+				err() << "Shards can not be combined with 'merge', '--hhh', '--checkpoint',"
+					<< " '--mem-limit', '--cache' or shared engine!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && (m_mode == MODE_SERVE || m_mode == MODE_QUERY) && m_socket == NULL) {
+				err() << "Option '--socket' not entered!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && (m_mode == MODE_SERVE || m_mode == MODE_QUERY)
+					&& (m_hhh != 0 || m_checkpoint || m_mem_limit != 0 || m_partial || m_shards != 0)) {
+				err() << "Daemon queries can not be combined with '--hhh', '--checkpoint',"
+					<< " '--mem-limit', '--partial' or '--shards'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_shm_cache && (m_mode == MODE_MERGE || m_mode == MODE_QUERY
+						|| m_hhh != 0 || m_checkpoint || m_mem_limit != 0 || m_partial || m_shards != 0)) {
+				err() << "Option '--shm-cache' can not be combined with 'merge', 'query', '--hhh',"
+					<< " '--checkpoint', '--mem-limit', '--partial' or '--shards'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_sidecar && (m_mode != MODE_AGGREGATE || m_hhh != 0 || m_checkpoint
+						|| m_mem_limit != 0 || m_shards != 0 || m_shm_cache)) {
+				err() << "Option '--sidecar' can not be combined with other modes, '--hhh',"
+					<< " '--checkpoint', '--mem-limit', '--shards' or '--shm-cache'!\n";
+				m_valid = false;
+			}
+
+			m_filtered = ! filter_empty(&m_filter);
+
+			if (m_valid && m_filtered && (m_mode != MODE_AGGREGATE || m_checkpoint
+						|| m_sidecar || m_shm_cache)) {
+				err() << "Filters can not be combined with other modes, '--checkpoint',"
+					<< " '--sidecar' or '--shm-cache'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_build_zones && ! m_filtered) {
+				err() << "Option '--build-zones' requires '--src-net', '--dst-net',"
+					<< " '--src-port' or '--dst-port'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && (m_mode == MODE_CONVERT || m_mode == MODE_COMPACT || m_mode == MODE_ROLLUP)
+					&& m_output == NULL) {
+				err() << "Option '--output' not entered!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_output && m_mode != MODE_CONVERT && m_mode != MODE_COMPACT
+					&& m_mode != MODE_ROLLUP) {
+				err() << "Option '--output' is used by 'convert', 'compact' and 'rollup' only!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_mode == MODE_ROLLUP && (m_hhh != 0 || m_checkpoint || m_mem_limit != 0
+						|| m_partial || m_shards != 0 || m_shm_cache)) {
+				err() << "Rollup can not be combined with '--hhh', '--checkpoint', '--mem-limit',"
+					<< " '--partial', '--shards' or '--shm-cache'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_bucket && (m_mode != MODE_AGGREGATE || m_hhh != 0 || m_checkpoint
+						|| m_mem_limit != 0 || m_partial || m_shards != 0 || m_sidecar || m_shm_cache)) {
+				err() << "Option '--bucket' can not be combined with other modes, '--hhh',"
+					<< " '--checkpoint', '--mem-limit', '--partial', '--shards', '--sidecar'"
+					<< " or '--shm-cache'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_mode == MODE_WINDOW && m_window == 0) {
+				err() << "Option '--window' not entered!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && (m_window || m_top) && m_mode != MODE_WINDOW && m_mode != MODE_WATCH) {
+				err() << "Options '--window' and '--top' are used by 'window' and 'watch' only!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && (m_mode == MODE_WINDOW || m_mode == MODE_WATCH) && (m_hhh != 0 || m_checkpoint || m_mem_limit != 0
+						|| m_partial || m_shards != 0 || m_sidecar || m_shm_cache || m_bucket)) {
+				err() << "Window and watch can not be combined with '--hhh', '--checkpoint', '--mem-limit',"
+					<< " '--partial', '--shards', '--sidecar', '--shm-cache' or '--bucket'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && (m_alert_packets || m_alert_bytes)
+					&& ((m_mode != MODE_AGGREGATE && m_mode != MODE_WINDOW && m_mode != MODE_WATCH)
+						|| m_hhh != 0 || m_mem_limit != 0 || m_shards != 0 || m_sidecar || m_shm_cache
+						|| m_bucket || m_engine == ENGINE_SHARED || m_engine == ENGINE_SORTED)) {
+				err() << "Alerts can not be combined with other modes than 'window' and 'watch',"
+					<< " '--hhh', '--mem-limit', '--shards', '--sidecar', '--shm-cache',"
+					<< " '--bucket', shared or sorted engine!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_alerts && ! m_alert_packets && ! m_alert_bytes) {
+				err() << "Option '--alerts' requires '--alert-packets' or '--alert-bytes'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && (m_from || m_to) && m_mode != MODE_MERGE) {
+				err() << "Options '--from' and '--to' select rollup buckets in 'merge' only!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_to && ! m_from) {
+				err() << "Option '--to' requires '--from'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_to && m_to <= m_from) {
+				err() << "Time range is empty!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_engine == ENGINE_SORTED && (m_mode != MODE_AGGREGATE || m_hhh != 0
+						|| m_checkpoint || m_mem_limit != 0 || m_shards != 0 || m_cache != 0
+						|| m_block != 0 || m_sidecar || m_shm_cache)) {
+				err() << "Sorted engine merges compacted segments as streams, it can not be"
+					<< " combined with other modes, '--hhh', '--checkpoint', '--mem-limit',"
+					<< " '--shards', '--cache', '--block', '--sidecar' or '--shm-cache'!\n";
+				m_valid = false;
+			}
+
+			if (m_valid && m_block != 0 && m_cache != 0) {
+				err() << "Options '--block' and '--cache' can not be combined!\n";
+				m_valid = false;
 			}
 
 			if (! m_valid)
@@ -217,6 +907,43 @@ class Param {
 			return m_valid;
 		}
 
+		/**
+		 * @brief  Parse query sent to daemon, replaces aggregation and sort
+		 *
+		 * @param argc arguments count
+		 * @param argv[] arguments vector, only '-a' and '-s' are accepted
+		 *
+		 * @return   true if query is valid
+		 */
+		bool query(int argc, char * argv[]) {
+			m_aggregation = AGG_UNKNOWN;
+			m_sort = SORT_UNKNOWN;
+			m_mask = 0;
+
+			for (int i = 0; i < argc; i += 2) {
+				if (i + 1 == argc) {
+					err() << "Option '" << argv[i] << "' requires a parameter!\n";
+					return false;
+				} else if (! strcmp(argv[i], "-a")) {
+					if (! get_aggregation(argv[i + 1]))
+						return false;
+				} else if (! strcmp(argv[i], "-s")) {
+					if (! get_sort(argv[i + 1]))
+						return false;
+				} else {
+					err() << "Unknown query option '" << argv[i] << "'!\n";
+					return false;
+				}
+			}
+
+			if (m_aggregation == AGG_UNKNOWN || m_sort == SORT_UNKNOWN) {
+				err() << "Query requires aggregation and sort type!\n";
+				return false;
+			}
+
+			return check_mask();
+		}
+
 		/**
 		 * @brief  Get mask
 		 *
@@ -226,6 +953,15 @@ class Param {
 			return m_mask;
 		}
 
+		/**
+		 * @brief  Get HHH threshold
+		 *
+		 * @return   fraction of total traffic, 0 if HHH mode is off
+		 */
+		static double hhh() {
+			return getInstance().m_hhh;
+		}
+
 		/**
 		 * @brief  Get directory path
 		 *
@@ -245,6 +981,131 @@ class Param {
 			m_aggregation = AGG_UNKNOWN;
 			m_sort = SORT_UNKNOWN;
 			m_mask = 0;
+			m_hhh = 0;
+			m_engine = ENGINE_RBTREE;
+			m_cache = 0;
+			m_shared_keys = 0;
+			m_block = 0;
+			m_hugepages = false;
+			m_stats = false;
+			m_numa = false;
+			m_mem_limit = 0;
+			m_checkpoint = NULL;
+			m_checkpoint_interval = 60;
+			m_resume = false;
+			m_partial = NULL;
+			m_mode = MODE_AGGREGATE;
+			m_shards = 0;
+			m_socket = NULL;
+			m_shm_cache = NULL;
+			m_output = NULL;
+			m_bucket = 0;
+			m_alert_packets = 0;
+			m_alert_bytes = 0;
+			m_alerts = NULL;
+			m_window = 0;
+			m_interval = 300;
+			m_top = 0;
+			m_from = 0;
+			m_to = 0;
+			m_sidecar = false;
+			m_build_zones = false;
+			m_filtered = false;
+			filter_init(&m_filter);
+		}
+
+		/**
+		 * @brief  Parse aggregation type
+		 *
+		 * @param argv argument to parse
+		 *
+		 * @return   true on success
+		 */
+		bool get_aggregation(const char * argv) {
+			const char * srcip4 = "srcip4/";
+			const char * dstip4 = "dstip4/";
+			const char * srcip6 = "srcip6/";
+			const char * dstip6 = "dstip6/";
+
+			if (! strncmp(argv, srcip4, strlen(srcip4))) {
+				m_aggregation = AGG_SRCIP4;
+				return get_mask(argv, srcip4);
+			} else if (! strncmp(argv, dstip4, strlen(dstip4))) {
+				m_aggregation = AGG_DSTIP4;
+				return get_mask(argv, dstip4);
+			} else if (! strncmp(argv, srcip6, strlen(srcip6))) {
+				m_aggregation = AGG_SRCIP6;
+				return get_mask(argv, srcip6);
+			} else if (! strncmp(argv, dstip6, strlen(dstip6))) {
+				m_aggregation = AGG_DSTIP6;
+				return get_mask(argv, dstip6);
+			} else if (! strcmp(argv, "srcip")) {
+				m_aggregation = AGG_SRCIP;
+			} else if (! strcmp(argv, "dstip")) {
+				m_aggregation = AGG_DSTIP;
+			} else if (! strcmp(argv, "srcport")) {
+				m_aggregation = AGG_SRCPORT;
+			} else if (! strcmp(argv, "dstport")) {
+				m_aggregation = AGG_DSTPORT;
+			} else {
+				err() << "Unknown aggregation type '" << argv << "'!\n";
+				return false;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief  Parse sort type
+		 *
+		 * @param argv argument to parse
+		 *
+		 * @return   true on success
+		 */
+		bool get_sort(const char * argv) {
+			if (! strcmp(argv, "packets")) {
+				m_sort = SORT_PACKETS;
+			} else if (! strcmp(argv, "bytes")) {
+				m_sort = SORT_BYTES;
+			} else if (! strcmp(argv, "key")) {
+				m_sort = SORT_KEY;
+			} else {
+				err() << "Unknown sort type '" << argv << "'!\n";
+				return false;
+			}
+
+			return true;
+		}
+
+		/**
+		 * @brief  Check mask of masked aggregation
+		 *
+		 * @return   true if mask fits the aggregation
+		 */
+		bool check_mask() {
+			if (m_aggregation == AGG_SRCIP4 || m_aggregation == AGG_DSTIP4) {
+				if (m_mask > 32) {
+					err() << "Given mask too big for IPv4!\n";
+					return false;
+				}
+			}
+
+			if (m_aggregation == AGG_SRCIP6 || m_aggregation == AGG_DSTIP6) {
+				if (m_mask > 128) {
+					err() << "Given mask too big for IPv6!\n";
+					return false;
+				}
+			}
+
+			if (m_aggregation == AGG_SRCIP4 || m_aggregation == AGG_DSTIP4
+				|| m_aggregation == AGG_SRCIP6 || m_aggregation == AGG_DSTIP6) {
+				if (m_mask == 0) {
+					err() << "Mask has to be non-zero!\n";
+					return false;
+				}
+			}
+
+			return true;
 		}
 
 		/**
@@ -269,6 +1130,78 @@ class Param {
 			return true;
 		}
 
+		/**
+		 * @brief  Parse size with optional K, M or G suffix
+		 *
+		 * @param argv argument to parse
+		 * @param res parsed size in bytes
+		 *
+		 * @return   true on success
+		 */
+		bool get_size(const char * argv, uint64_t & res) {
+			char * endptr = NULL;
+			unsigned long long val = strtoull(argv, &endptr, 10);
+			unsigned shift = 0;
+
+			if (endptr != argv && argv[0] != '-') {
+				switch (*endptr) {
+					case 'K': case 'k': shift = 10; endptr++; break;
+					case 'M': case 'm': shift = 20; endptr++; break;
+					case 'G': case 'g': shift = 30; endptr++; break;
+				}
+			}
+
+			if (endptr == argv || *endptr != '\0' || argv[0] == '-'
+					|| val > (ULLONG_MAX >> shift)) {
+				err() << "Bad size '" << argv << "'!\n";
+				return false;
+			}
+
+			res = val << shift;
+			return true;
+		}
+
+		/**
+		 * @brief  Parse unsigned decimal number
+		 *
+		 * @param argv argument to parse
+		 * @param res parsed value
+		 *
+		 * @return   true on success
+		 */
+		bool get_unsigned(const char * argv, unsigned & res) {
+			char * endptr = NULL;
+			unsigned long val = strtoul(argv, &endptr, 10);
+
+			if (endptr == argv || *endptr != '\0' || val > UINT_MAX || argv[0] == '-') {
+				err() << "Bad number '" << argv << "'!\n";
+				return false;
+			}
+
+			res = (unsigned) val;
+			return true;
+		}
+
+		/**
+		 * @brief  Parse fraction in interval (0, 1]
+		 *
+		 * @param argv argument to parse
+		 * @param res parsed value
+		 *
+		 * @return   true on success
+		 */
+		bool get_fraction(const char * argv, double & res) {
+			char * endptr = NULL;
+			res = strtod(argv, &endptr);
+
+			if (endptr == argv || *endptr != '\0' || ! (res > 0 && res <= 1)) {
+				err() << "Bad fraction '" << argv << "'!\n";
+				return false;
+			}
+
+			return true;
+		}
+
 		/**
 		 * @brief  Print a simple help
 		 *
@@ -278,9 +1211,75 @@ class Param {
 			using namespace std;
 
 			cerr << "Usage: " << pname << " -a [AGREGATION] -f [FILE] -s [SORT]\n"
+							<< "       " << pname << " merge -f [PARTIAL] -s [SORT]\n"
+							<< "       " << pname << " serve -f [FILE] --socket [PATH]\n"
+							<< "       " << pname << " query --socket [PATH] -a [AGREGATION] -s [SORT]\n"
+							<< "       " << pname << " convert -f [FILE] --output [DIR]\n"
+							<< "       " << pname << " compact -f [FILE] --output [DIR] -a [AGREGATION]\n"
+							<< "       " << pname << " rollup -f [FILE] --output [DIR] -a [AGREGATION]\n"
+							<< "       " << pname << " merge -f [DIR/AGREGATION] --from [TIME] --to [TIME] -s [SORT]\n"
+							<< "       " << pname << " window -f [DIR] --window [WIDTH] -a [AGREGATION] -s [SORT]\n"
+							<< "       " << pname << " watch -f [DIR] -a [AGREGATION] -s [SORT]\n"
 							<< "\t-f\t\t- file or directory name with data\n"
 							<< "\t-a\t\t- aggregation type\n"
-							<< "\t-s\t\t- sort type\n\n";
+							<< "\t-s\t\t- sort type\n"
+							<< "\t--hhh FRAC\t- report hierarchical heavy hitters above FRAC\n"
+							<< "\t\t\t  of traffic for prefixes up to MASK\n"
+							<< "\t--engine ENGINE\t- aggregation index (rbtree, art, shared), 'sorted'\n"
+							<< "\t\t\t  merges segments written by 'compact' by key\n"
+							<< "\t--shared-keys N\t- keys held by shared engine map (65536), other\n"
+							<< "\t\t\t  keys are kept by per-thread indexes\n"
+							<< "\t--cache N\t- per-thread cache of N hot keys (power of two)\n"
+							<< "\t--block N\t- sort and combine blocks of N records before\n"
+							<< "\t\t\t  aggregation\n"
+							<< "\t--hugepages\t- back aggregation memory by 2 MB pages\n"
+							<< "\t--stats\t\t- print statistics to stderr when done\n"
+							<< "\t--numa\t\t- pin workers and their memory to NUMA nodes\n"
+							<< "\t--mem-limit SIZE- spill sorted runs to $TMPDIR above SIZE\n"
+							<< "\t\t\t  (suffix K, M or G)\n"
+							<< "\t--checkpoint FILE\t- snapshot aggregation state to FILE\n"
+							<< "\t--checkpoint-interval SEC\t- seconds between snapshots (60)\n"
+							<< "\t--resume\t- continue from checkpoint, skip completed files\n"
+							<< "\t--partial FILE\t- write binary partial result to FILE instead\n"
+							<< "\t\t\t  of printing (ordered by key), merge partials\n"
+							<< "\t\t\t  with 'merge'\n"
+							<< "\t--shards N\t- aggregate in N worker processes owning\n"
+							<< "\t\t\t  a hash range of keys each\n"
+							<< "\t--socket PATH\t- Unix socket of daemon ('serve' keeps records\n"
+							<< "\t\t\t  in memory and answers 'query')\n"
+							<< "\t--shm-cache FILE\t- reuse records decoded by an earlier run\n"
+							<< "\t\t\t  of the same files from FILE (e.g. in /dev/shm)\n"
+							<< "\t--output DIR\t- write columnar segments of files to DIR ('convert'),\n"
+							<< "\t\t\t  or segments ordered by key of '-a' ('compact'),\n"
+							<< "\t\t\t  segments are read by -f like record files,\n"
+							<< "\t\t\t  or 5m, 1h and 1d buckets of nfcapd.YYYYMMDDhhmm\n"
+							<< "\t\t\t  files ('rollup'), only changed buckets are updated\n"
+							<< "\t--bucket WIDTH\t- print a result for every bucket of WIDTH (e.g. 5m, 1h)\n"
+							<< "\t\t\t  of nfcapd.YYYYMMDDhhmm files, buckets are\n"
+							<< "\t\t\t  aggregated in parallel\n"
+							<< "\t--window WIDTH\t- aggregate nfcapd.YYYYMMDDhhmm files of the last\n"
+							<< "\t\t\t  WIDTH (e.g. 60m), files entering and leaving\n"
+							<< "\t\t\t  the window are added and subtracted\n"
+							<< "\t--interval SEC\t- seconds between window outputs (300), 0 to\n"
+							<< "\t\t\t  print once ('watch' follows new and growing files\n"
+							<< "\t\t\t  of DIR by inotify, with '--window' too)\n"
+							<< "\t--top N\t\t- print only N first keys of window\n"
+							<< "\t--alert-packets N\t- report a key as soon as it reaches N packets\n"
+							<< "\t--alert-bytes SIZE\t- report a key as soon as it reaches SIZE bytes\n"
+							<< "\t\t\t  (suffix K, M or G), delayed by '--cache' and '--block'\n"
+							<< "\t--alerts FILE\t- append alerts to FILE instead of stderr\n"
+							<< "\t--from TIME\t- merge rollup buckets from TIME (YYYYMMDDhhmm)\n"
+							<< "\t--to TIME\t- merge rollup buckets up to TIME, fewest buckets\n"
+							<< "\t\t\t  covering the range are used\n"
+							<< "\t--sidecar\t- keep partial result of every file next to it,\n"
+							<< "\t\t\t  only new or changed files are aggregated again\n"
+							<< "\t--src-net NET\t- use only records from NET (e.g. 10.0.0.0/8)\n"
+							<< "\t--dst-net NET\t- use only records to NET\n"
+							<< "\t--src-port N\t- use only records from port N\n"
+							<< "\t--dst-port N\t- use only records to port N, files that can not\n"
+							<< "\t\t\t  match filters are skipped by their zone maps\n"
+							<< "\t\t\t  ('convert' and 'compact' write them)\n"
+							<< "\t--build-zones\t- write missing zone maps next to filtered files\n\n";
 
 			cerr << "Aggregation types:\n"
 							<< "\tsrcip\t\t- aggregation using source IP\n"
@@ -294,7 +1293,8 @@ class Param {
 
 			cerr << "Sort types:\n"
 							<< "\tpackets\t\t- sort by packets\n"
-							<< "\tbytes\t\t- sort by bytes\n\n";
+							<< "\tbytes\t\t- sort by bytes\n"
+							<< "\tkey\t\t- sort by address or port\n\n";
 
 			cerr << "Developed by Fridolin Pokorny <fridex.devel@gmail.com> 2014\n";
 		}
@@ -310,6 +1310,43 @@ class Param {
 		aggregation_t	m_aggregation;	///< Aggregation used
 		sort_t			m_sort;			///< Sort used
 		unsigned			m_mask;			///< Mask decimal value
+		double			m_hhh;			///< HHH threshold, 0 if not used
+		engine_t			m_engine;		///< Aggregation index
+		unsigned			m_cache;			///< Front cache entries, 0 if off
+		unsigned			m_shared_keys;	///< Keys of shared map, 0 for default
+		unsigned			m_block;			///< Pre-aggregation block size, 0 if off
+		bool				m_hugepages;	///< Use huge pages for aggregation memory
+		bool				m_stats;			///< Print statistics when done
+		bool				m_numa;			///< NUMA aware placement of workers
+		uint64_t			m_mem_limit;	///< Aggregation memory limit, 0 if off
+		const char		* m_checkpoint;	///< Snapshot path, NULL if off
+		unsigned			m_checkpoint_interval;	///< Seconds between snapshots
+		bool				m_resume;		///< Load snapshot before aggregation
+		const char		* m_partial;	///< Partial output path, NULL if off
+		mode_t			m_mode;			///< What the program does
+		unsigned			m_shards;		///< Worker processes, 0 if off
+		const char		* m_socket;		///< Daemon socket path
+		const char		* m_shm_cache;	///< Decoded records cache, NULL if off
+		const char		* m_output;		///< Segment directory of 'convert'
+		time_t			m_bucket;		///< Time bucket width, 0 if off
+		time_t			m_window;		///< Sliding window width, 0 if off
+		unsigned			m_interval;		///< Seconds between window outputs
+		unsigned			m_top;			///< Keys printed by window, 0 for all
+		uint64_t			m_alert_packets;	///< Alert packets limit, 0 if off
+		uint64_t			m_alert_bytes;	///< Alert bytes limit, 0 if off
+		const char		* m_alerts;		///< Alert stream, NULL for stderr
+		time_t			m_from;			///< Rollup range start, 0 if off
+		time_t			m_to;				///< Rollup range end, 0 if open
+		bool				m_sidecar;		///< Use per-file partials next to files
+		bool				m_build_zones;	///< Write missing zone maps of files
+		struct flow_filter	m_filter;	///< Records used
+		bool				m_filtered;		///< Is m_filter set?
+
+		static const unsigned MAX_CACHE = 1 << 20;
+		static const unsigned MAX_SHARED_KEYS = 1 << 28;
+		static constexpr double MIN_HHH = 1e-6;
+		static const unsigned MAX_BLOCK = 1 << 24;
+		static const unsigned MAX_SHARDS = 64;
 };
 
 #endif // PARAM_H_
@@ -0,0 +1,215 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 10:16:03 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "partial.h"
+
+#include <cstring>
+
+#include "common.h"
+
+static const char PARTIAL_MAGIC[8] = { 'F', 'L', 'O', 'W', 'P', 'R', 'T', '1' };
+
+/**
+ * @brief  Write LEB128 varint
+ */
+static inline
+void put_varint(FILE * f, partial_key_t val) {
+	uint8_t buf[19];
+	unsigned n = 0;
+
+	while (val >= 0x80) {
+		buf[n++] = (uint8_t) val | 0x80;
+		val >>= 7;
+	}
+	buf[n++] = (uint8_t) val;
+
+	fwrite(buf, 1, n, f);
+}
+
+/**
+ * @brief  Read LEB128 varint
+ *
+ * @return   false on EOF or malformed varint
+ */
+static inline
+bool get_varint(FILE * f, partial_key_t & val) {
+	unsigned shift = 0;
+	int c;
+
+	val = 0;
+	do {
+		if ((c = getc(f)) == EOF || shift > 126)
+			return false;
+		val |= (partial_key_t) (c & 0x7F) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	return true;
+}
+
+/**
+ * @brief  Key bytes to number
+ */
+static inline
+partial_key_t key_load(const uint8_t * key, unsigned len) {
+	partial_key_t val = 0;
+
+	for (unsigned i = 0; i < len; ++i)
+		val = (val << 8) | key[i];
+
+	return val;
+}
+
+/**
+ * @brief  Number to key bytes
+ */
+static inline
+void key_store(partial_key_t val, uint8_t * key, unsigned len) {
+	for (unsigned i = len; i > 0; --i) {
+		key[i - 1] = (uint8_t) val;
+		val >>= 8;
+	}
+}
+
+/**
+ * @brief  Start writing partial
+ *
+ * @param w writer to init
+ * @param f opened file, closed by partial_close()
+ * @param aggregation aggregation type
+ * @param mask aggregation mask
+ * @param key_len key length in bytes
+ *
+ * @return   false on write error
+ */
+bool partial_open(struct partial_writer * w, FILE * f,
+						unsigned aggregation, unsigned mask, unsigned key_len) {
+	uint32_t hdr[3] = { aggregation, mask, key_len };
+	uint64_t zero = 0;
+
+	w->f = f;
+	w->key_len = key_len;
+	w->prev = 0;
+	w->count = 0;
+
+	if (fwrite(PARTIAL_MAGIC, sizeof(PARTIAL_MAGIC), 1, f) != 1
+			|| fwrite(hdr, sizeof(hdr), 1, f) != 1)
+		return false;
+
+	w->count_pos = ftell(f);
+	return fwrite(&zero, sizeof(zero), 1, f) == 1;
+}
+
+/**
+ * @brief  Append record, keys have to come in ascending order
+ *
+ * @param w writer to use
+ * @param key record key
+ * @param packets record packets
+ * @param bytes record bytes
+ *
+ * @return   false on error
+ */
+bool partial_write(struct partial_writer * w, const uint8_t * key,
+						uint64_t packets, uint64_t bytes) {
+	partial_key_t val = key_load(key, w->key_len);
+
+	put_varint(w->f, val - w->prev);
+	put_varint(w->f, packets);
+	put_varint(w->f, bytes);
+
+	w->prev = val;
+	w->count++;
+
+	return ! ferror(w->f);
+}
+
+/**
+ * @brief  Finish partial and store record count to header
+ *
+ * @param w writer to finish
+ *
+ * @return   false on error
+ */
+bool partial_close(struct partial_writer * w) {
+	bool ok = ! ferror(w->f);
+
+	if (w->count_pos >= 0 && ! fseek(w->f, w->count_pos, SEEK_SET))
+		ok = ok && fwrite(&w->count, sizeof(w->count), 1, w->f) == 1;
+	else {
+		err() << "Partial output has to be a regular file!\n";
+		ok = false;
+	}
+
+	return (fclose(w->f) == 0) && ok;
+}
+
+/**
+ * @brief  Read partial header
+ *
+ * @param r reader to init
+ * @param f opened file
+ *
+ * @return   false if the file is not a partial
+ */
+bool partial_read_header(struct partial_reader * r, FILE * f) {
+	char magic[sizeof(PARTIAL_MAGIC)];
+	uint32_t hdr[3];
+
+	r->f = f;
+	r->prev = 0;
+
+	if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, PARTIAL_MAGIC, sizeof(magic))
+			|| fread(hdr, sizeof(hdr), 1, f) != 1
+			|| fread(&r->left, sizeof(r->left), 1, f) != 1
+			|| hdr[2] == 0 || hdr[2] > PARTIAL_KEY_MAX)
+		return false;
+
+	r->aggregation = hdr[0];
+	r->mask = hdr[1];
+	r->key_len = hdr[2];
+
+	return true;
+}
+
+/**
+ * @brief  Read next record
+ *
+ * @param r reader to use
+ * @param key key is stored here
+ * @param packets packets are stored here
+ * @param bytes bytes are stored here
+ *
+ * @return   1 on success, 0 at the end, -1 if partial is broken
+ */
+int partial_read(struct partial_reader * r, uint8_t * key,
+						uint64_t * packets, uint64_t * bytes) {
+	partial_key_t delta, p, b;
+
+	if (! r->left)
+		return 0;
+
+	if (! get_varint(r->f, delta) || ! get_varint(r->f, p) || ! get_varint(r->f, b))
+		return -1;
+
+	r->prev += delta;
+	r->left--;
+
+	key_store(r->prev, key, r->key_len);
+	*packets = (uint64_t) p;
+	*bytes = (uint64_t) b;
+
+	return 1;
+}
@@ -0,0 +1,72 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 10:16:03 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef PARTIAL_H_
+#define PARTIAL_H_
+
+#include <inttypes.h>
+#include <cstdio>
+
+/*
+ * Binary partial aggregate, records ordered by key.
+ *
+ * Layout:
+ *   "FLOWPRT1", u32 aggregation, u32 mask, u32 key length, u64 record count
+ *   (header in host byte order), records as varint key delta, varint
+ *   packets, varint bytes.
+ *
+ * Key is read as big-endian number of key length bytes, delta is taken
+ * from the previous key (0 for the first record). Varints are LEB128.
+ */
+
+#define PARTIAL_KEY_MAX		16
+
+typedef unsigned __int128 partial_key_t;
+
+/**
+ * @brief  Partial being written
+ */
+struct partial_writer {
+	FILE * f;
+	unsigned key_len;
+	partial_key_t prev;
+	uint64_t count;
+	long count_pos;				///< position of record count
+};
+
+/**
+ * @brief  Partial being read
+ */
+struct partial_reader {
+	FILE * f;
+	unsigned aggregation;
+	unsigned mask;
+	unsigned key_len;
+	partial_key_t prev;
+	uint64_t left;					///< records not read yet
+};
+
+bool partial_open(struct partial_writer * w, FILE * f,
+						unsigned aggregation, unsigned mask, unsigned key_len);
+bool partial_write(struct partial_writer * w, const uint8_t * key,
+						uint64_t packets, uint64_t bytes);
+bool partial_close(struct partial_writer * w);
+
+bool partial_read_header(struct partial_reader * r, FILE * f);
+int partial_read(struct partial_reader * r, uint8_t * key,
+						uint64_t * packets, uint64_t * bytes);
+
+#endif // PARTIAL_H_
+
@@ -203,6 +203,56 @@ struct rbtree_node *rbtree_lookup(const struct rbtree_node *key,
 	return do_lookup(key, tree, &parent, &is_left);
 }
 
+/*
+ * Look up 'count' keys at once. Traversals are interleaved one level at a
+ * time and the next node of every traversal is prefetched, so cache misses
+ * of independent keys overlap instead of being paid one after another.
+ * 'data_offset' is the offset of the compared data relative to the node,
+ * it is prefetched together with the node.
+ */
+void rbtree_lookup_batch(const struct rbtree_node * const *keys,
+			 struct rbtree_node **found, unsigned count,
+			 const struct rbtree *tree, ptrdiff_t data_offset)
+{
+	struct rbtree_node *cur[RBTREE_BATCH_MAX];
+	unsigned i, active = 0;
+
+	assert(count <= RBTREE_BATCH_MAX);
+
+	for (i = 0; i < count; i++) {
+		found[i] = NULL;
+		cur[i] = tree->root;
+		if (cur[i])
+			active++;
+	}
+
+	while (active) {
+		active = 0;
+		for (i = 0; i < count; i++) {
+			struct rbtree_node *node = cur[i];
+			int res;
+
+			if (!node)
+				continue;
+
+			res = tree->fun.cmp_fn(node, keys[i]);
+			if (res == 0) {
+				found[i] = node;
+				cur[i] = NULL;
+				continue;
+			}
+
+			node = res > 0 ? node->left : node->right;
+			cur[i] = node;
+			if (node) {
+				__builtin_prefetch(node);
+				__builtin_prefetch((const char *)node + data_offset);
+				active++;
+			}
+		}
+	}
+}
+
 static void set_child(struct rbtree_node *child, struct rbtree_node *node, int left)
 {
 	if (left)
@@ -447,3 +497,71 @@ void rbtree_replace(struct rbtree_node *old, struct rbtree_node *newnode,
 	*newnode = *old;
 }
 
+
+/*
+ * Unlink all nodes of the tree into an ascending list chained through
+ * 'right' pointers. The tree is walked backwards so that only 'right'
+ * pointers of already visited nodes are overwritten. The tree is left
+ * empty and the number of nodes is stored to 'count'.
+ */
+struct rbtree_node *rbtree_to_list(struct rbtree *tree, size_t *count)
+{
+	struct rbtree_node *node = tree->last;
+	struct rbtree_node *list = NULL;
+
+	*count = 0;
+	while (node) {
+		struct rbtree_node *prev = rbtree_prev(node);
+		node->right = list;
+		list = node;
+		node = prev;
+		(*count)++;
+	}
+
+	tree->root = tree->first = tree->last = NULL;
+	return list;
+}
+
+static struct rbtree_node *build(struct rbtree_node **list, size_t count,
+				  unsigned depth, unsigned red_depth,
+				  struct rbtree_node *parent)
+{
+	struct rbtree_node *left, *node;
+	size_t left_count;
+
+	if (!count)
+		return NULL;
+
+	left_count = (count - 1) / 2;
+	left = build(list, left_count, depth + 1, red_depth, NULL);
+
+	node = *list;
+	*list = node->right;
+
+	node->left = left;
+	if (left)
+		set_parent(node, left);
+	set_parent(parent, node);
+	set_color(depth && depth == red_depth ? RB_RED : RB_BLACK, node);
+
+	node->right = build(list, count - 1 - left_count, depth + 1, red_depth, node);
+	return node;
+}
+
+/*
+ * Build a tree from an ascending list of unique keys chained through
+ * 'right' pointers in linear time. Splitting on the middle keeps all
+ * leaves on the two deepest levels, so coloring the deepest level red
+ * and everything else black satisfies the red-black properties.
+ */
+void rbtree_from_list(struct rbtree *tree, struct rbtree_node *list, size_t count)
+{
+	unsigned red_depth = 0;
+
+	while ((count >> (red_depth + 1)) != 0)
+		red_depth++;
+
+	tree->root = build(&list, count, 0, red_depth, NULL);
+	tree->first = tree->root ? get_first(tree->root) : NULL;
+	tree->last = tree->root ? get_last(tree->root) : NULL;
+}
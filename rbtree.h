@@ -113,5 +113,20 @@ struct rbtree_node *rbtree_insert(struct rbtree_node *node, struct rbtree *tree)
 void rbtree_remove(struct rbtree_node *node, struct rbtree *tree);
 void rbtree_replace(struct rbtree_node *old, struct rbtree_node *node, struct rbtree *tree);
 
+/*
+ * Batched lookup, see rbtree_lookup_batch() in rbtree.cpp.
+ */
+#define RBTREE_BATCH_MAX	32
+
+void rbtree_lookup_batch(const struct rbtree_node * const *keys,
+			 struct rbtree_node **found, unsigned count,
+			 const struct rbtree *tree, ptrdiff_t data_offset);
+
+/*
+ * Sorted lists are chained through 'right' pointers.
+ */
+struct rbtree_node *rbtree_to_list(struct rbtree *tree, size_t *count);
+void rbtree_from_list(struct rbtree *tree, struct rbtree_node *list, size_t count);
+
 #endif // RBTREE_H_
 
@@ -0,0 +1,246 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 04:31:02 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "rollup.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "bucket.h"
+#include "sidecar.h"
+
+const time_t ROLLUP_WIDTH[ROLLUP_LEVELS] = { BUCKET_5M, BUCKET_1H, BUCKET_1D };
+
+/**
+ * @brief  Level directory names, in the order of ROLLUP_WIDTH
+ */
+static const char * ROLLUP_LEVEL[ROLLUP_LEVELS] = { "5m", "1h", "1d" };
+
+/**
+ * @brief  Get directory of a level of a store
+ *
+ * @param store store directory
+ * @param aggregation aggregation of buckets
+ * @param mask mask of buckets
+ * @param level index to ROLLUP_WIDTH
+ *
+ * @return   directory holding buckets
+ */
+std::string rollup_dir(const char * store, unsigned aggregation, unsigned mask, unsigned level) {
+	return std::string(store) + "/" + aggregation_name(aggregation, mask) + "/" + ROLLUP_LEVEL[level];
+}
+
+/**
+ * @brief  Get path of a bucket
+ *
+ * @param dir level directory
+ * @param start bucket start
+ *
+ * @return   bucket path
+ */
+std::string rollup_path(const std::string & dir, time_t start) {
+	return dir + "/" + bucket_format(start);
+}
+
+/**
+ * @brief  Create a directory unless it exists
+ *
+ * @param path directory to create
+ *
+ * @return   false on error
+ */
+static
+bool rollup_mkdir_one(const std::string & path) {
+	if (mkdir(path.c_str(), 0777) && errno != EEXIST) {
+		perror(path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Create directories of a store
+ *
+ * @param store store directory
+ * @param aggregation aggregation of buckets
+ * @param mask mask of buckets
+ *
+ * @return   false on error
+ */
+bool rollup_mkdir(const char * store, unsigned aggregation, unsigned mask) {
+	if (! rollup_mkdir_one(store)
+			|| ! rollup_mkdir_one(std::string(store) + "/" + aggregation_name(aggregation, mask)))
+		return false;
+
+	for (unsigned level = 0; level < ROLLUP_LEVELS; ++level) {
+		if (! rollup_mkdir_one(rollup_dir(store, aggregation, mask, level)))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  List buckets of a level
+ *
+ * @param dir level directory
+ * @param starts starts of buckets found are added here
+ *
+ * @return   false if the directory can not be read
+ */
+bool rollup_list(const std::string & dir, std::set<time_t> & starts) {
+	struct dirent * ent;
+	DIR * d;
+
+	if (! (d = opendir(dir.c_str()))) {
+		perror(dir.c_str());
+		return false;
+	}
+
+	// temporaries of buckets being written do not parse
+	while ((ent = readdir(d)) != NULL) {
+		time_t t;
+
+		if (bucket_parse(ent->d_name, &t))
+			starts.insert(t);
+	}
+
+	closedir(d);
+	return true;
+}
+
+/**
+ * @brief  Is a bucket newer than its inputs?
+ *
+ * @param path bucket path
+ * @param mtime modification time of the newest input
+ *
+ * @return   true if the bucket exists and is not older than mtime
+ */
+bool rollup_fresh(const std::string & path, time_t mtime) {
+	struct stat st;
+
+	return ! stat(path.c_str(), &st) && st.st_mtime >= mtime;
+}
+
+/**
+ * @brief  Create a temporary file next to a bucket
+ *
+ * @param path bucket path
+ * @param tmp name of the temporary file
+ *
+ * @return   opened temporary file, NULL on error
+ */
+FILE * rollup_create(const std::string & path, std::string & tmp) {
+	std::vector<char> name(path.begin(), path.end());
+	const char * suffix = ".XXXXXX";
+	FILE * f;
+	int fd;
+
+	name.insert(name.end(), suffix, suffix + strlen(suffix) + 1);
+
+	if ((fd = mkstemp(&name[0])) < 0) {
+		perror(path.c_str());
+		return NULL;
+	}
+
+	if (! (f = fdopen(fd, "w+b"))) {
+		perror(path.c_str());
+		close(fd);
+		unlink(&name[0]);
+		return NULL;
+	}
+
+	tmp = &name[0];
+	return f;
+}
+
+/**
+ * @brief  Replace a bucket by its temporary file, the file has to be closed
+ *         already (partial_close())
+ *
+ * @param tmp temporary file
+ * @param path bucket path
+ * @param ok was the bucket written?
+ *
+ * @return   false if the bucket was not replaced
+ */
+bool rollup_commit(const std::string & tmp, const std::string & path, bool ok) {
+	// mkstemp() creates the file private, other runs may be other users
+	mode_t mask = umask(0);
+	umask(mask);
+	chmod(tmp.c_str(), 0666 & ~mask);
+
+	if (ok && rename(tmp.c_str(), path.c_str())) {
+		perror(path.c_str());
+		ok = false;
+	}
+
+	if (! ok)
+		unlink(tmp.c_str());
+
+	return ok;
+}
+
+/**
+ * @brief  Select the fewest buckets covering a time range, coarse buckets
+ *         are used where they fit the range
+ *
+ * @param dir store directory of an aggregation (DIR/AGGREGATION)
+ * @param from range start, rounded down to 5m
+ * @param to range end (excluded), 0 for all buckets after from
+ * @param paths paths of buckets selected
+ *
+ * @return   false if the store can not be read
+ */
+bool rollup_select(const char * dir, time_t from, time_t to, std::vector<std::string> & paths) {
+	std::set<time_t> starts[ROLLUP_LEVELS];
+	std::string dirs[ROLLUP_LEVELS];
+
+	for (unsigned level = 0; level < ROLLUP_LEVELS; ++level) {
+		dirs[level] = std::string(dir) + "/" + ROLLUP_LEVEL[level];
+		if (! rollup_list(dirs[level], starts[level]))
+			return false;
+
+		if (! to && ! starts[level].empty())
+			to = std::max(to, *starts[level].rbegin() + ROLLUP_WIDTH[level]);
+	}
+
+	for (time_t t = bucket_start(from, ROLLUP_WIDTH[0]); t < to; /**/) {
+		unsigned level = ROLLUP_LEVELS;
+
+		while (level-- > 0) {
+			// 5m bucket starting in the range is always used
+			if (t % ROLLUP_WIDTH[level] == 0 && (! level || t + ROLLUP_WIDTH[level] <= to)
+					&& starts[level].count(t))
+				break;
+		}
+
+		if (level < ROLLUP_LEVELS) {
+			paths.push_back(rollup_path(dirs[level], t));
+			t += ROLLUP_WIDTH[level];
+		} else
+			t += ROLLUP_WIDTH[0];
+	}
+
+	return true;
+}
+
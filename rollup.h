@@ -0,0 +1,51 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 04:31:02 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef ROLLUP_H_
+#define ROLLUP_H_
+
+#include <ctime>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+ * Store of aggregated results by time buckets (see bucket.h), so reports
+ * over hours or days merge a few buckets instead of reading raw files.
+ *
+ * Layout:
+ *   DIR/AGGREGATION/LEVEL/YYYYMMDDhhmm
+ *
+ * Every bucket is a partial (see partial.h) of records of the bucket
+ * starting at the time. Levels are 5m, 1h and 1d, a 5m bucket is written
+ * from record files, coarser buckets are merged from the finer level.
+ */
+
+#define ROLLUP_LEVELS		3
+
+extern const time_t ROLLUP_WIDTH[ROLLUP_LEVELS];
+
+std::string rollup_dir(const char * store, unsigned aggregation, unsigned mask, unsigned level);
+std::string rollup_path(const std::string & dir, time_t start);
+bool rollup_mkdir(const char * store, unsigned aggregation, unsigned mask);
+bool rollup_list(const std::string & dir, std::set<time_t> & starts);
+bool rollup_fresh(const std::string & path, time_t mtime);
+FILE * rollup_create(const std::string & path, std::string & tmp);
+bool rollup_commit(const std::string & tmp, const std::string & path, bool ok);
+bool rollup_select(const char * dir, time_t from, time_t to, std::vector<std::string> & paths);
+
+#endif // ROLLUP_H_
+
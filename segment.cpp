@@ -0,0 +1,422 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 01:12:40 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "segment.h"
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "param.h"
+#include "zone.h"
+
+static const char SEGMENT_MAGIC[8] = { 'F', 'L', 'O', 'W', 'C', 'O', 'L', '1' };
+
+/**
+ * @brief  Segment header
+ */
+struct segment_header {
+	char magic[sizeof(SEGMENT_MAGIC)];
+	uint64_t rows;
+	struct segment_column column[SEGMENT_COLUMNS];
+};
+
+/**
+ * @brief  Address order of dictionary
+ */
+static
+bool segment_addr_less(const struct in6_addr & a, const struct in6_addr & b) {
+	return memcmp(&a, &b, sizeof(a)) < 0;
+}
+
+/**
+ * @brief  Address equality of dictionary
+ */
+static
+bool segment_addr_equal(const struct in6_addr & a, const struct in6_addr & b) {
+	return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+/**
+ * @brief  Read segment header, file position is kept
+ *
+ * @param f file to read
+ * @param hdr header is stored here
+ *
+ * @return   false if file is not a segment
+ */
+static
+bool segment_header(FILE * f, struct segment_header * hdr) {
+	return pread(fileno(f), hdr, sizeof(*hdr), 0) == (ssize_t) sizeof(*hdr)
+		&& ! memcmp(hdr->magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+}
+
+/**
+ * @brief  Is file a segment?
+ *
+ * @param f file to check, position is kept
+ *
+ * @return   true if file is a segment
+ */
+bool segment_check(FILE * f) {
+	struct segment_header hdr;
+
+	return segment_header(f, &hdr);
+}
+
+/**
+ * @brief  Get number of records of a segment
+ *
+ * @param f file to check, position is kept
+ * @param rows number of records is stored here
+ *
+ * @return   false if file is not a segment
+ */
+bool segment_rows(FILE * f, uint64_t * rows) {
+	struct segment_header hdr;
+
+	if (! segment_header(f, &hdr))
+		return false;
+
+	*rows = hdr.rows;
+	return true;
+}
+
+/**
+ * @brief  Decode dictionary column
+ *
+ * @param data encoded column
+ * @param size encoded length
+ * @param rows number of rows
+ * @param out decoded addresses
+ *
+ * @return   false if column is corrupted
+ */
+static
+bool segment_decode_dict(const uint8_t * data, size_t size, size_t rows, struct in6_addr * out) {
+	const struct in6_addr * dict = (const struct in6_addr *) (data + 2 * sizeof(uint32_t));
+	uint32_t hdr[2];
+
+	if (size < sizeof(hdr))
+		return false;
+	memcpy(hdr, data, sizeof(hdr));
+
+	if ((hdr[1] != 1 && hdr[1] != 2 && hdr[1] != 4)
+			|| size != sizeof(hdr) + (size_t) hdr[0] * sizeof(struct in6_addr) + rows * hdr[1])
+		return false;
+
+	const uint8_t * index = (const uint8_t *) (dict + hdr[0]);
+
+	for (size_t i = 0; i < rows; ++i) {
+		uint32_t idx;
+
+		if (hdr[1] == 1)
+			idx = index[i];
+		else if (hdr[1] == 2) {
+			uint16_t v;
+			memcpy(&v, index + 2 * i, sizeof(v));
+			idx = v;
+		} else
+			memcpy(&idx, index + 4 * i, sizeof(idx));
+
+		if (idx >= hdr[0])
+			return false;
+		memcpy(out + i, dict + idx, sizeof(*out));
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Decode LEB128 column
+ *
+ * @param data encoded column
+ * @param size encoded length
+ * @param rows number of rows
+ * @param out decoded values
+ *
+ * @return   false if column is corrupted
+ */
+static
+bool segment_decode_varint(const uint8_t * data, size_t size, size_t rows, uint64_t * out) {
+	const uint8_t * end = data + size;
+
+	for (size_t i = 0; i < rows; ++i) {
+		uint64_t v = 0;
+		unsigned shift = 0;
+
+		do {
+			if (data == end || shift > 63)
+				return false;
+			v |= (uint64_t) (*data & 0x7f) << shift;
+			shift += 7;
+		} while (*data++ & 0x80);
+
+		out[i] = v;
+	}
+
+	return data == end;
+}
+
+/**
+ * @brief  Read columns wanted by store from segment, rows are appended
+ *
+ * @param f segment to read
+ * @param s store with capacity for the rows
+ *
+ * @return   false if segment is corrupted or store is too small
+ */
+bool segment_read(FILE * f, struct flow_store * s) {
+	struct segment_header hdr;
+	std::vector<uint8_t> buf;
+	struct stat st;
+
+	if (! segment_header(f, &hdr) || fstat(fileno(f), &st)
+			|| hdr.rows > s->capacity - s->rows)
+		return false;
+
+	for (unsigned i = 0; i < SEGMENT_COLUMNS; ++i) {
+		const struct segment_column * c = hdr.column + i;
+		uint8_t * out = store_column(s, i);
+		bool ok;
+
+		if (! out)
+			continue;
+		out += s->rows * STORE_WIDTH[i];
+
+		if (c->offset > (uint64_t) st.st_size || c->size > (uint64_t) st.st_size - c->offset)
+			return false;
+
+		buf.resize(c->size);
+		if (c->size && pread(fileno(f), &buf[0], c->size, c->offset) != (ssize_t) c->size)
+			return false;
+
+		if (c->encoding == SEGMENT_RAW) {
+			ok = c->size == hdr.rows * STORE_WIDTH[i];
+			if (ok && c->size)
+				memcpy(out, &buf[0], c->size);
+		} else if (c->encoding == SEGMENT_DICT && STORE_WIDTH[i] == sizeof(struct in6_addr))
+			ok = segment_decode_dict(buf.data(), c->size, hdr.rows, (struct in6_addr *) out);
+		else if (c->encoding == SEGMENT_VARINT && STORE_WIDTH[i] == sizeof(uint64_t))
+			ok = segment_decode_varint(buf.data(), c->size, hdr.rows, (uint64_t *) out);
+		else
+			ok = false;
+
+		if (! ok)
+			return false;
+	}
+
+	s->rows += hdr.rows;
+	return true;
+}
+
+/**
+ * @brief  Encode address column by dictionary, if it pays off
+ *
+ * @param column addresses
+ * @param rows number of rows
+ * @param out encoded column
+ *
+ * @return   false if dictionary is not smaller than plain column
+ */
+static
+bool segment_encode_dict(const struct in6_addr * column, size_t rows, std::vector<uint8_t> & out) {
+	std::vector<struct in6_addr> dict(column, column + rows);
+	uint32_t hdr[2];
+
+	std::sort(dict.begin(), dict.end(), segment_addr_less);
+	dict.erase(std::unique(dict.begin(), dict.end(), segment_addr_equal), dict.end());
+
+	hdr[0] = dict.size();
+	hdr[1] = dict.size() <= 0x100 ? 1 : (dict.size() <= 0x10000 ? 2 : 4);
+
+	if (sizeof(hdr) + dict.size() * sizeof(struct in6_addr) + rows * hdr[1]
+			>= rows * sizeof(struct in6_addr))
+		return false;
+
+	out.resize(sizeof(hdr) + dict.size() * sizeof(struct in6_addr) + rows * hdr[1]);
+	memcpy(&out[0], hdr, sizeof(hdr));
+	memcpy(&out[sizeof(hdr)], dict.data(), dict.size() * sizeof(struct in6_addr));
+
+	uint8_t * index = &out[sizeof(hdr) + dict.size() * sizeof(struct in6_addr)];
+
+	for (size_t i = 0; i < rows; ++i) {
+		uint32_t idx = std::lower_bound(dict.begin(), dict.end(), column[i], segment_addr_less)
+			- dict.begin();
+
+		if (hdr[1] == 1)
+			index[i] = idx;
+		else if (hdr[1] == 2) {
+			uint16_t v = idx;
+			memcpy(index + 2 * i, &v, sizeof(v));
+		} else
+			memcpy(index + 4 * i, &idx, sizeof(idx));
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Encode counter column as LEB128
+ *
+ * @param column values
+ * @param rows number of rows
+ * @param out encoded column
+ */
+static
+void segment_encode_varint(const uint64_t * column, size_t rows, std::vector<uint8_t> & out) {
+	out.clear();
+	out.reserve(rows * 2);
+
+	for (size_t i = 0; i < rows; ++i) {
+		uint64_t v = column[i];
+
+		while (v >= 0x80) {
+			out.push_back((v & 0x7f) | 0x80);
+			v >>= 7;
+		}
+		out.push_back(v);
+	}
+}
+
+/**
+ * @brief  Write store as segment, file is replaced atomically
+ *
+ * @param path segment to write
+ * @param s store with all columns
+ *
+ * @return   false on error
+ */
+bool segment_write(const char * path, const struct flow_store * s) {
+	std::vector<uint8_t> data[SEGMENT_COLUMNS];
+	std::string tmp = std::string(path) + ".tmp";
+	struct segment_header hdr;
+	uint64_t pos = sizeof(hdr);
+	bool ok = true;
+	FILE * f;
+
+	if (s->columns != STORE_ALL)
+		return false;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+	hdr.rows = s->rows;
+
+	for (unsigned i = 0; i < SEGMENT_COLUMNS; ++i) {
+		const uint8_t * column = store_column(s, i);
+
+		if (STORE_WIDTH[i] == sizeof(struct in6_addr)
+				&& segment_encode_dict((const struct in6_addr *) column, s->rows, data[i]))
+			hdr.column[i].encoding = SEGMENT_DICT;
+		else if (STORE_WIDTH[i] == sizeof(uint64_t)) {
+			segment_encode_varint((const uint64_t *) column, s->rows, data[i]);
+			hdr.column[i].encoding = SEGMENT_VARINT;
+		} else {
+			data[i].assign(column, column + s->rows * STORE_WIDTH[i]);
+			hdr.column[i].encoding = SEGMENT_RAW;
+		}
+
+		hdr.column[i].offset = pos;
+		hdr.column[i].size = data[i].size();
+		pos += data[i].size();
+	}
+
+	if ((f = fopen(tmp.c_str(), "wb")) == NULL) {
+		perror(tmp.c_str());
+		return false;
+	}
+
+	ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+	for (unsigned i = 0; ok && i < SEGMENT_COLUMNS; ++i)
+		ok = data[i].empty() || fwrite(data[i].data(), data[i].size(), 1, f) == 1;
+
+	if (fclose(f) || ! ok || rename(tmp.c_str(), path)) {
+		perror(path);
+		unlink(tmp.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Create output directory of segments unless it exists
+ *
+ * @param dir directory to create
+ *
+ * @return   false on error
+ */
+bool segment_mkdir(const char * dir) {
+	struct stat st;
+
+	if (mkdir(dir, 0777) && errno != EEXIST) {
+		const int error = errno;
+		err() << "Unable to create output directory '" << dir << "': " << strerror(error) << "\n";
+		return false;
+	}
+
+	if (stat(dir, &st) || ! S_ISDIR(st.st_mode)) {
+		err() << "Output '" << dir << "' is not a directory!\n";
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Convert files to segments of the same names
+ *
+ * @param files record files (or segments) to convert
+ * @param dir directory to write segments to
+ *
+ * @return   false on error
+ */
+bool segment_convert(struct linked_list * files, const char * dir) {
+	if (! segment_mkdir(dir))
+		return false;
+
+	for (struct linked_list_node * l = linked_list_last(files); l; l = l->prev) {
+		const char * base = strrchr(l->name, '/');
+		std::string path = std::string(dir) + "/" + (base ? base + 1 : l->name);
+		struct flow_store s;
+		struct stat st;
+		bool ok;
+
+		if (! store_init(&s, store_rows_file(l), STORE_ALL)) {
+			err() << "Unable to allocate records of '" << l->name << "'!\n";
+			return false;
+		}
+
+		ok = store_load_file(&s, l) && segment_write(path.c_str(), &s);
+
+		if (ok)
+			zone_write(path, &s);
+
+		if (ok && Param::stats() && stat(path.c_str(), &st) == 0)
+			std::cerr << "segment: " << path << " " << s.rows << " records, "
+				<< s.rows * sizeof(struct Flow::data) << " -> " << st.st_size << " bytes\n";
+
+		store_free(&s);
+
+		if (! ok)
+			return false;
+	}
+
+	return true;
+}
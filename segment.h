@@ -0,0 +1,66 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 01:12:40 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef SEGMENT_H_
+#define SEGMENT_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "store.h"
+#include "file_list.h"
+
+/*
+ * Columnar segment, records of a file stored by columns so a query reads
+ * only the key column and the counters.
+ *
+ * Layout (host byte order):
+ *   "FLOWCOL1", u64 rows, SEGMENT_COLUMNS x segment_column in the order of
+ *   flow_store, column data
+ *
+ * Column encodings:
+ *   SEGMENT_RAW     rows values as stored in flow_store
+ *   SEGMENT_DICT    u32 entries, u32 index width (1, 2 or 4), sorted
+ *                   addresses, rows indexes to addresses
+ *   SEGMENT_VARINT  rows LEB128 values
+ */
+
+#define SEGMENT_COLUMNS		6
+
+enum segment_encoding {
+	SEGMENT_RAW,
+	SEGMENT_DICT,
+	SEGMENT_VARINT
+};
+
+/**
+ * @brief  Column of a segment
+ */
+struct segment_column {
+	uint32_t encoding;
+	uint32_t reserved;
+	uint64_t offset;								///< data position in file
+	uint64_t size;									///< data length
+};
+
+bool segment_check(FILE * f);
+bool segment_rows(FILE * f, uint64_t * rows);
+bool segment_read(FILE * f, struct flow_store * s);
+bool segment_write(const char * path, const struct flow_store * s);
+bool segment_mkdir(const char * dir);
+bool segment_convert(struct linked_list * files, const char * dir);
+
+#endif // SEGMENT_H_
+
@@ -0,0 +1,112 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 11:02:45 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "shard.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+/**
+ * @brief  Send buffer to shard as a whole
+ *
+ * @param link shard socket
+ * @param buf data to send
+ * @param len data length
+ *
+ * @return   false if shard is gone
+ */
+bool shard_send(struct shard_link * link, const void * buf, size_t len) {
+	const char * p = (const char *) buf;
+	bool ok = true;
+
+	pthread_mutex_lock(&link->mutex);
+
+	while (len) {
+		// worker may be gone, do not get killed by SIGPIPE
+		ssize_t ret = send(link->fd, p, len, MSG_NOSIGNAL);
+
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			ok = false;
+			break;
+		}
+
+		p += ret;
+		len -= ret;
+	}
+
+	pthread_mutex_unlock(&link->mutex);
+	return ok;
+}
+
+/**
+ * @brief  Init router of a reader thread
+ *
+ * @param r router to init
+ * @param links sockets of shards
+ * @param shards number of shards
+ * @param key_len key length in bytes
+ * @param key_offset key offset inside records
+ */
+void shard_router_init(struct shard_router * r, struct shard_link * links, unsigned shards,
+								unsigned key_len, size_t key_offset) {
+	r->links = links;
+	r->shards = shards;
+	r->key_len = key_len;
+	r->key_offset = key_offset;
+	r->batch = new struct block_entry[shards * SHARD_BATCH];
+	r->count = new unsigned[shards]();
+	r->failed = false;
+
+	// keys are shorter than entries, do not send garbage
+	memset(r->batch, 0, sizeof(struct block_entry) * shards * SHARD_BATCH);
+}
+
+/**
+ * @brief  Send batch of a shard
+ *
+ * @param r router to use
+ * @param shard shard to send batch to
+ *
+ * @return   false if shard is gone
+ */
+bool shard_router_flush(struct shard_router * r, unsigned shard) {
+	if (r->count[shard] && ! shard_send(&r->links[shard], &r->batch[shard * SHARD_BATCH],
+					r->count[shard] * sizeof(struct block_entry)))
+		r->failed = true;
+
+	r->count[shard] = 0;
+	return ! r->failed;
+}
+
+/**
+ * @brief  Send all batches left and free router
+ *
+ * @param r router to free
+ *
+ * @return   false if any shard is gone
+ */
+bool shard_router_free(struct shard_router * r) {
+	for (unsigned i = 0; i < r->shards; ++i)
+		shard_router_flush(r, i);
+
+	delete [] r->batch;
+	delete [] r->count;
+
+	return ! r->failed;
+}
@@ -0,0 +1,104 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 11:02:45 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef SHARD_H_
+#define SHARD_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "block.h"
+
+/*
+ * Keys are partitioned among worker processes by hash. Reader threads of
+ * the coordinator collect masked keys in per-shard batches and send full
+ * batches as block entries over a Unix socket of the owner. When all
+ * records are sent, the coordinator shuts the sockets down for writing and
+ * every worker answers with its sorted result (Flow::data records).
+ */
+
+#define SHARD_MAX			64
+#define SHARD_BATCH		256
+
+/**
+ * @brief  Socket of a shard, shared by all reader threads
+ */
+struct shard_link {
+	int fd;
+	pthread_mutex_t mutex;				///< batches are sent whole
+};
+
+/**
+ * @brief  Per-thread router of keys to shards
+ */
+struct shard_router {
+	struct shard_link * links;
+	unsigned shards;
+	unsigned key_len;
+	size_t key_offset;					///< key offset inside records
+	struct block_entry * batch;		///< SHARD_BATCH entries of every shard
+	unsigned * count;						///< entries waiting in every batch
+	bool failed;							///< a shard is gone
+};
+
+bool shard_send(struct shard_link * link, const void * buf, size_t len);
+void shard_router_init(struct shard_router * r, struct shard_link * links, unsigned shards,
+								unsigned key_len, size_t key_offset);
+bool shard_router_flush(struct shard_router * r, unsigned shard);
+bool shard_router_free(struct shard_router * r);
+
+/**
+ * @brief  Shard owning a key
+ *
+ * @param key key bytes
+ * @param len key length
+ * @param shards number of shards
+ *
+ * @return   shard index
+ */
+inline unsigned shard_of(const uint8_t * key, unsigned len, unsigned shards) {
+	uint64_t h = 0xcbf29ce484222325ULL;		// FNV-1a
+
+	for (unsigned i = 0; i < len; ++i)
+		h = (h ^ key[i]) * 0x100000001b3ULL;
+
+	return (unsigned) ((h >> 32) % shards);
+}
+
+/**
+ * @brief  Route record to its shard
+ *
+ * @param r router of the thread
+ * @param record record holding key at key_offset
+ * @param packets record packets
+ * @param bytes record bytes
+ */
+inline void shard_route(struct shard_router * r, const void * record,
+								uint64_t packets, uint64_t bytes) {
+	const uint8_t * key = (const uint8_t *) record + r->key_offset;
+	unsigned shard = shard_of(key, r->key_len, r->shards);
+	struct block_entry * e = &r->batch[shard * SHARD_BATCH + r->count[shard]++];
+
+	memcpy(e->key, key, r->key_len);
+	e->packets = packets;
+	e->bytes = bytes;
+
+	if (r->count[shard] == SHARD_BATCH)
+		shard_router_flush(r, shard);
+}
+
+#endif // SHARD_H_
+
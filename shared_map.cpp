@@ -0,0 +1,223 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 02:40:03 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "shared_map.h"
+#include "hugepage.h"
+
+#include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+enum {
+	SLOT_EMPTY,
+	SLOT_BUSY,
+	SLOT_READY
+};
+
+static inline
+size_t key_hash(const uint8_t * key, unsigned len) {
+	uint64_t h = 0xCBF29CE484222325ULL;
+
+	for (unsigned i = 0; i < len; ++i)
+		h = (h ^ key[i]) * 0x100000001B3ULL;
+
+	return (size_t) (h ^ (h >> 29));
+}
+
+static inline
+void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+/**
+ * @brief  Initialize map
+ *
+ * @param map map to init
+ * @param keys keys taken at least, slots are rounded up to power of two
+ * @param stripes counter arrays, one per updating thread (clamped)
+ * @param key_len key length in bytes
+ * @param key_offset offset of key inside records passed to shared_map_add()
+ *
+ * @return   false if memory could not be allocated
+ */
+bool shared_map_init(struct shared_map * map, size_t keys, unsigned stripes,
+							unsigned key_len, size_t key_offset) {
+	assert(key_len > 0 && key_len <= SHARED_KEY_MAX);
+
+	map->capacity = 4;
+	while (map->capacity / 4 * 3 < keys)
+		map->capacity <<= 1;
+
+	map->mask = map->capacity - 1;
+	map->limit = map->capacity / 4 * 3;
+	map->size = 0;
+	map->stripes = std::max(1u, std::min(stripes, (unsigned) SHARED_STRIPES));
+	map->key_len = key_len;
+	map->key_offset = key_offset;
+	map->overflow = 0;
+
+	map->slots = (struct shared_slot *) huge_alloc(map->capacity * sizeof(struct shared_slot));
+	if (! map->slots)
+		return false;
+
+	for (unsigned i = 0; i < map->stripes; ++i) {
+		map->stripe[i] = (struct shared_counter *)
+					huge_alloc(map->capacity * sizeof(struct shared_counter));
+		if (! map->stripe[i]) {
+			while (i--)
+				huge_free(map->stripe[i], map->capacity * sizeof(struct shared_counter));
+			huge_free(map->slots, map->capacity * sizeof(struct shared_slot));
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Free map
+ *
+ * @param map map to free
+ */
+void shared_map_free(struct shared_map * map) {
+	for (unsigned i = 0; i < map->stripes; ++i)
+		huge_free(map->stripe[i], map->capacity * sizeof(struct shared_counter));
+	huge_free(map->slots, map->capacity * sizeof(struct shared_slot));
+	map->slots = NULL;
+}
+
+/**
+ * @brief  Prefetch slot where probing for key of a record starts
+ *
+ * @param map map to be updated
+ * @param record record holding key at map->key_offset
+ * @param stripe stripe of calling thread
+ *
+ * @return   slot index to be passed to shared_map_add_at()
+ */
+size_t shared_map_prefetch(const struct shared_map * map, const void * record, unsigned stripe) {
+	const uint8_t * key = (const uint8_t *) record + map->key_offset;
+	size_t i = key_hash(key, map->key_len) & map->mask;
+
+	__builtin_prefetch(&map->slots[i]);
+	__builtin_prefetch(&map->stripe[stripe % map->stripes][i], 1);
+
+	return i;
+}
+
+/**
+ * @brief  Add counters of a record, the key is taken from record
+ *
+ * @param map map to update
+ * @param record record holding key at map->key_offset
+ * @param packets packets to add
+ * @param bytes bytes to add
+ * @param stripe stripe of calling thread
+ *
+ * @return   false if the key was refused, overflow flag is set
+ */
+bool shared_map_add(struct shared_map * map, const void * record,
+							uint64_t packets, uint64_t bytes, unsigned stripe) {
+	const uint8_t * key = (const uint8_t *) record + map->key_offset;
+
+	return shared_map_add_at(map, record, key_hash(key, map->key_len) & map->mask,
+										packets, bytes, stripe);
+}
+
+/**
+ * @brief  Add counters of a record, probing starts at a known slot
+ *
+ * @param map map to update
+ * @param record record holding key at map->key_offset
+ * @param i slot returned by shared_map_prefetch()
+ * @param packets packets to add
+ * @param bytes bytes to add
+ * @param stripe stripe of calling thread
+ *
+ * @return   false if the key was refused, overflow flag is set
+ */
+bool shared_map_add_at(struct shared_map * map, const void * record, size_t i,
+							uint64_t packets, uint64_t bytes, unsigned stripe) {
+	const uint8_t * key = (const uint8_t *) record + map->key_offset;
+
+	for (size_t probe = 0; probe < map->capacity; ++probe, i = (i + 1) & map->mask) {
+		struct shared_slot * slot = &map->slots[i];
+		uint32_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+
+		if (state == SLOT_EMPTY) {
+			uint32_t expected = SLOT_EMPTY;
+
+			// keys are never removed, the key is not in the map
+			if (__atomic_add_fetch(&map->size, 1, __ATOMIC_RELAXED) > map->limit) {
+				__atomic_sub_fetch(&map->size, 1, __ATOMIC_RELAXED);
+				break;
+			}
+
+			if (__atomic_compare_exchange_n(&slot->state, &expected, SLOT_BUSY,
+								false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+				memcpy(slot->key, key, map->key_len);
+				__atomic_store_n(&slot->state, SLOT_READY, __ATOMIC_RELEASE);
+				state = SLOT_READY;
+			} else {
+				__atomic_sub_fetch(&map->size, 1, __ATOMIC_RELAXED);
+				state = expected;
+			}
+		}
+
+		// somebody else is publishing a key right now
+		while (state == SLOT_BUSY) {
+			cpu_relax();
+			state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+		}
+
+		if (! memcmp(slot->key, key, map->key_len)) {
+			struct shared_counter * c = &map->stripe[stripe % map->stripes][i];
+			__atomic_fetch_add(&c->packets, packets, __ATOMIC_RELAXED);
+			__atomic_fetch_add(&c->bytes, bytes, __ATOMIC_RELAXED);
+			return true;
+		}
+	}
+
+	__atomic_store_n(&map->overflow, 1, __ATOMIC_RELAXED);
+	return false;
+}
+
+/**
+ * @brief  Visit all keys with summed counters, no concurrent updates are
+ *         allowed
+ *
+ * @param map map to traverse
+ * @param cb callback called for every key
+ * @param data user data passed to callback
+ */
+void shared_map_iter(const struct shared_map * map, shared_cb_t cb, void * data) {
+	for (size_t i = 0; i < map->capacity; ++i) {
+		uint64_t packets = 0;
+		uint64_t bytes = 0;
+
+		if (map->slots[i].state != SLOT_READY)
+			continue;
+
+		for (unsigned s = 0; s < map->stripes; ++s) {
+			packets += map->stripe[s][i].packets;
+			bytes += map->stripe[s][i].bytes;
+		}
+
+		cb(map->slots[i].key, packets, bytes, data);
+	}
+}
@@ -0,0 +1,79 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 02:40:03 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef SHARED_MAP_H_
+#define SHARED_MAP_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/*
+ * Concurrent open addressing hash map shared by all worker threads.
+ *
+ * A slot is claimed by CAS on its state, the key is written and the slot
+ * is published. Keys are never removed, so a published slot stays valid
+ * and counters are updated by atomic fetch_add only. Counters are split
+ * into up to SHARED_STRIPES separate arrays and a thread updates only its
+ * own stripe, so threads hammering the same hot key do not fight for
+ * a single cache line. Stripes are summed when the map is read.
+ *
+ * The map takes at most limit keys (3/4 of slots), a new key above it is
+ * refused and the caller keeps it elsewhere (per-thread index).
+ */
+
+#ifndef SHARED_STRIPES
+# define SHARED_STRIPES		4
+#endif
+
+#define SHARED_KEY_MAX		16
+
+struct shared_counter {
+	uint64_t packets;
+	uint64_t bytes;
+};
+
+struct shared_slot {
+	uint32_t state;				///< SLOT_EMPTY, SLOT_BUSY or SLOT_READY
+	uint8_t key[SHARED_KEY_MAX];
+};
+
+struct shared_map {
+	size_t capacity;				///< power of two
+	size_t mask;
+	size_t limit;					///< keys taken at most
+	size_t size;					///< keys taken, may be above count briefly
+	unsigned stripes;				///< counter arrays, up to SHARED_STRIPES
+	unsigned key_len;				///< key length in bytes
+	size_t key_offset;			///< offset of key inside inserted records
+	struct shared_slot * slots;
+	struct shared_counter * stripe[SHARED_STRIPES];
+	uint32_t overflow;			///< set if a key was refused
+};
+
+typedef void (*shared_cb_t)(const uint8_t * key,
+									uint64_t packets, uint64_t bytes, void * data);
+
+bool shared_map_init(struct shared_map * map, size_t keys, unsigned stripes,
+							unsigned key_len, size_t key_offset);
+void shared_map_free(struct shared_map * map);
+bool shared_map_add(struct shared_map * map, const void * record,
+							uint64_t packets, uint64_t bytes, unsigned stripe);
+size_t shared_map_prefetch(const struct shared_map * map, const void * record, unsigned stripe);
+bool shared_map_add_at(struct shared_map * map, const void * record, size_t i,
+							uint64_t packets, uint64_t bytes, unsigned stripe);
+void shared_map_iter(const struct shared_map * map, shared_cb_t cb, void * data);
+
+#endif // SHARED_MAP_H_
+
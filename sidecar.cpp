@@ -0,0 +1,212 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 02:05:13 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "sidecar.h"
+
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "param.h"
+
+static const char SIDECAR_MAGIC[8] = { 'F', 'L', 'O', 'W', 'S', 'D', 'C', '1' };
+
+/**
+ * @brief  Identity of the file a sidecar belongs to
+ */
+struct sidecar_header {
+	char magic[sizeof(SIDECAR_MAGIC)];
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t size;
+	uint64_t mtime_sec;
+	uint64_t mtime_nsec;
+};
+
+/**
+ * @brief  Aggregation names used in file names, in the order of
+ *         Param::aggregation_t
+ */
+static const char * SIDECAR_AGGREGATION[] = {
+	"unknown", "srcport", "dstport", "srcip", "dstip",
+	"srcip4", "dstip4", "srcip6", "dstip6"
+};
+
+/**
+ * @brief  Get identity of a file
+ *
+ * @param node file to describe
+ * @param hdr identity is stored here
+ *
+ * @return   false if file can not be stat()ed
+ */
+static
+bool sidecar_identity(struct linked_list_node * node, struct sidecar_header * hdr) {
+	struct stat st;
+
+	if (fstat(fileno(node->f), &st))
+		return false;
+
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->magic, SIDECAR_MAGIC, sizeof(SIDECAR_MAGIC));
+	hdr->dev = st.st_dev;
+	hdr->ino = st.st_ino;
+	hdr->size = st.st_size;
+	hdr->mtime_sec = st.st_mtim.tv_sec;
+	hdr->mtime_nsec = st.st_mtim.tv_nsec;
+
+	return true;
+}
+
+/**
+ * @brief  Get name of an aggregation used in file names
+ *
+ * @param aggregation aggregation
+ * @param mask mask of masked aggregation
+ *
+ * @return   name, e.g. srcip4-24
+ */
+std::string aggregation_name(unsigned aggregation, unsigned mask) {
+	const size_t names = sizeof(SIDECAR_AGGREGATION) / sizeof(SIDECAR_AGGREGATION[0]);
+	std::string ret = SIDECAR_AGGREGATION[aggregation < names ? aggregation : 0];
+
+	if (aggregation >= Param::AGG_SRCIP4)
+		ret += "-" + std::to_string(mask);
+
+	return ret;
+}
+
+/**
+ * @brief  Get sidecar path of a file
+ *
+ * @param name file name
+ * @param aggregation aggregation of the partial
+ * @param mask mask of the partial
+ *
+ * @return   path next to the file
+ */
+std::string sidecar_path(const char * name, unsigned aggregation, unsigned mask) {
+	return std::string(name) + "." + aggregation_name(aggregation, mask) + SIDECAR_SUFFIX;
+}
+
+/**
+ * @brief  Open sidecar of a file if it is still valid
+ *
+ * @param node file the sidecar belongs to
+ * @param path sidecar path
+ *
+ * @return   sidecar positioned at the partial, NULL if missing or stale
+ */
+FILE * sidecar_open(struct linked_list_node * node, const std::string & path) {
+	struct sidecar_header expected;
+	struct sidecar_header hdr;
+	FILE * f;
+
+	if (! sidecar_identity(node, &expected) || ! (f = fopen(path.c_str(), "rb")))
+		return NULL;
+
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || memcmp(&hdr, &expected, sizeof(hdr))) {
+		fclose(f);
+		return NULL;
+	}
+
+	return f;
+}
+
+/**
+ * @brief  Start sidecar of a file, a temporary file is used if the directory
+ *         is not writable
+ *
+ * @param w writer to init, partial is written to w->f
+ * @param node file the sidecar belongs to
+ * @param path sidecar path
+ *
+ * @return   false on error
+ */
+bool sidecar_begin(struct sidecar_writer * w, struct linked_list_node * node,
+							const std::string & path) {
+	std::string tmp = path + ".XXXXXX";
+	std::vector<char> name(tmp.begin(), tmp.end());
+	struct sidecar_header hdr;
+	int fd;
+
+	if (! sidecar_identity(node, &hdr))
+		return false;
+
+	name.push_back('\0');
+	if ((fd = mkstemp(&name[0])) >= 0 && (w->f = fdopen(fd, "w+b"))) {
+		w->tmp = &name[0];
+	} else {
+		if (fd >= 0) {
+			close(fd);
+			unlink(&name[0]);
+		}
+		warn() << "Unable to write sidecar '" << path << "', it is not kept\n";
+		w->tmp.clear();
+		if (! (w->f = tmpfile()))
+			return false;
+	}
+
+	w->fd = dup(fileno(w->f));
+
+	if (w->fd < 0 || fwrite(&hdr, sizeof(hdr), 1, w->f) != 1) {
+		if (w->fd >= 0)
+			close(w->fd);
+		fclose(w->f);
+		if (! w->tmp.empty())
+			unlink(w->tmp.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Finish sidecar, w->f has to be closed already (partial_close())
+ *
+ * @param w writer to finish
+ * @param path sidecar path
+ * @param ok was the partial written?
+ *
+ * @return   written sidecar positioned at the partial, NULL on error
+ */
+FILE * sidecar_end(struct sidecar_writer * w, const std::string & path, bool ok) {
+	FILE * f = NULL;
+
+	if (! w->tmp.empty()) {
+		// mkstemp() creates the file private, other runs may be other users
+		mode_t mask = umask(0);
+		umask(mask);
+		chmod(w->tmp.c_str(), 0666 & ~mask);
+
+		if (! ok || rename(w->tmp.c_str(), path.c_str())) {
+			if (ok)
+				perror(path.c_str());
+			unlink(w->tmp.c_str());
+		}
+	}
+
+	if (ok && (f = fdopen(w->fd, "rb"))) {
+		if (fseek(f, sizeof(struct sidecar_header), SEEK_SET)) {
+			fclose(f);
+			f = NULL;
+		}
+	} else
+		close(w->fd);
+
+	return f;
+}
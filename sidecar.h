@@ -0,0 +1,57 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 02:05:13 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef SIDECAR_H_
+#define SIDECAR_H_
+
+#include <inttypes.h>
+#include <cstdio>
+#include <string>
+
+#include "flow.h"
+#include "file_list.h"
+
+/*
+ * Partial aggregate of a single file kept next to it, so unchanged files
+ * are not aggregated again. Sidecar is valid while the file has the same
+ * device, inode, size and mtime.
+ *
+ * Layout (host byte order):
+ *   "FLOWSDC1", u64 device, u64 inode, u64 size, u64 mtime seconds,
+ *   u64 mtime nanoseconds, partial (see partial.h)
+ *
+ * Sidecars are named FILE.AGGREGATION.flowagg, Filepool skips them.
+ */
+
+#define SIDECAR_SUFFIX		".flowagg"
+
+/**
+ * @brief  Sidecar being written
+ */
+struct sidecar_writer {
+	FILE * f;						///< partial is written here
+	int fd;							///< reads written sidecar back
+	std::string tmp;				///< renamed when complete, empty if not kept
+};
+
+std::string aggregation_name(unsigned aggregation, unsigned mask);
+std::string sidecar_path(const char * name, unsigned aggregation, unsigned mask);
+FILE * sidecar_open(struct linked_list_node * node, const std::string & path);
+bool sidecar_begin(struct sidecar_writer * w, struct linked_list_node * node,
+							const std::string & path);
+FILE * sidecar_end(struct sidecar_writer * w, const std::string & path, bool ok);
+
+#endif // SIDECAR_H_
+
@@ -0,0 +1,194 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 04:37:02 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "sorted.h"
+
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "common.h"
+#include "param.h"
+#include "store.h"
+#include "segment.h"
+#include "zone.h"
+
+static const char SORTED_MAGIC[8] = { 'F', 'L', 'O', 'W', 'S', 'R', 'T', '1' };
+
+/**
+ * @brief  Compacted segment header
+ */
+struct sorted_header {
+	char magic[sizeof(SORTED_MAGIC)];
+	uint32_t column;
+	uint32_t reserved;
+	uint64_t rows;
+};
+
+/**
+ * @brief  Is file a compacted segment?
+ *
+ * @param f file to check, position is kept
+ * @param column key column is stored here
+ *
+ * @return   true if file is a compacted segment
+ */
+bool sorted_check(FILE * f, unsigned * column) {
+	struct sorted_header hdr;
+
+	if (pread(fileno(f), &hdr, sizeof(hdr), 0) != (ssize_t) sizeof(hdr)
+			|| memcmp(hdr.magic, SORTED_MAGIC, sizeof(SORTED_MAGIC)))
+		return false;
+
+	*column = hdr.column;
+	return true;
+}
+
+/**
+ * @brief  Move past header of a compacted segment, records follow
+ *
+ * @param f opened file
+ */
+void sorted_skip(FILE * f) {
+	unsigned column;
+
+	if (sorted_check(f, &column))
+		fseek(f, sizeof(struct sorted_header), SEEK_SET);
+}
+
+/**
+ * @brief  Write records of store ordered by key column
+ *
+ * @param path segment to write
+ * @param s records with all columns
+ * @param column key column
+ *
+ * @return   false on error
+ */
+static
+bool sorted_write(const std::string & path, const struct flow_store * s, unsigned column) {
+	const uint8_t * key = store_column(s, column);
+	const size_t width = STORE_WIDTH[column];
+	std::vector<size_t> order(s->rows);
+	std::string tmp = path + ".tmp";
+	struct sorted_header hdr;
+	struct Flow::data rec;
+	bool ok;
+	FILE * f;
+
+	for (size_t i = 0; i < s->rows; ++i)
+		order[i] = i;
+
+	// keys compared as stored, the order aggregation prints keys in
+	std::stable_sort(order.begin(), order.end(), [key, width](size_t a, size_t b) {
+		return memcmp(key + a * width, key + b * width, width) < 0;
+	});
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SORTED_MAGIC, sizeof(SORTED_MAGIC));
+	hdr.column = column;
+	hdr.rows = s->rows;
+
+	if ((f = fopen(tmp.c_str(), "wb")) == NULL) {
+		perror(tmp.c_str());
+		return false;
+	}
+
+	ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+	memset(&rec, 0, sizeof(rec));
+
+	for (size_t i = 0; ok && i < s->rows; ++i) {
+		size_t r = order[i];
+
+		rec.src_addr = s->src_addr[r];
+		rec.dst_addr = s->dst_addr[r];
+		rec.src_port = s->src_port[r];
+		rec.dst_port = s->dst_port[r];
+		rec.packets = __builtin_bswap64(s->packets[r]);
+		rec.bytes = __builtin_bswap64(s->bytes[r]);
+		ok = fwrite(&rec, sizeof(rec), 1, f) == 1;
+	}
+
+	if (fclose(f) || ! ok || rename(tmp.c_str(), path.c_str())) {
+		perror(path.c_str());
+		unlink(tmp.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Rewrite files as compacted segments of up to SORTED_ROWS records,
+ *         a segment is named after its first file
+ *
+ * @param files record files or segments to compact
+ * @param dir directory to write segments to
+ * @param column key column to order records by
+ *
+ * @return   false on error
+ */
+bool sorted_compact(struct linked_list * files, const char * dir, unsigned column) {
+	struct linked_list_node * l = linked_list_last(files);
+
+	if (! segment_mkdir(dir))
+		return false;
+
+	while (l) {
+		const char * base = strrchr(l->name, '/');
+		std::string path = std::string(dir) + "/" + (base ? base + 1 : l->name);
+		struct linked_list_node * first = l;
+		struct flow_store s;
+		size_t rows = 0;
+		size_t count = 0;
+		bool ok = true;
+
+		// files are not split, a file larger than SORTED_ROWS is a segment alone
+		for (struct linked_list_node * n = first; n; n = n->prev) {
+			size_t r = store_rows_file(n);
+
+			if (count && rows + r > SORTED_ROWS)
+				break;
+			rows += r;
+			count++;
+		}
+
+		if (! store_init(&s, rows, STORE_ALL)) {
+			err() << "Unable to allocate records of '" << first->name << "'!\n";
+			return false;
+		}
+
+		for (size_t i = 0; ok && i < count; ++i, l = l->prev)
+			ok = store_load_file(&s, l);
+
+		ok = ok && sorted_write(path, &s, column);
+
+		if (ok)
+			zone_write(path, &s);
+
+		if (ok && Param::stats())
+			std::cerr << "compact: " << path << " " << s.rows << " records of "
+				<< count << " files\n";
+
+		store_free(&s);
+
+		if (! ok)
+			return false;
+	}
+
+	return true;
+}
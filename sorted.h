@@ -0,0 +1,45 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 04:37:02 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef SORTED_H_
+#define SORTED_H_
+
+#include <inttypes.h>
+#include <cstdio>
+
+#include "flow.h"
+#include "file_list.h"
+
+/*
+ * Compacted segment, records ordered by a key column so aggregation by
+ * that key is a streaming merge of segments.
+ *
+ * Layout:
+ *   "FLOWSRT1", u32 key column (in the order of flow_store), u32 reserved,
+ *   u64 record count (header in host byte order), records as in record
+ *   files
+ *
+ * Filepool skips the header, so a compacted segment reads as a record file
+ * everywhere else.
+ */
+
+#define SORTED_ROWS			(1 << 22)
+
+bool sorted_check(FILE * f, unsigned * column);
+void sorted_skip(FILE * f);
+bool sorted_compact(struct linked_list * files, const char * dir, unsigned column);
+
+#endif // SORTED_H_
+
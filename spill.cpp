@@ -0,0 +1,177 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 08:41:17 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "spill.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common.h"
+
+#define SPILL_BUFFER		(1 << 20)
+
+/**
+ * @brief  Create anonymous temporary file in $TMPDIR (or /tmp)
+ *
+ * @return   opened file or NULL
+ */
+FILE * spill_open() {
+	const char * dir = getenv("TMPDIR");
+	std::string path;
+	FILE * f;
+	int fd;
+
+	path = std::string(dir && *dir ? dir : "/tmp") + "/flow-spill-XXXXXX";
+	std::vector<char> name(path.begin(), path.end());
+	name.push_back('\0');
+
+	if ((fd = mkstemp(&name[0])) < 0) {
+		err() << "Unable to create spill file in '" << path << "'!\n";
+		perror("mkstemp");
+		return NULL;
+	}
+
+	// the file lives as long as it is open
+	unlink(&name[0]);
+
+	if (! (f = fdopen(fd, "w+b"))) {
+		close(fd);
+		return NULL;
+	}
+
+	setvbuf(f, NULL, _IOFBF, SPILL_BUFFER);
+	return f;
+}
+
+/**
+ * @brief  Append flow to a run
+ *
+ * @param f run to write to
+ * @param flow flow to store
+ *
+ * @return   false on write error
+ */
+bool spill_write(FILE * f, const Flow * flow) {
+	return fwrite(&flow->data, sizeof(flow->data), 1, f) == 1;
+}
+
+/**
+ * @brief  Read next record of a reader
+ *
+ * @return   false at the end of run
+ */
+static
+bool spill_read(struct spill_reader * r) {
+	return fread(&r->flow.data, sizeof(r->flow.data), 1, r->f) == 1;
+}
+
+/**
+ * @brief  Start merging runs, runs are closed when merge is freed
+ *
+ * Runs in regular files are rewound, streams (pipes, sockets) are read
+ * from the current position.
+ *
+ * @param m merge to init
+ * @param runs runs sorted by cmp
+ * @param cmp compare function
+ * @param data user data passed to cmp
+ *
+ * @return   false on read error
+ */
+bool spill_merge_init(struct spill_merge * m, std::vector<FILE *> & runs,
+								spill_cmp_t cmp, const void * data) {
+	m->cmp = cmp;
+	m->data = data;
+	m->heap.clear();
+
+	for (auto f : runs) {
+		struct spill_reader * r = new struct spill_reader;
+		struct stat s;
+
+		r->f = f;
+		if (fstat(fileno(f), &s) == 0 && S_ISREG(s.st_mode)
+				&& (fflush(f) || fseek(f, 0, SEEK_SET))) {
+			err() << "Unable to rewind spill file!\n";
+			delete r;
+			return false;
+		}
+
+		if (spill_read(r))
+			m->heap.push_back(r);
+		else {
+			fclose(f);
+			delete r;
+		}
+	}
+
+	runs.clear();
+
+	std::make_heap(m->heap.begin(), m->heap.end(),
+		[m](const struct spill_reader * a, const struct spill_reader * b) {
+			return m->cmp(&a->flow, &b->flow, m->data) > 0;
+		});
+
+	return true;
+}
+
+/**
+ * @brief  Get the smallest record of all runs
+ *
+ * @param m merge to use
+ * @param flow record is stored here (data only)
+ *
+ * @return   false if all runs are exhausted
+ */
+bool spill_merge_next(struct spill_merge * m, Flow * flow) {
+	auto greater = [m](const struct spill_reader * a, const struct spill_reader * b) {
+		return m->cmp(&a->flow, &b->flow, m->data) > 0;
+	};
+
+	if (m->heap.empty())
+		return false;
+
+	std::pop_heap(m->heap.begin(), m->heap.end(), greater);
+	struct spill_reader * r = m->heap.back();
+
+	memcpy(&flow->data, &r->flow.data, sizeof(flow->data));
+
+	if (spill_read(r))
+		std::push_heap(m->heap.begin(), m->heap.end(), greater);
+	else {
+		m->heap.pop_back();
+		fclose(r->f);
+		delete r;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Free merge and close runs left
+ *
+ * @param m merge to free
+ */
+void spill_merge_free(struct spill_merge * m) {
+	for (auto r : m->heap) {
+		fclose(r->f);
+		delete r;
+	}
+
+	m->heap.clear();
+}
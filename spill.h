@@ -0,0 +1,57 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 08:41:17 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef SPILL_H_
+#define SPILL_H_
+
+#include <cstdio>
+#include <vector>
+
+#include "flow.h"
+
+/*
+ * Sorted runs of flow records in temporary files. A run is written when
+ * aggregation structures exceed the memory limit, runs are read back by
+ * k-way merge. Only Flow::data is stored.
+ */
+
+typedef int (*spill_cmp_t)(const Flow * a, const Flow * b, const void * data);
+
+/**
+ * @brief  Run being merged, flow holds the current record
+ */
+struct spill_reader {
+	FILE * f;
+	Flow flow;
+};
+
+/**
+ * @brief  K-way merge of runs, readers are kept in a heap
+ */
+struct spill_merge {
+	std::vector<struct spill_reader *> heap;
+	spill_cmp_t cmp;
+	const void * data;					///< passed to cmp
+};
+
+FILE * spill_open();
+bool spill_write(FILE * f, const Flow * flow);
+bool spill_merge_init(struct spill_merge * m, std::vector<FILE *> & runs,
+								spill_cmp_t cmp, const void * data);
+bool spill_merge_next(struct spill_merge * m, Flow * flow);
+void spill_merge_free(struct spill_merge * m);
+
+#endif // SPILL_H_
+
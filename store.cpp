@@ -0,0 +1,488 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 11:48:20 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "store.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hugepage.h"
+#include "segment.h"
+
+static const char STORE_MAGIC[8] = { 'F', 'L', 'O', 'W', 'S', 'T', 'R', '1' };
+
+/**
+ * @brief  Bytes of a row in every column, in the order of flow_store
+ */
+const size_t STORE_WIDTH[STORE_COLUMNS] = {
+	sizeof(struct in6_addr), sizeof(struct in6_addr),
+	sizeof(uint16_t), sizeof(uint16_t),
+	sizeof(uint64_t), sizeof(uint64_t)
+};
+
+/**
+ * @brief  Allocate column
+ *
+ * @param s store of the column
+ * @param column STORE_* bit of the column
+ * @param width bytes of a row
+ *
+ * @return   column, NULL if not wanted
+ */
+static
+void * store_alloc(const struct flow_store * s, unsigned column, size_t width) {
+	return (s->columns & column) ? huge_alloc(s->capacity * width) : NULL;
+}
+
+/**
+ * @brief  Allocate columns
+ *
+ * @param s store to init
+ * @param capacity maximal number of rows
+ * @param columns STORE_* bits of columns to allocate
+ *
+ * @return   false if out of memory
+ */
+bool store_init(struct flow_store * s, size_t capacity, unsigned columns) {
+	s->rows = 0;
+	s->capacity = capacity ? capacity : 1;
+	s->columns = columns;
+	s->map = NULL;
+	s->map_size = 0;
+
+	s->src_addr = (struct in6_addr *) store_alloc(s, STORE_SRC_ADDR, sizeof(struct in6_addr));
+	s->dst_addr = (struct in6_addr *) store_alloc(s, STORE_DST_ADDR, sizeof(struct in6_addr));
+	s->src_port = (uint16_t *) store_alloc(s, STORE_SRC_PORT, sizeof(uint16_t));
+	s->dst_port = (uint16_t *) store_alloc(s, STORE_DST_PORT, sizeof(uint16_t));
+	s->packets = (uint64_t *) store_alloc(s, STORE_PACKETS, sizeof(uint64_t));
+	s->bytes = (uint64_t *) store_alloc(s, STORE_BYTES, sizeof(uint64_t));
+
+	for (unsigned i = 0; i < STORE_COLUMNS; ++i) {
+		if ((columns & (1 << i)) && ! store_column(s, i)) {
+			store_free(s);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Get column by its position
+ *
+ * @param s store
+ * @param i column in the order of flow_store
+ *
+ * @return   column, NULL if not held
+ */
+uint8_t * store_column(const struct flow_store * s, unsigned i) {
+	void * column[STORE_COLUMNS] = {
+		s->src_addr, s->dst_addr, s->src_port, s->dst_port, s->packets, s->bytes
+	};
+
+	return (uint8_t *) column[i];
+}
+
+/**
+ * @brief  Count records of a file, record file or segment
+ *
+ * @param node file to count
+ *
+ * @return   number of records
+ */
+size_t store_rows_file(struct linked_list_node * node) {
+	struct stat st;
+	uint64_t rows;
+
+	if (segment_rows(node->f, &rows))
+		return rows;
+	if (fstat(fileno(node->f), &st) == 0)
+		return st.st_size / sizeof(struct Flow::data);
+
+	return 0;
+}
+
+/**
+ * @brief  Count records of files
+ *
+ * @param files files to count
+ *
+ * @return   number of records
+ */
+size_t store_rows(struct linked_list * files) {
+	size_t ret = 0;
+
+	for (struct linked_list_node * l = linked_list_last(files); l; l = l->prev)
+		ret += store_rows_file(l);
+
+	return ret;
+}
+
+/**
+ * @brief  Load wanted columns of records of a segment matching filter
+ *
+ * @param s store with capacity for all records
+ * @param f segment to read
+ *
+ * @return   false if segment is not valid or store is too small
+ */
+static
+bool store_load_segment(struct flow_store * s, FILE * f) {
+	const struct flow_filter * filter = Param::filter();
+	struct flow_store all;
+	uint64_t rows;
+	bool ok;
+
+	if (! filter)
+		return segment_read(f, s);
+
+	// filter needs columns the query may not
+	if (! segment_rows(f, &rows) || ! store_init(&all, rows, STORE_ALL))
+		return false;
+
+	ok = segment_read(f, &all);
+
+	for (size_t i = 0; ok && i < all.rows; ++i) {
+		// segments keep no family, it is told by the source address like in Flow
+		uint32_t family = IN6_IS_ADDR_V4COMPAT(&all.src_addr[i]) ? AF_INET : AF_INET6;
+
+		if (! filter_match(filter, family, &all.src_addr[i], &all.dst_addr[i],
+					all.src_port[i], all.dst_port[i]))
+			continue;
+
+		if (s->rows == s->capacity) {
+			ok = false;
+			break;
+		}
+
+		for (unsigned c = 0; c < STORE_COLUMNS; ++c) {
+			if (store_column(s, c))
+				memcpy(store_column(s, c) + s->rows * STORE_WIDTH[c],
+					store_column(&all, c) + i * STORE_WIDTH[c], STORE_WIDTH[c]);
+		}
+		s->rows++;
+	}
+
+	store_free(&all);
+	return ok;
+}
+
+/**
+ * @brief  Append wanted columns of a record
+ *
+ * @param s store with capacity left
+ * @param flow record to append
+ */
+static inline
+void store_append(struct flow_store * s, const Flow * flow) {
+	if (s->src_addr)
+		s->src_addr[s->rows] = flow->data.src_addr;
+	if (s->dst_addr)
+		s->dst_addr[s->rows] = flow->data.dst_addr;
+	if (s->src_port)
+		s->src_port[s->rows] = flow->data.src_port;
+	if (s->dst_port)
+		s->dst_port[s->rows] = flow->data.dst_port;
+	if (s->packets)
+		s->packets[s->rows] = flow->data.packets;
+	if (s->bytes)
+		s->bytes[s->rows] = flow->data.bytes;
+	s->rows++;
+}
+
+/**
+ * @brief  Load wanted columns of a file, record file or segment
+ *
+ * @param s store with capacity for all records
+ * @param node file to read
+ *
+ * @return   false if file holds more records than expected or segment is
+ *           not valid, error is reported
+ */
+bool store_load_file(struct flow_store * s, struct linked_list_node * node) {
+	Flow flow;
+
+	if (segment_check(node->f)) {
+		if (store_load_segment(s, node->f))
+			return true;
+		err() << "Invalid segment '" << node->name << "'!\n";
+		return false;
+	}
+
+	while (Flow::getFlow(&flow, node)) {
+		if (s->rows == s->capacity) {
+			err() << "File '" << node->name << "' changed while loading!\n";
+			return false;
+		}
+
+		store_append(s, &flow);
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Load wanted columns of records of a record file being written,
+ *         exactly rows records are read from the current position
+ *
+ * @param s store with capacity for rows records
+ * @param node file to read
+ * @param rows number of complete records to read
+ *
+ * @return   false if records can not be read, error is reported
+ */
+bool store_load_rows(struct flow_store * s, struct linked_list_node * node, size_t rows) {
+	const struct flow_filter * filter = Param::filter();
+	Flow flow;
+
+	if (s->rows + rows > s->capacity)
+		return false;
+
+	for (size_t i = 0; i < rows; ++i) {
+		if (! Flow::readFlow(&flow, node)) {
+			err() << "Unable to read records of '" << node->name << "'!\n";
+			return false;
+		}
+
+		if (! filter || filter_match(filter, flow.data.sa_family,
+					&flow.data.src_addr, &flow.data.dst_addr,
+					flow.data.src_port, flow.data.dst_port))
+			store_append(s, &flow);
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Load all records of files
+ *
+ * @param s store with capacity for all records
+ * @param files files to read
+ *
+ * @return   false if files hold more records than expected, error is
+ *           reported
+ */
+bool store_load(struct flow_store * s, struct linked_list * files) {
+	for (struct linked_list_node * l = linked_list_last(files); l; l = l->prev) {
+		if (! store_load_file(s, l))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Free columns
+ *
+ * @param s store to free
+ */
+void store_free(struct flow_store * s) {
+	if (s->map) {
+		munmap(s->map, s->map_size);
+		memset(s, 0, sizeof(*s));
+		return;
+	}
+
+	for (unsigned i = 0; i < STORE_COLUMNS; ++i)
+		huge_free(store_column(s, i), s->capacity * STORE_WIDTH[i]);
+	memset(s, 0, sizeof(*s));
+}
+
+/**
+ * @brief  Memory held by columns
+ *
+ * @param s store to check
+ *
+ * @return   size in bytes
+ */
+size_t store_memory(const struct flow_store * s) {
+	size_t ret = 0;
+
+	if (s->map)
+		return s->map_size;
+
+	for (unsigned i = 0; i < STORE_COLUMNS; ++i) {
+		if (store_column(s, i))
+			ret += s->capacity * STORE_WIDTH[i];
+	}
+
+	return ret;
+}
+
+/**
+ * @brief  Describe source files, a published store is valid for the same
+ *         files only
+ *
+ * @param files files of the store
+ *
+ * @return   manifest, one "path size mtime" line per file
+ */
+std::string store_manifest(struct linked_list * files) {
+	std::string ret;
+	struct stat st;
+	char line[64];
+
+	for (struct linked_list_node * l = linked_list_last(files); l; l = l->prev) {
+		// the same files given by another path
+		char * path = realpath(l->name, NULL);
+
+		if (fstat(fileno(l->f), &st))
+			memset(&st, 0, sizeof(st));
+
+		snprintf(line, sizeof(line), " %llu %lld.%09ld\n", (unsigned long long) st.st_size,
+					(long long) st.st_mtim.tv_sec, (long) st.st_mtim.tv_nsec);
+		ret = ret + (path ? path : l->name) + line;
+		free(path);
+	}
+
+	return ret;
+}
+
+/**
+ * @brief  Compute positions of columns in a published store
+ *
+ * @param rows number of rows
+ * @param manifest_len manifest length
+ * @param off offsets of columns are stored here
+ *
+ * @return   file size
+ */
+static
+size_t store_layout(size_t rows, size_t manifest_len, size_t off[STORE_COLUMNS]) {
+	size_t pos = sizeof(STORE_MAGIC) + 2 * sizeof(uint64_t) + manifest_len;
+
+	for (unsigned i = 0; i < STORE_COLUMNS; ++i) {
+		pos = (pos + STORE_ALIGN - 1) & ~(size_t) (STORE_ALIGN - 1);
+		off[i] = pos;
+		pos += rows * STORE_WIDTH[i];
+	}
+
+	return pos;
+}
+
+/**
+ * @brief  Attach published store, columns are mapped read-only
+ *
+ * @param s store to init
+ * @param path published store
+ * @param manifest manifest of current files
+ *
+ * @return   false if there is no store for these files
+ */
+bool store_attach(struct flow_store * s, const char * path, const std::string & manifest) {
+	size_t off[STORE_COLUMNS];
+	uint64_t hdr[2];
+	struct stat st;
+	char * base;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return false;
+
+	if (fstat(fd, &st) || (size_t) st.st_size < sizeof(STORE_MAGIC) + sizeof(hdr)) {
+		close(fd);
+		return false;
+	}
+
+	base = (char *) mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (base == MAP_FAILED)
+		return false;
+
+	memcpy(hdr, base + sizeof(STORE_MAGIC), sizeof(hdr));
+
+	if (memcmp(base, STORE_MAGIC, sizeof(STORE_MAGIC)) || hdr[1] != manifest.size()
+			|| sizeof(STORE_MAGIC) + sizeof(hdr) + hdr[1] > (size_t) st.st_size
+			|| memcmp(base + sizeof(STORE_MAGIC) + sizeof(hdr), manifest.data(), hdr[1])
+			|| store_layout(hdr[0], hdr[1], off) != (size_t) st.st_size) {
+		munmap(base, st.st_size);
+		return false;
+	}
+
+	s->rows = s->capacity = hdr[0];
+	s->columns = STORE_ALL;
+	s->src_addr = (struct in6_addr *) (base + off[0]);
+	s->dst_addr = (struct in6_addr *) (base + off[1]);
+	s->src_port = (uint16_t *) (base + off[2]);
+	s->dst_port = (uint16_t *) (base + off[3]);
+	s->packets = (uint64_t *) (base + off[4]);
+	s->bytes = (uint64_t *) (base + off[5]);
+	s->map = base;
+	s->map_size = st.st_size;
+
+	return true;
+}
+
+/**
+ * @brief  Publish store for later runs, the previous store is replaced
+ *         atomically
+ *
+ * @param s store to publish, all columns
+ * @param path file to publish to, should be on tmpfs
+ * @param manifest manifest of files the store was loaded from
+ *
+ * @return   false on error
+ */
+bool store_publish(const struct flow_store * s, const char * path, const std::string & manifest) {
+	size_t off[STORE_COLUMNS];
+	size_t size = store_layout(s->rows, manifest.size(), off);
+	uint64_t hdr[2] = { s->rows, manifest.size() };
+	std::string tmp = std::string(path) + ".XXXXXX";
+	std::vector<char> name(tmp.begin(), tmp.end());
+	char * base;
+	int fd;
+
+	if (s->columns != STORE_ALL)
+		return false;
+
+	name.push_back('\0');
+	if ((fd = mkstemp(&name[0])) < 0)
+		return false;
+
+	if (ftruncate(fd, size)
+			|| (base = (char *) mmap(NULL, size, PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		close(fd);
+		unlink(&name[0]);
+		return false;
+	}
+	close(fd);
+
+	memcpy(base, STORE_MAGIC, sizeof(STORE_MAGIC));
+	memcpy(base + sizeof(STORE_MAGIC), hdr, sizeof(hdr));
+	memcpy(base + sizeof(STORE_MAGIC) + sizeof(hdr), manifest.data(), manifest.size());
+
+	for (unsigned i = 0; i < STORE_COLUMNS; ++i)
+		memcpy(base + off[i], store_column(s, i), s->rows * STORE_WIDTH[i]);
+
+	munmap(base, size);
+
+	// mkstemp() creates the file private, other runs may be other users
+	mode_t mask = umask(0);
+	umask(mask);
+	chmod(&name[0], 0666 & ~mask);
+
+	if (rename(&name[0], path)) {
+		unlink(&name[0]);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,85 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 11:48:20 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef STORE_H_
+#define STORE_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include <string>
+
+#include "flow.h"
+#include "file_list.h"
+
+/*
+ * Records kept in memory by columns. A query scans only the key column it
+ * aggregates by and the counters. Addresses and ports are kept as stored
+ * in Flow (ports in network order), counters in host order.
+ *
+ * A store can be published to a file (on tmpfs, e.g. /dev/shm) and later
+ * attached by mmap without reading records again. The file is keyed by a
+ * manifest of the source files (path, size, mtime).
+ *
+ * Layout (host byte order):
+ *   "FLOWSTR1", u64 rows, u64 manifest length, manifest, columns in the
+ *   order of flow_store, every one aligned to STORE_ALIGN
+ *
+ * A store may hold only some columns (STORE_* bits), the others are NULL.
+ * Only stores with all columns are published.
+ */
+
+#define STORE_ALIGN		64
+#define STORE_COLUMNS	6
+
+#define STORE_SRC_ADDR	0x01
+#define STORE_DST_ADDR	0x02
+#define STORE_SRC_PORT	0x04
+#define STORE_DST_PORT	0x08
+#define STORE_PACKETS	0x10
+#define STORE_BYTES		0x20
+#define STORE_ALL			0x3f
+
+extern const size_t STORE_WIDTH[STORE_COLUMNS];
+
+struct flow_store {
+	size_t rows;
+	size_t capacity;
+	unsigned columns;						///< STORE_* bits of allocated columns
+	struct in6_addr * src_addr;
+	struct in6_addr * dst_addr;
+	uint16_t * src_port;
+	uint16_t * dst_port;
+	uint64_t * packets;
+	uint64_t * bytes;
+	void * map;							///< attached file, NULL if allocated
+	size_t map_size;
+};
+
+bool store_init(struct flow_store * s, size_t capacity, unsigned columns);
+uint8_t * store_column(const struct flow_store * s, unsigned i);
+size_t store_rows_file(struct linked_list_node * node);
+size_t store_rows(struct linked_list * files);
+bool store_load_file(struct flow_store * s, struct linked_list_node * node);
+bool store_load_rows(struct flow_store * s, struct linked_list_node * node, size_t rows);
+bool store_load(struct flow_store * s, struct linked_list * files);
+void store_free(struct flow_store * s);
+size_t store_memory(const struct flow_store * s);
+std::string store_manifest(struct linked_list * files);
+bool store_attach(struct flow_store * s, const char * path, const std::string & manifest);
+bool store_publish(const struct flow_store * s, const char * path, const std::string & manifest);
+
+#endif // STORE_H_
+
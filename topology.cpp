@@ -0,0 +1,237 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 07:58:02 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "topology.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sched.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#ifdef HAVE_LIBNUMA
+# include <numa.h>
+# include <numaif.h>
+#else
+# include <sys/syscall.h>
+# ifndef MPOL_PREFERRED
+#  define MPOL_PREFERRED	1
+# endif
+# ifndef MPOL_F_NODE
+#  define MPOL_F_NODE		(1 << 0)
+# endif
+# ifndef MPOL_F_ADDR
+#  define MPOL_F_ADDR		(1 << 1)
+# endif
+#endif // HAVE_LIBNUMA
+
+/**
+ * @brief  Nodes with CPUs
+ */
+static struct {
+	unsigned nodes;
+	int id[TOPO_MAX_NODES];					///< system node number
+	cpu_set_t cpus[TOPO_MAX_NODES];
+	unsigned slots;
+} topo;
+
+/**
+ * @brief  Register node if it has any CPU
+ */
+static
+void topo_add(int id, const cpu_set_t * cpus) {
+	if (! CPU_COUNT(cpus) || topo.nodes == TOPO_MAX_NODES)
+		return;
+
+	topo.id[topo.nodes] = id;
+	topo.cpus[topo.nodes] = *cpus;
+	topo.nodes++;
+}
+
+#ifndef HAVE_LIBNUMA
+/**
+ * @brief  Parse CPU list of a node from sysfs, e.g. "0-3,8-11"
+ *
+ * @param id system node number
+ * @param cpus parsed CPUs
+ *
+ * @return   false if node does not exist
+ */
+static
+bool topo_read_cpulist(int id, cpu_set_t * cpus) {
+	char path[64];
+	char line[1024];
+	FILE * f;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+	if (! (f = fopen(path, "r")))
+		return false;
+
+	CPU_ZERO(cpus);
+	if (fgets(line, sizeof(line), f)) {
+		char * p = line;
+
+		while (*p >= '0' && *p <= '9') {
+			unsigned long first = strtoul(p, &p, 10);
+			unsigned long last = first;
+
+			if (*p == '-')
+				last = strtoul(p + 1, &p, 10);
+
+			for (unsigned long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+				CPU_SET(cpu, cpus);
+
+			if (*p == ',')
+				p++;
+		}
+	}
+
+	fclose(f);
+	return true;
+}
+#endif // ! HAVE_LIBNUMA
+
+/**
+ * @brief  Discover nodes
+ *
+ * @param slots number of worker slots to spread over nodes
+ *
+ * @return   false if NUMA topology is not available
+ */
+bool topo_init(unsigned slots) {
+	cpu_set_t cpus;
+
+	topo.nodes = 0;
+	topo.slots = slots;
+
+#ifdef HAVE_LIBNUMA
+	if (numa_available() < 0)
+		return false;
+
+	struct bitmask * mask = numa_allocate_cpumask();
+
+	for (int id = 0; id <= numa_max_node(); ++id) {
+		if (numa_node_to_cpus(id, mask) < 0)
+			continue;
+
+		CPU_ZERO(&cpus);
+		for (unsigned cpu = 0; cpu < mask->size && cpu < CPU_SETSIZE; ++cpu)
+			if (numa_bitmask_isbitset(mask, cpu))
+				CPU_SET(cpu, &cpus);
+
+		topo_add(id, &cpus);
+	}
+
+	numa_free_cpumask(mask);
+#else
+	for (int id = 0; id < TOPO_MAX_NODES; ++id)
+		if (topo_read_cpulist(id, &cpus))
+			topo_add(id, &cpus);
+#endif // HAVE_LIBNUMA
+
+	return topo.nodes > 0;
+}
+
+/**
+ * @brief  Get number of nodes used for slots
+ */
+unsigned topo_nodes() {
+	return topo.nodes;
+}
+
+/**
+ * @brief  Get node of a worker slot
+ *
+ * @param slot slot number
+ *
+ * @return   node index, -1 if topology is not known
+ */
+int topo_slot_node(unsigned slot) {
+	if (! topo.nodes)
+		return -1;
+
+	return slot * topo.nodes / topo.slots;
+}
+
+/**
+ * @brief  Get system node number of a node index
+ */
+int topo_node_id(int node) {
+	return node < 0 ? -1 : topo.id[node];
+}
+
+/**
+ * @brief  Init thread attributes, thread is pinned to CPUs of a node
+ *
+ * @param attr attributes to init
+ * @param node node index, -1 to leave thread unpinned
+ */
+void topo_thread_attr(pthread_attr_t * attr, int node) {
+	pthread_attr_init(attr);
+
+	if (node >= 0)
+		pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &topo.cpus[node]);
+}
+
+/**
+ * @brief  Prefer node for pages of a memory range
+ *
+ * Only whole pages inside the range are bound, the rest is left to first
+ * touch which is local for pinned threads anyway.
+ *
+ * @param ptr memory
+ * @param size size of memory
+ * @param node node index, -1 to do nothing
+ */
+void topo_bind(void * ptr, size_t size, int node) {
+	uintptr_t page = sysconf(_SC_PAGESIZE);
+	uintptr_t start = ((uintptr_t) ptr + page - 1) & ~(page - 1);
+	uintptr_t end = ((uintptr_t) ptr + size) & ~(page - 1);
+
+	if (node < 0 || ! ptr || end <= start)
+		return;
+
+#ifdef HAVE_LIBNUMA
+	numa_tonode_memory((void *) start, end - start, topo.id[node]);
+#else
+	unsigned long mask[TOPO_MAX_NODES / (8 * sizeof(unsigned long)) + 1] = { 0 };
+	unsigned id = topo.id[node];
+
+	mask[id / (8 * sizeof(unsigned long))] |= 1UL << (id % (8 * sizeof(unsigned long)));
+	syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, mask,
+				8 * sizeof(mask), 0);
+#endif // HAVE_LIBNUMA
+}
+
+/**
+ * @brief  Get node holding memory
+ *
+ * @param ptr memory to query, page has to be present
+ *
+ * @return   system node number, -1 on error
+ */
+int topo_memory_node(const void * ptr) {
+	int node = -1;
+
+#ifdef HAVE_LIBNUMA
+	if (get_mempolicy(&node, NULL, 0, (void *) ptr, MPOL_F_NODE | MPOL_F_ADDR))
+		return -1;
+#else
+	if (syscall(SYS_get_mempolicy, &node, NULL, 0, ptr, MPOL_F_NODE | MPOL_F_ADDR))
+		return -1;
+#endif // HAVE_LIBNUMA
+
+	return node;
+}
@@ -0,0 +1,39 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/18/2026 07:58:02 PM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef TOPOLOGY_H_
+#define TOPOLOGY_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+/*
+ * NUMA placement of worker slots. Slots are spread over nodes in
+ * contiguous ranges, so slots of one node are neighbours. Uses libnuma
+ * if built with HAVE_LIBNUMA, sysfs and raw syscalls otherwise.
+ */
+
+#define TOPO_MAX_NODES		64
+
+bool topo_init(unsigned slots);
+unsigned topo_nodes();
+int topo_slot_node(unsigned slot);
+int topo_node_id(int node);
+void topo_thread_attr(pthread_attr_t * attr, int node);
+void topo_bind(void * ptr, size_t size, int node);
+int topo_memory_node(const void * ptr);
+
+#endif // TOPOLOGY_H_
+
@@ -0,0 +1,151 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 06:52:27 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "watch.h"
+
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "common.h"
+#include "sidecar.h"
+
+#define WATCH_EVENTS		(IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO \
+									| IN_MOVED_FROM | IN_DELETE)
+
+/**
+ * @brief  Add all names of watched directory
+ *
+ * @param w watched directory
+ * @param names names found are added here
+ *
+ * @return   false if the directory can not be read
+ */
+static
+bool watch_list(struct flow_watch * w, std::set<std::string> & names) {
+	struct dirent * ent;
+	DIR * d;
+
+	if (! (d = opendir(w->dir.c_str()))) {
+		perror(w->dir.c_str());
+		return false;
+	}
+
+	while ((ent = readdir(d)) != NULL) {
+		if (strcmp(ent->d_name, ".") && strcmp(ent->d_name, "..")
+				&& ! strstr(ent->d_name, SIDECAR_SUFFIX))
+			names.insert(ent->d_name);
+	}
+
+	closedir(d);
+	return true;
+}
+
+/**
+ * @brief  Start watching a directory
+ *
+ * @param w watch to init
+ * @param dir directory to watch
+ * @param names names already in the directory are added here
+ *
+ * @return   false on error
+ */
+bool watch_init(struct flow_watch * w, const char * dir, std::set<std::string> & names) {
+	w->dir = dir;
+
+	if ((w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) {
+		perror("inotify");
+		return false;
+	}
+
+	// watched before listing, so no file is missed in between
+	if ((w->wd = inotify_add_watch(w->fd, dir, WATCH_EVENTS | IN_ONLYDIR)) < 0) {
+		perror(dir);
+		close(w->fd);
+		return false;
+	}
+
+	if (! watch_list(w, names)) {
+		close(w->fd);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Wait for changes of watched directory
+ *
+ * @param w watched directory
+ * @param timeout milliseconds to wait at most
+ * @param names changed names are added here, none on timeout
+ *
+ * @return   false on error
+ */
+bool watch_wait(struct flow_watch * w, int timeout, std::set<std::string> & names) {
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct pollfd pfd;
+	ssize_t len;
+	int ret;
+
+	pfd.fd = w->fd;
+	pfd.events = POLLIN;
+
+	if ((ret = poll(&pfd, 1, timeout)) < 0) {
+		if (errno == EINTR)
+			return true;
+		perror("poll");
+		return false;
+	}
+
+	if (ret == 0)
+		return true;
+
+	while ((len = read(w->fd, buf, sizeof(buf))) > 0) {
+		for (char * p = buf; p < buf + len; /**/) {
+			const struct inotify_event * ev = (const struct inotify_event *) p;
+
+			if (ev->mask & IN_Q_OVERFLOW) {
+				warn() << "Events of '" << w->dir << "' were lost, listing it again\n";
+				if (! watch_list(w, names))
+					return false;
+			} else if (ev->len && ! strstr(ev->name, SIDECAR_SUFFIX))
+				names.insert(ev->name);
+
+			p += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+
+	if (len < 0 && errno != EAGAIN) {
+		perror("inotify");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Stop watching
+ *
+ * @param w watch to free
+ */
+void watch_free(struct flow_watch * w) {
+	close(w->fd);
+}
+
@@ -0,0 +1,42 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 06:52:27 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef WATCH_H_
+#define WATCH_H_
+
+#include <set>
+#include <string>
+
+/*
+ * Changes of a collector directory reported by inotify. Names created,
+ * written, renamed or deleted are reported, sidecars are not. If the
+ * kernel queue overflows, all names of the directory are reported.
+ */
+
+/**
+ * @brief  Watched directory
+ */
+struct flow_watch {
+	std::string dir;
+	int fd;								///< inotify instance
+	int wd;								///< watch of dir
+};
+
+bool watch_init(struct flow_watch * w, const char * dir, std::set<std::string> & names);
+bool watch_wait(struct flow_watch * w, int timeout, std::set<std::string> & names);
+void watch_free(struct flow_watch * w);
+
+#endif // WATCH_H_
+
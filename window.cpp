@@ -0,0 +1,219 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 05:44:09 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "window.h"
+
+#include <cstring>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "bucket.h"
+#include "sidecar.h"
+#include "alert.h"
+
+/**
+ * @brief  Init empty window
+ *
+ * @param w window to init
+ * @param key_len key length in bytes
+ * @param key_offset key position in Flow
+ * @param sort metric keys are ranked by
+ */
+void window_init(struct flow_window * w, unsigned key_len, size_t key_offset, Param::sort_t sort) {
+	w->key_len = key_len;
+	w->key_offset = key_offset;
+	w->sort = sort;
+	w->files.clear();
+	w->keys.clear();
+	w->rank.clear();
+}
+
+/**
+ * @brief  Get metric keys are ranked by
+ *
+ * @param w window
+ * @param c counters of a key
+ *
+ * @return   metric
+ */
+static inline
+uint64_t window_metric(const struct flow_window * w, const struct window_count * c) {
+	return w->sort == Param::SORT_PACKETS ? c->packets : c->bytes;
+}
+
+/**
+ * @brief  Change totals of a key, the key is dropped when no file holds it
+ *
+ * @param w window
+ * @param key key to change
+ * @param packets packets to add, two's complement to subtract
+ * @param bytes bytes to add, two's complement to subtract
+ * @param files files holding the key to add (1, 0 or -1)
+ */
+static
+void window_update(struct flow_window * w, const std::string & key, uint64_t packets,
+							uint64_t bytes, int files) {
+	struct window_count & c = w->keys[key];
+	bool ranked = w->sort != Param::SORT_KEY;
+
+	if (ranked && c.files)
+		w->rank.erase(std::make_pair(window_metric(w, &c), key));
+
+	c.packets += packets;
+	c.bytes += bytes;
+	c.files += files;
+
+	if (ranked && c.files)
+		w->rank.insert(std::make_pair(window_metric(w, &c), key));
+
+	// keys fallen below a limit are reported again when they reach it
+	if (Param::alert() && files >= 0) {
+		Flow flow;
+
+		memset(&flow.data, 0, sizeof(flow.data));
+		memcpy((uint8_t *) &flow + w->key_offset, key.data(), w->key_len);
+		flow.data.packets = c.packets;
+		flow.data.bytes = c.bytes;
+		alert_check(&flow, packets, bytes);
+	}
+
+	if (! c.files)
+		w->keys.erase(key);
+}
+
+/**
+ * @brief  Add counters of a key read from a file
+ *
+ * @param w window
+ * @param file file the key was read from
+ * @param key key of key_len bytes
+ * @param packets packets of the key
+ * @param bytes bytes of the key
+ */
+void window_add(struct flow_window * w, const std::string & file, const uint8_t * key,
+						uint64_t packets, uint64_t bytes) {
+	std::string k((const char *) key, w->key_len);
+	window_keys & partial = w->files[file];
+	auto i = partial.find(k);
+	int files = 0;
+
+	if (i == partial.end()) {
+		struct window_count & c = partial[k];
+		c.packets = packets;
+		c.bytes = bytes;
+		c.files = 1;
+		files = 1;
+	} else {
+		i->second.packets += packets;
+		i->second.bytes += bytes;
+	}
+
+	window_update(w, k, packets, bytes, files);
+}
+
+/**
+ * @brief  Subtract partial of a file leaving the window
+ *
+ * @param w window
+ * @param file file to subtract
+ */
+void window_remove(struct flow_window * w, const std::string & file) {
+	auto f = w->files.find(file);
+
+	if (f == w->files.end())
+		return;
+
+	for (auto & i : f->second)
+		window_update(w, i.first, - i.second.packets, - i.second.bytes, -1);
+
+	w->files.erase(f);
+}
+
+/**
+ * @brief  Print keys of window
+ *
+ * @param w window
+ * @param top number of keys printed, 0 for all
+ * @param print_fun function used for printing flow
+ * @param print_fun_header output header
+ */
+void window_print(const struct flow_window * w, size_t top,
+						void (* print_fun)(const Flow *), void (* print_fun_header)()) {
+	uint8_t * flow_key;
+	size_t count = 0;
+	Flow flow;
+
+	memset(&flow.data, 0, sizeof(flow.data));
+	flow_key = (uint8_t *) &flow + w->key_offset;
+
+	print_fun_header();
+
+	if (w->sort == Param::SORT_KEY) {
+		for (auto i = w->keys.begin(); i != w->keys.end() && (! top || count < top); ++i, ++count) {
+			memcpy(flow_key, i->first.data(), w->key_len);
+			flow.data.packets = i->second.packets;
+			flow.data.bytes = i->second.bytes;
+			print_fun(&flow);
+		}
+		return;
+	}
+
+	for (auto i = w->rank.rbegin(); i != w->rank.rend() && (! top || count < top); ++i, ++count) {
+		const struct window_count & c = w->keys.find(i->second)->second;
+
+		memcpy(flow_key, i->second.data(), w->key_len);
+		flow.data.packets = c.packets;
+		flow.data.bytes = c.bytes;
+		print_fun(&flow);
+	}
+}
+
+/**
+ * @brief  List record files of a directory by time of their names
+ *
+ * Files without time (e.g. nfcapd.current.PID still being written) and
+ * sidecars are skipped.
+ *
+ * @param dir directory to list
+ * @param files paths of files found with their time
+ *
+ * @return   false if the directory can not be read
+ */
+bool window_scan(const char * dir, std::map<std::string, time_t> & files) {
+	struct dirent * ent;
+	struct stat st;
+	DIR * d;
+
+	if (! (d = opendir(dir))) {
+		perror(dir);
+		return false;
+	}
+
+	while ((ent = readdir(d)) != NULL) {
+		std::string path = std::string(dir) + "/" + ent->d_name;
+		time_t t;
+
+		if (strstr(ent->d_name, SIDECAR_SUFFIX) || ! bucket_file_time(ent->d_name, &t))
+			continue;
+
+		if (! stat(path.c_str(), &st) && S_ISREG(st.st_mode))
+			files[path] = t;
+	}
+
+	closedir(d);
+	return true;
+}
+
@@ -0,0 +1,71 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 05:44:09 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef WINDOW_H_
+#define WINDOW_H_
+
+#include <inttypes.h>
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "flow.h"
+#include "param.h"
+
+/*
+ * Aggregate of a rolling set of files. Partial of every file is kept in
+ * memory, a file entering the window is added to totals and a file leaving
+ * it is subtracted. Keys are ranked by the sort metric as totals change,
+ * so the top of the window is printed without sorting all keys again.
+ *
+ * Keys are kept as key_len bytes of the key in Flow, ordered as memcmp()
+ * orders them, the same order keys are printed in.
+ */
+
+/**
+ * @brief  Counters of a key
+ */
+struct window_count {
+	uint64_t packets;
+	uint64_t bytes;
+	unsigned files;								///< files holding the key
+};
+
+typedef std::map<std::string, struct window_count> window_keys;
+
+/**
+ * @brief  Aggregate of files in window
+ */
+struct flow_window {
+	unsigned key_len;
+	size_t key_offset;								///< key position in Flow
+	Param::sort_t sort;
+	std::map<std::string, window_keys> files;	///< partial of every file
+	window_keys keys;									///< totals of the window
+	std::set<std::pair<uint64_t, std::string>> rank;	///< keys by metric, not used for key sort
+};
+
+void window_init(struct flow_window * w, unsigned key_len, size_t key_offset, Param::sort_t sort);
+void window_add(struct flow_window * w, const std::string & file, const uint8_t * key,
+						uint64_t packets, uint64_t bytes);
+void window_remove(struct flow_window * w, const std::string & file);
+void window_print(const struct flow_window * w, size_t top,
+						void (* print_fun)(const Flow *), void (* print_fun_header)());
+bool window_scan(const char * dir, std::map<std::string, time_t> & files);
+
+#endif // WINDOW_H_
+
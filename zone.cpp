@@ -0,0 +1,309 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 03:20:47 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#include "zone.h"
+
+#include <cstring>
+#include <string>
+
+#include "sidecar.h"
+#include "segment.h"
+#include "store.h"
+
+/**
+ * @brief  Get zone map path of a file
+ *
+ * @param node file
+ *
+ * @return   sidecar path
+ */
+static
+std::string zone_path(struct linked_list_node * node) {
+	return std::string(node->name) + ".zone" + SIDECAR_SUFFIX;
+}
+
+/**
+ * @brief  Hash address for bloom filter
+ *
+ * @param addr address to hash
+ *
+ * @return   FNV-1a hash
+ */
+static inline
+uint64_t zone_hash(const struct in6_addr * addr) {
+	uint64_t h = 14695981039346656037ULL;
+
+	for (unsigned i = 0; i < sizeof(addr->s6_addr); ++i)
+		h = (h ^ addr->s6_addr[i]) * 1099511628211ULL;
+
+	return h;
+}
+
+/**
+ * @brief  Add address to bloom filter
+ *
+ * @param bloom filter
+ * @param addr address to add
+ */
+static inline
+void zone_bloom_add(uint64_t * bloom, const struct in6_addr * addr) {
+	uint64_t h = zone_hash(addr);
+	uint64_t step = (h >> 32) | 1;
+
+	for (unsigned i = 0; i < ZONE_BLOOM_HASHES; ++i, h += step)
+		bloom[(h % ZONE_BLOOM_BITS) / 64] |= 1ULL << (h % 64);
+}
+
+/**
+ * @brief  Can address be in bloom filter?
+ *
+ * @param bloom filter
+ * @param addr address to check
+ *
+ * @return   false if address was never added
+ */
+static
+bool zone_bloom_test(const uint64_t * bloom, const struct in6_addr * addr) {
+	uint64_t h = zone_hash(addr);
+	uint64_t step = (h >> 32) | 1;
+
+	for (unsigned i = 0; i < ZONE_BLOOM_HASHES; ++i, h += step) {
+		if (! (bloom[(h % ZONE_BLOOM_BITS) / 64] & (1ULL << (h % 64))))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief  Add address to ranges and bloom filter of a direction
+ *
+ * @param z zone map
+ * @param dir ZONE_SRC or ZONE_DST
+ * @param addr address to add
+ */
+static inline
+void zone_add_addr(struct zone_map * z, unsigned dir, const struct in6_addr * addr) {
+	unsigned family = IN6_IS_ADDR_V4COMPAT(addr) ? ZONE_IPV4 : ZONE_IPV6;
+
+	if (z->count[dir][family]++ == 0) {
+		z->min[dir][family] = *addr;
+		z->max[dir][family] = *addr;
+	} else if (memcmp(addr, &z->min[dir][family], sizeof(*addr)) < 0)
+		z->min[dir][family] = *addr;
+	else if (memcmp(addr, &z->max[dir][family], sizeof(*addr)) > 0)
+		z->max[dir][family] = *addr;
+
+	zone_bloom_add(z->bloom[dir], addr);
+}
+
+/**
+ * @brief  Init empty zone map
+ *
+ * @param z zone map to init
+ */
+void zone_init(struct zone_map * z) {
+	memset(z, 0, sizeof(*z));
+}
+
+/**
+ * @brief  Add record to zone map
+ *
+ * @param z zone map
+ * @param src source address
+ * @param dst destination address
+ * @param src_port source port, network order
+ * @param dst_port destination port, network order
+ */
+void zone_add(struct zone_map * z, const struct in6_addr * src, const struct in6_addr * dst,
+					uint16_t src_port, uint16_t dst_port) {
+	uint16_t sport = ntohs(src_port);
+	uint16_t dport = ntohs(dst_port);
+
+	z->rows++;
+	zone_add_addr(z, ZONE_SRC, src);
+	zone_add_addr(z, ZONE_DST, dst);
+	z->port[ZONE_SRC][sport / 8] |= 1 << (sport % 8);
+	z->port[ZONE_DST][dport / 8] |= 1 << (dport % 8);
+}
+
+/**
+ * @brief  Can network match addresses of a direction?
+ *
+ * @param z zone map
+ * @param dir ZONE_SRC or ZONE_DST
+ * @param net network to check
+ *
+ * @return   false if no address of the direction is in network
+ */
+static
+bool zone_match_net(const struct zone_map * z, unsigned dir, const struct filter_net * net) {
+	struct in6_addr lo;
+	struct in6_addr hi;
+	bool ret = false;
+
+	filter_net_range(net, &lo, &hi);
+
+	// network range has to overlap range of a family
+	for (unsigned family = ZONE_IPV4; family <= ZONE_IPV6; ++family) {
+		if (z->count[dir][family] && memcmp(&lo, &z->max[dir][family], sizeof(lo)) <= 0
+				&& memcmp(&hi, &z->min[dir][family], sizeof(hi)) >= 0)
+			ret = true;
+	}
+
+	// single address is looked up in bloom filter
+	if (ret && net->len == 8 * sizeof(struct in6_addr))
+		ret = zone_bloom_test(z->bloom[dir], &net->addr);
+
+	return ret;
+}
+
+/**
+ * @brief  Can a record of the file match filter?
+ *
+ * @param z zone map of the file
+ * @param f filter
+ *
+ * @return   false if no record matches, the file may be skipped
+ */
+bool zone_match(const struct zone_map * z, const struct flow_filter * f) {
+	if (f->src.set && ! zone_match_net(z, ZONE_SRC, &f->src))
+		return false;
+	if (f->dst.set && ! zone_match_net(z, ZONE_DST, &f->dst))
+		return false;
+	if (f->src_port >= 0 && ! (z->port[ZONE_SRC][f->src_port / 8] & (1 << (f->src_port % 8))))
+		return false;
+	if (f->dst_port >= 0 && ! (z->port[ZONE_DST][f->dst_port / 8] & (1 << (f->dst_port % 8))))
+		return false;
+
+	return true;
+}
+
+/**
+ * @brief  Build zone map by reading all records of a file, the file is
+ *         returned to its position then
+ *
+ * @param z zone map to build
+ * @param node file to read, record file or segment
+ *
+ * @return   false if file can not be read
+ */
+static
+bool zone_build(struct zone_map * z, struct linked_list_node * node) {
+	zone_init(z);
+
+	if (segment_check(node->f)) {
+		struct flow_store s;
+		bool ok;
+
+		if (! store_init(&s, store_rows_file(node), STORE_ALL))
+			return false;
+
+		if ((ok = segment_read(node->f, &s))) {
+			for (size_t i = 0; i < s.rows; ++i)
+				zone_add(z, &s.src_addr[i], &s.dst_addr[i], s.src_port[i], s.dst_port[i]);
+		}
+
+		store_free(&s);
+		return ok;
+	}
+
+	long pos = ftell(node->f);
+	Flow flow;
+
+	while (Flow::readFlow(&flow, node))
+		zone_add(z, &flow.data.src_addr, &flow.data.dst_addr, flow.data.src_port, flow.data.dst_port);
+
+	clearerr(node->f);
+	return fseek(node->f, pos, SEEK_SET) == 0;
+}
+
+/**
+ * @brief  Keep zone map as sidecar of a file
+ *
+ * @param z zone map
+ * @param node file the zone map belongs to
+ *
+ * @return   false on error
+ */
+bool zone_save(const struct zone_map * z, struct linked_list_node * node) {
+	std::string path = zone_path(node);
+	struct sidecar_writer w;
+	FILE * f;
+	bool ok;
+
+	if (! sidecar_begin(&w, node, path))
+		return false;
+
+	ok = fwrite(z, sizeof(*z), 1, w.f) == 1;
+	ok = (fclose(w.f) == 0) && ok;
+
+	if ((f = sidecar_end(&w, path, ok)))
+		fclose(f);
+
+	return f != NULL;
+}
+
+/**
+ * @brief  Write zone map sidecar of a file written from a store
+ *
+ * @param path written file
+ * @param s records of the file
+ */
+void zone_write(const std::string & path, const struct flow_store * s) {
+	struct linked_list_node node;
+	struct zone_map * z = new struct zone_map;
+
+	node.prev = NULL;
+	node.name = (char *) path.c_str();
+
+	if ((node.f = fopen(node.name, "rb"))) {
+		zone_init(z);
+		for (size_t i = 0; i < s->rows; ++i)
+			zone_add(z, &s->src_addr[i], &s->dst_addr[i], s->src_port[i], s->dst_port[i]);
+
+		zone_save(z, &node);
+		fclose(node.f);
+	}
+
+	delete z;
+}
+
+/**
+ * @brief  Get zone map of a file, missing one is built only with
+ *         '--build-zones'
+ *
+ * @param z zone map is stored here
+ * @param node file
+ *
+ * @return   false if zone map is not available, file has to be read then
+ */
+bool zone_get(struct zone_map * z, struct linked_list_node * node) {
+	FILE * f;
+
+	if ((f = sidecar_open(node, zone_path(node)))) {
+		bool ok = fread(z, sizeof(*z), 1, f) == 1;
+
+		fclose(f);
+		if (ok)
+			return true;
+	}
+
+	if (! Param::build_zones() || ! zone_build(z, node))
+		return false;
+
+	zone_save(z, node);
+	return true;
+}
@@ -0,0 +1,70 @@
+/*
+ ***********************************************************************
+ *
+ *        @version  1.0
+ *        @date     10/19/2026 03:20:47 AM
+ *        @author   Fridolin Pokorny <fridex.devel@gmail.com>
+ *
+ * COPYING:
+ * Distributed under the terms of beer license. If you like this and
+ * you want to thank me (or use these sources), you have to buy
+ * me a beer.
+ *
+ ***********************************************************************
+ */
+
+#ifndef ZONE_H_
+#define ZONE_H_
+
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <string>
+
+#include "flow.h"
+#include "file_list.h"
+#include "filter.h"
+#include "store.h"
+
+/*
+ * Zone map of a file: address ranges per family, port bitmaps and bloom
+ * filters of addresses. A file whose zone map can not match a filter is
+ * not read at all. Zone maps are kept as sidecars (FILE.zone.flowagg),
+ * written by 'convert' and 'compact'. Filtered runs only read them, unless
+ * missing ones are built by '--build-zones', input is not written otherwise.
+ */
+
+#define ZONE_BLOOM_BITS		(1 << 16)
+#define ZONE_BLOOM_HASHES	4
+
+enum {
+	ZONE_SRC,
+	ZONE_DST
+};
+
+enum {
+	ZONE_IPV4,
+	ZONE_IPV6
+};
+
+/**
+ * @brief  Summary of records of a file, [ZONE_SRC/ZONE_DST][ZONE_IPV4/ZONE_IPV6]
+ */
+struct zone_map {
+	uint64_t rows;
+	uint64_t count[2][2];							///< addresses of family
+	struct in6_addr min[2][2];
+	struct in6_addr max[2][2];
+	uint8_t port[2][65536 / 8];					///< ports seen
+	uint64_t bloom[2][ZONE_BLOOM_BITS / 64];	///< addresses seen
+};
+
+void zone_init(struct zone_map * z);
+void zone_add(struct zone_map * z, const struct in6_addr * src, const struct in6_addr * dst,
+					uint16_t src_port, uint16_t dst_port);
+bool zone_match(const struct zone_map * z, const struct flow_filter * f);
+bool zone_save(const struct zone_map * z, struct linked_list_node * node);
+void zone_write(const std::string & path, const struct flow_store * s);
+bool zone_get(struct zone_map * z, struct linked_list_node * node);
+
+#endif // ZONE_H_
+